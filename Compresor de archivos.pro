@@ -14,23 +14,72 @@ INCLUDEPATH += .
 #DEFINES += QT_DISABLE_DEPRECATED_UP_TO=0x060000 # disables all APIs deprecated in Qt 6.0.0 and earlier
 
 # Input
-HEADERS += include/compressor.h \
+HEADERS += include/async_io.h \
+           include/batch_pipeline.h \
+           include/brotli_stream.h \
+           include/cancellation_token.h \
+           include/compressor.h \
+           include/cpu_count.h \
+           include/deflate_stream.h \
+           include/file_copy.h \
+           include/parallel_deflate.h \
+           include/parallel_gzip.h \
            include/gui_compressor.h \
            include/gui_mainwindow.h \
+           include/input_source.h \
+           include/lz4_stream.h \
            include/mainwindow.h \
-           include/progressdialog.h
-SOURCES += src/compressor.cpp \
+           include/memory_budget.h \
+           include/page_cache.h \
+           include/parallel_batch.h \
+           include/parallel_bzip2.h \
+           include/progressdialog.h \
+           include/seekable_gzip.h \
+           include/shard_queue.h \
+           include/spsc_ring.h \
+           include/staged_deflate.h \
+           include/work_stealing_pool.h \
+           include/xz_stream.h \
+           include/zip_archive_builder.h \
+           include/zip_stream_source.h \
+           include/zip_writer.h \
+           include/zstd_stream.h
+SOURCES += src/async_io.cpp \
+           src/batch_pipeline.cpp \
+           src/brotli_stream.cpp \
+           src/compressor.cpp \
            src/compressor_simple.cpp \
+           src/cpu_count.cpp \
+           src/deflate_benchmark.cpp \
+           src/deflate_stream.cpp \
+           src/file_copy.cpp \
+           src/parallel_deflate.cpp \
+           src/parallel_gzip.cpp \
            src/gui_compressor.cpp \
            src/gui_main.cpp \
            src/gui_mainwindow.cpp \
            src/gui_mainwindow_simple.cpp \
+           src/input_source.cpp \
            src/interactive_compressor.cpp \
+           src/lz4_stream.cpp \
            src/main.cpp \
            src/mainwindow.cpp \
+           src/memory_budget.cpp \
+           src/page_cache.cpp \
+           src/parallel_batch.cpp \
+           src/parallel_bzip2.cpp \
            src/progressdialog.cpp \
            src/pure_cpp_compressor.cpp \
+           src/seekable_gzip.cpp \
+           src/shard_queue.cpp \
            src/simple_main.cpp \
+           src/staged_deflate.cpp \
+           src/work_stealing_pool.cpp \
+           src/xz_stream.cpp \
+           src/zip_archive_builder.cpp \
+           src/zip_stream_source.cpp \
+           src/zip_writer.cpp \
+           src/zstd_stream.cpp \
            build/CMakeFiles/4.0.3/CompilerIdCXX/apple-sdk.cpp \
            build/CMakeFiles/4.0.3/CompilerIdCXX/CMakeCXXCompilerId.cpp
 TRANSLATIONS += build/CMakeFiles/FileCompressor.dir/compiler_depend.ts
@@ -17,11 +17,22 @@ TEMPLATE = app
 SOURCES += ../src/main.cpp \
            ../src/mainwindow.cpp \
            ../src/compressor_simple.cpp \
-           ../src/progressdialog.cpp
+           ../src/deflate_stream.cpp \
+           ../src/input_source.cpp \
+           ../src/file_copy.cpp \
+           ../src/progressdialog.cpp \
+           ../src/xz_stream.cpp \
+           ../src/zstd_stream.cpp
 
 HEADERS += ../include/mainwindow.h \
            ../include/compressor.h \
-           ../include/progressdialog.h
+           ../include/cancellation_token.h \
+           ../include/deflate_stream.h \
+           ../include/input_source.h \
+           ../include/file_copy.h \
+           ../include/progressdialog.h \
+           ../include/xz_stream.h \
+           ../include/zstd_stream.h
 
 INCLUDEPATH += ../include
 
@@ -35,6 +46,20 @@ unix:!macx {
     LIBS += -lz -lpng -ljpeg
 }
 
+# zstd type when libzstd is installed
+packagesExist(libzstd) {
+    DEFINES += HAVE_ZSTD
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libzstd
+}
+
+# xz type when liblzma is installed
+packagesExist(liblzma) {
+    DEFINES += HAVE_LZMA
+    CONFIG += link_pkgconfig
+    PKGCONFIG += liblzma
+}
+
 # Windows specific
 win32 {
     LIBS += -lzlib1
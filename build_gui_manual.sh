@@ -16,6 +16,22 @@ rm -rf *
 echo "📦 Generating MOC files..."
 /opt/homebrew/share/qt/libexec/moc ../include/gui_mainwindow.h -o moc_gui_mainwindow.cpp
 
+# Optional codecs, enabled the same way as in gui_compressor.pro
+CODEC_FLAGS=""
+CODEC_LIBS=""
+if pkg-config --exists libzstd; then
+    CODEC_FLAGS="$CODEC_FLAGS -DHAVE_ZSTD `pkg-config --cflags libzstd`"
+    CODEC_LIBS="$CODEC_LIBS `pkg-config --libs libzstd`"
+fi
+if pkg-config --exists bzip2; then
+    CODEC_FLAGS="$CODEC_FLAGS -DHAVE_BZIP2 `pkg-config --cflags bzip2`"
+    CODEC_LIBS="$CODEC_LIBS `pkg-config --libs bzip2`"
+fi
+
+# Engines used by gui_compressor.cpp (keep in sync with gui_compressor.pro)
+ENGINES="cpu_count deflate_stream input_source parallel_batch parallel_bzip2 parallel_deflate \
+         work_stealing_pool zip_archive_builder zip_stream_source zip_writer zstd_stream"
+
 # Compile source files
 echo "🔨 Compiling source files..."
 
@@ -24,6 +40,7 @@ g++ -c ../src/gui_main.cpp \
     -I../include \
     -I/opt/homebrew/include \
     -std=c++17 \
+    $CODEC_FLAGS \
     `pkg-config --cflags Qt5Widgets Qt5Core Qt5Gui Qt5Concurrent` \
     -o gui_main.o
 
@@ -32,6 +49,7 @@ g++ -c ../src/gui_mainwindow.cpp \
     -I../include \
     -I/opt/homebrew/include \
     -std=c++17 \
+    $CODEC_FLAGS \
     `pkg-config --cflags Qt5Widgets Qt5Core Qt5Gui Qt5Concurrent` \
     -o gui_mainwindow.o
 
@@ -40,22 +58,37 @@ g++ -c ../src/gui_compressor.cpp \
     -I../include \
     -I/opt/homebrew/include \
     -std=c++17 \
+    $CODEC_FLAGS \
     -o gui_compressor.o
 
+# Compile the engines
+ENGINE_OBJECTS=""
+for engine in $ENGINES; do
+    g++ -c ../src/$engine.cpp \
+        -I../include \
+        -I/opt/homebrew/include \
+        -std=c++17 \
+        $CODEC_FLAGS \
+        -o $engine.o || exit 1
+    ENGINE_OBJECTS="$ENGINE_OBJECTS $engine.o"
+done
+
 # Compile MOC file
 g++ -c moc_gui_mainwindow.cpp \
     -I../include \
     -I/opt/homebrew/include \
     -std=c++17 \
+    $CODEC_FLAGS \
     `pkg-config --cflags Qt5Widgets Qt5Core Qt5Gui Qt5Concurrent` \
     -o moc_gui_mainwindow.o
 
 # Link everything together
 echo "🔗 Linking..."
-g++ gui_main.o gui_mainwindow.o gui_compressor.o moc_gui_mainwindow.o \
+g++ gui_main.o gui_mainwindow.o gui_compressor.o moc_gui_mainwindow.o $ENGINE_OBJECTS \
     -o gui_compressor \
     -L/opt/homebrew/lib \
-    -lz -lzip \
+    -lz -lzip $CODEC_LIBS \
+    -pthread \
     `pkg-config --libs Qt5Widgets Qt5Core Qt5Gui Qt5Concurrent` \
     -framework AppKit
 
@@ -10,28 +10,68 @@ cd build_gui_simple
 cat > SimpleGUICompressor.pro << 'EOF'
 QT += core widgets concurrent
 CONFIG += c++17
+CONFIG += thread
 
 TARGET = gui_compressor_simple
 TEMPLATE = app
 
+# Same engines as gui_compressor.pro
 SOURCES += ../src/gui_main.cpp \
            ../src/gui_mainwindow_simple.cpp \
-           ../src/gui_compressor.cpp
+           ../src/gui_compressor.cpp \
+           ../src/cpu_count.cpp \
+           ../src/deflate_stream.cpp \
+           ../src/input_source.cpp \
+           ../src/parallel_batch.cpp \
+           ../src/parallel_bzip2.cpp \
+           ../src/parallel_deflate.cpp \
+           ../src/work_stealing_pool.cpp \
+           ../src/zip_archive_builder.cpp \
+           ../src/zip_stream_source.cpp \
+           ../src/zip_writer.cpp \
+           ../src/zstd_stream.cpp
 
 HEADERS += ../include/gui_mainwindow.h \
-           ../include/gui_compressor.h
+           ../include/gui_compressor.h \
+           ../include/cancellation_token.h \
+           ../include/cpu_count.h \
+           ../include/deflate_stream.h \
+           ../include/input_source.h \
+           ../include/parallel_batch.h \
+           ../include/parallel_bzip2.h \
+           ../include/parallel_deflate.h \
+           ../include/work_stealing_pool.h \
+           ../include/zip_archive_builder.h \
+           ../include/zip_stream_source.h \
+           ../include/zip_writer.h \
+           ../include/zstd_stream.h
 
 INCLUDEPATH += ../include
 
 # Disable AGL framework
 macx {
-    LIBS += -lz
+    INCLUDEPATH += /opt/homebrew/include
+    LIBS += -L/opt/homebrew/lib -lz -lzip
     QMAKE_LFLAGS += -framework Cocoa -framework OpenGL -framework QtConcurrent
 }
 
 # Linux specific
 unix:!macx {
-    LIBS += -lz
+    LIBS += -lz -lzip
+}
+
+# Zstandard codec when libzstd is installed
+packagesExist(libzstd) {
+    DEFINES += HAVE_ZSTD
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libzstd
+}
+
+# Parallel bzip2 when libbz2 is installed
+packagesExist(bzip2) {
+    DEFINES += HAVE_BZIP2
+    CONFIG += link_pkgconfig
+    PKGCONFIG += bzip2
 }
 
 # Windows specific
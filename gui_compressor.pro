@@ -1,16 +1,40 @@
 QT += core widgets
 CONFIG += c++17
 CONFIG += sdk_no_version_check
+CONFIG += thread
 
 TARGET = gui_compressor
 TEMPLATE = app
 
 SOURCES += ../src/gui_main.cpp \
            ../src/gui_mainwindow.cpp \
-           ../src/gui_compressor.cpp
+           ../src/gui_compressor.cpp \
+           ../src/cpu_count.cpp \
+           ../src/deflate_stream.cpp \
+           ../src/input_source.cpp \
+           ../src/parallel_batch.cpp \
+           ../src/parallel_bzip2.cpp \
+           ../src/parallel_deflate.cpp \
+           ../src/work_stealing_pool.cpp \
+           ../src/zip_archive_builder.cpp \
+           ../src/zip_stream_source.cpp \
+           ../src/zip_writer.cpp \
+           ../src/zstd_stream.cpp
 
 HEADERS += ../include/gui_mainwindow.h \
-           ../include/gui_compressor.h
+           ../include/gui_compressor.h \
+           ../include/cancellation_token.h \
+           ../include/cpu_count.h \
+           ../include/deflate_stream.h \
+           ../include/input_source.h \
+           ../include/parallel_batch.h \
+           ../include/parallel_bzip2.h \
+           ../include/parallel_deflate.h \
+           ../include/work_stealing_pool.h \
+           ../include/zip_archive_builder.h \
+           ../include/zip_stream_source.h \
+           ../include/zip_writer.h \
+           ../include/zstd_stream.h
 
 INCLUDEPATH += ../include
 
@@ -31,6 +55,20 @@ unix:!macx {
     LIBS += -lz -lzip
 }
 
+# Zstandard codec when libzstd is installed
+packagesExist(libzstd) {
+    DEFINES += HAVE_ZSTD
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libzstd
+}
+
+# Parallel bzip2 when libbz2 is installed
+packagesExist(bzip2) {
+    DEFINES += HAVE_BZIP2
+    CONFIG += link_pkgconfig
+    PKGCONFIG += bzip2
+}
+
 # Windows specific
 win32 {
     LIBS += -lzlib1
@@ -0,0 +1,32 @@
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Positional reads and writes that run in the background so several can be
+// in flight while the caller compresses. Backed by io_uring when the build has
+// liburing and the kernel allows it, by a small thread pool otherwise.
+class AsyncIo
+{
+public:
+    using Ticket = uint64_t;
+
+    static constexpr unsigned DefaultQueueDepth = 8;
+
+    virtual ~AsyncIo() = default;
+
+    // Buffers must stay valid until wait() returns for their ticket.
+    virtual Ticket submitRead(int fd, unsigned char *buffer, size_t size, uint64_t offset) = 0;
+    virtual Ticket submitWrite(int fd, const unsigned char *buffer, size_t size, uint64_t offset) = 0;
+
+    // Blocks until the request is done. Returns the bytes transferred or -errno.
+    virtual long long wait(Ticket ticket) = 0;
+
+    virtual const char *backendName() const = 0;
+
+    static std::unique_ptr<AsyncIo> create(unsigned queueDepth = DefaultQueueDepth);
+};
+
+#endif // ASYNC_IO_H
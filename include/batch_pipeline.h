@@ -0,0 +1,67 @@
+#ifndef BATCH_PIPELINE_H
+#define BATCH_PIPELINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "async_io.h"
+#include "deflate_stream.h"
+
+class CancellationToken;
+
+// Read -> deflate -> write pipeline for a batch of files. Reads for upcoming
+// chunks (including the next files) and writes of finished output stay in
+// flight on an AsyncIo backend while the current chunk is compressed, so the
+// disk and the CPU are busy at the same time.
+class BatchPipeline
+{
+public:
+    struct Job
+    {
+        std::string inputPath;
+        std::string outputPath;
+        DeflateStream::Format format = DeflateStream::Format::Gzip;
+        std::vector<unsigned char> header;      // written before the compressed data
+    };
+
+    struct JobResult
+    {
+        bool success = false;
+        uint64_t bytesIn = 0;
+        uint64_t bytesOut = 0;
+        std::string errorMessage;
+    };
+
+    struct Options
+    {
+        int level = Z_BEST_COMPRESSION;
+        size_t chunkSize = 1024 * 1024;
+        unsigned readsInFlight = 4;
+        unsigned writesInFlight = 4;
+        bool dropCache = false;     // keep batch data out of the page cache (see PageCache)
+        const CancellationToken *cancel = nullptr;     // fails the running and remaining jobs
+    };
+
+    // Called on the pipeline thread as each job completes, in job order
+    using JobCallback = std::function<void(size_t index, const JobResult &result)>;
+
+    BatchPipeline();
+    explicit BatchPipeline(const Options &options);
+    ~BatchPipeline();
+
+    std::vector<JobResult> run(const std::vector<Job> &jobs, const JobCallback &onJobFinished = nullptr);
+
+    // Buffers and codec state held while a run is in progress
+    static uint64_t memoryEstimate(const Options &options);
+
+    const char *backendName() const;
+
+private:
+    Options m_options;
+    std::unique_ptr<AsyncIo> m_io;
+};
+
+#endif // BATCH_PIPELINE_H
@@ -0,0 +1,26 @@
+#ifndef CANCELLATION_TOKEN_H
+#define CANCELLATION_TOKEN_H
+
+#include <atomic>
+
+// Cooperative stop flag shared by whoever drives a compression (a window, a
+// batch) and the engines doing the work. Engines poll it between blocks of a
+// few hundred KiB at most, fail with CancelledMessage and remove the partial
+// output they were writing.
+class CancellationToken
+{
+public:
+    static constexpr const char *CancelledMessage = "Compresión cancelada";
+
+    void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+    void reset() { m_cancelled.store(false, std::memory_order_relaxed); }
+    bool isCancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+
+    // Null tokens are never cancelled
+    static bool cancelled(const CancellationToken *token) { return token && token->isCancelled(); }
+
+private:
+    std::atomic<bool> m_cancelled{false};
+};
+
+#endif // CANCELLATION_TOKEN_H
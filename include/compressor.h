@@ -19,7 +19,8 @@ public:
     explicit Compressor(QObject *parent = nullptr);
     ~Compressor();
 
-    // Compression methods
+    // Compression methods ("zip", "gzip", "zstd" for a .zst file, "xz" for an
+    // .xz file or "store" for an uncompressed copy)
     CompressionResult compressFile(const QString &inputPath, const QString &outputPath, const QString &compressionType = "zip");
     QList<CompressionResult> compressMultipleFiles(const QStringList &filePaths, const QString &outputDir, const QString &compressionType = "zip");
 
@@ -27,6 +28,63 @@ public:
     using ProgressCallback = std::function<void(const QString&, int)>;
     void setProgressCallback(ProgressCallback callback);
 
+    // Chunk size for the streaming ZIP/GZIP paths (memory stays flat at roughly twice this)
+    void setBufferSize(size_t bytes);
+    size_t bufferSize() const;
+
+    // Threads used by the block-parallel ZIP/GZIP paths (0 = CPUs available to the process)
+    void setThreadCount(unsigned threads);
+    unsigned threadCount() const;
+
+    // Zstandard level (1-22) for the "zstd" type; single files also use the
+    // thread count above as libzstd workers
+    void setZstdLevel(int level);
+    int zstdLevel() const;
+
+    // Long-distance matching (128 MiB window) for the "zstd" type
+    void setLongDistanceMatching(bool enabled);
+    bool longDistanceMatching() const;
+
+    // xz preset (0-9, default 9) for the "xz" type; single files use the
+    // thread count above with liblzma's multithreaded encoder
+    void setXzLevel(int level);
+    int xzLevel() const;
+
+    // Input bytes per xz block, one block per thread at a time (0 = liblzma
+    // default, three times the dictionary size)
+    void setXzBlockSize(quint64 bytes);
+    quint64 xzBlockSize() const;
+
+    // Encoder memory one "xz" file takes with the current settings; grows
+    // with threads and block size (several GiB at level 9 on many cores)
+    quint64 xzMemoryEstimate() const;
+
+    // Worker threads for compressMultipleFiles (0 = CPUs available to the
+    // process, honouring affinity and cgroup quotas). Largest files start
+    // first and large ZIP/GZIP files are split into blocks the workers share.
+    void setWorkerCount(unsigned workers);
+    unsigned workerCount() const;
+
+    // Estimated bytes compressMultipleFiles may hold at once across its
+    // workers (0 = no limit); files wait for room before they start. A
+    // single "xz" file runs with fewer threads to fit, or fails if even
+    // one thread needs more
+    void setMemoryBudget(quint64 bytes);
+    quint64 memoryBudget() const;
+
+    // Highest estimated usage reached by the last compressMultipleFiles call
+    quint64 peakMemory() const;
+
+    // Stops the running compressFile/compressMultipleFiles call from any
+    // thread: engines check between blocks, unfinished outputs are removed
+    // and the remaining files fail with "Compresión cancelada"
+    void cancel();
+
+    // Clears a previous cancel(). Call it on the thread that starts a run,
+    // before handing the run to a worker thread, so a cancel issued while
+    // the run is still queued is not lost
+    void resetCancellation();
+
 signals:
     void progressUpdated(const QString &message, int percentage);
     void compressionFinished(const QList<CompressionResult> &results);
@@ -34,6 +92,7 @@ signals:
 
 private:
     // Private compression methods
+    CompressionResult compressSingleFile(const QString &inputPath, const QString &outputPath, const QString &compressionType);
     CompressionResult compressImage(const QString &inputPath, const QString &outputPath);
     CompressionResult compressPDF(const QString &inputPath, const QString &outputPath);
     CompressionResult compressGeneralFile(const QString &inputPath, const QString &outputPath, const QString &compressionType);
@@ -45,6 +104,7 @@ private:
     qint64 getFileSize(const QString &filePath) const;
     double calculateCompressionRatio(qint64 originalSize, qint64 compressedSize) const;
     void updateProgress(const QString &message, int percentage);
+    void updateFileProgress(const QString &message, int percentage);
 
     // Member variables
     ProgressCallback m_progressCallback;
@@ -62,6 +122,7 @@ struct CompressionResult
     qint64 compressedSize = 0;
     double compressionRatio = 0.0;
     QString errorMessage;
+    quint64 memoryUsage = 0;        // encoder memory actually set up ("xz" only, else 0)
 
     CompressionResult() = default;
     CompressionResult(bool s, const QString &f, const QString &o, qint64 orig, qint64 comp, double ratio)
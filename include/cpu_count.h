@@ -0,0 +1,52 @@
+#ifndef CPU_COUNT_H
+#define CPU_COUNT_H
+
+#include <string>
+#include <vector>
+
+// Number of CPUs this process can actually use. Inside containers
+// std::thread::hardware_concurrency() reports the host's cores; this also
+// honours the affinity mask and cgroup CPU quotas (v2 cpu.max, v1 CFS).
+class CpuCount
+{
+public:
+    // Worker count to use by default (at least 1)
+    static unsigned available();
+
+    // CPUs in the scheduler affinity mask (0 if unknown)
+    static unsigned affinity();
+
+    // cgroup CPU quota in CPUs, e.g. 2.5; 0 when there is no limit
+    static double cgroupQuota();
+
+    // CPUs in the affinity mask. With libnuma they are grouped by node, so
+    // workers pinned in order fill one node before spilling to the next.
+    static std::vector<unsigned> allowedCpus();
+
+    // NUMA nodes the allowed CPUs belong to (1 without libnuma)
+    static unsigned numaNodes();
+
+    // One line for run summaries, e.g. "4 de 64 CPUs (afinidad 64, cuota cgroup 4.0)"
+    static std::string summary();
+
+    // Pins the calling thread to allowedCpus()[worker % count] for its
+    // lifetime and then restores the previous mask. Does nothing where
+    // affinity cannot be set.
+    class ThreadPin
+    {
+    public:
+        explicit ThreadPin(unsigned worker);
+        ~ThreadPin();
+
+        ThreadPin(const ThreadPin &) = delete;
+        ThreadPin &operator=(const ThreadPin &) = delete;
+
+        bool pinned() const { return m_pinned; }
+
+    private:
+        std::vector<unsigned> m_previous;
+        bool m_pinned;
+    };
+};
+
+#endif // CPU_COUNT_H
@@ -0,0 +1,91 @@
+#ifndef DEFLATE_STREAM_H
+#define DEFLATE_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+class CancellationToken;
+
+// Chunked z_stream wrapper. Input is fed in fixed-size buffers and output is
+// handed to a sink as it is produced, so memory stays constant no matter how
+// large the file is.
+class DeflateStream
+{
+public:
+    enum class Format
+    {
+        Zlib,   // RFC 1950 (what qCompress/compress2 produce, without the size prefix)
+        Gzip,   // RFC 1952
+        Raw     // RFC 1951, no header or trailer
+    };
+
+    // Receives each piece of compressed output. Returning false aborts the stream.
+    using Sink = std::function<bool(const unsigned char *data, size_t size)>;
+
+    // Called after every input chunk with the bytes consumed so far (total_in).
+    using ProgressCallback = std::function<void(uint64_t bytesIn, uint64_t totalBytes)>;
+
+    static constexpr size_t DefaultBufferSize = 256 * 1024;
+
+    // What zlib allocates for windowBits 15 / memLevel 8: a 64 KiB window
+    // pair, 128 KiB of hash chains and the pending buffer
+    static constexpr size_t StateSize = 272 * 1024;
+
+    // Heap used by one stream with the given output buffer
+    static uint64_t memoryEstimate(size_t bufferSize = DefaultBufferSize) { return StateSize + bufferSize; }
+
+    explicit DeflateStream(Format format = Format::Zlib, int level = Z_BEST_COMPRESSION,
+                           size_t bufferSize = DefaultBufferSize);
+    ~DeflateStream();
+
+    DeflateStream(const DeflateStream &) = delete;
+    DeflateStream &operator=(const DeflateStream &) = delete;
+
+    // Low-level interface: feed input, then finish once.
+    bool write(const unsigned char *data, size_t size, const Sink &sink);
+    bool finish(const Sink &sink);
+
+    // Z_SYNC_FLUSH: ends on a byte boundary so independently produced pieces
+    // can be concatenated into one stream.
+    bool flush(const Sink &sink);
+
+    // Primes the window with data that precedes this stream's input.
+    bool setDictionary(const unsigned char *data, size_t size);
+
+    // Checked before every buffer-sized slice of input; once cancelled,
+    // write() fails and compressFile() removes its output.
+    void setCancellationToken(const CancellationToken *token) { m_cancel = token; }
+
+    // Streams a whole file. If header is not empty it is written to the output
+    // before the compressed data.
+    bool compressFile(const std::string &inputPath, const std::string &outputPath,
+                      const ProgressCallback &progress = nullptr,
+                      const std::vector<unsigned char> &header = {});
+
+    uint64_t totalIn() const { return m_totalIn; }
+    uint64_t totalOut() const { return m_totalOut; }
+    // CRC32 of the input, for containers that wrap Raw output themselves
+    uint32_t crc() const { return m_crc; }
+    size_t bufferSize() const { return m_bufferSize; }
+    const std::string &errorMessage() const { return m_errorMessage; }
+
+private:
+    bool deflateBuffer(const unsigned char *data, size_t size, int flush, const Sink &sink);
+
+    z_stream m_stream;
+    bool m_initialized;
+    bool m_finished;
+    size_t m_bufferSize;
+    std::vector<unsigned char> m_outBuffer;
+    uint64_t m_totalIn;
+    uint64_t m_totalOut;
+    uint32_t m_crc;
+    const CancellationToken *m_cancel;
+    std::string m_errorMessage;
+};
+
+#endif // DEFLATE_STREAM_H
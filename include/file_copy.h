@@ -0,0 +1,56 @@
+#ifndef FILE_COPY_H
+#define FILE_COPY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+class CancellationToken;
+
+// Copies a file without compressing it, keeping the data out of user space
+// where the kernel allows: a reflink (FICLONE), then copy_file_range, then
+// sendfile, and finally a plain read()/write() loop.
+class FileCopy
+{
+public:
+    enum class Method
+    {
+        None,
+        Reflink,
+        CopyFileRange,
+        Sendfile,
+        ReadWrite
+    };
+
+    using ProgressCallback = std::function<void(uint64_t bytesCopied, uint64_t totalBytes)>;
+
+    static constexpr size_t ChunkSize = 8 * 1024 * 1024;
+
+    FileCopy();
+
+    // A failed or cancelled copy removes the output
+    bool copy(const std::string &inputPath, const std::string &outputPath,
+              const ProgressCallback &progress = nullptr);
+
+    // Checked between chunks
+    void setCancellationToken(const CancellationToken *token) { m_cancel = token; }
+
+    uint64_t bytesCopied() const { return m_bytesCopied; }
+    Method method() const { return m_method; }
+    const std::string &errorMessage() const { return m_errorMessage; }
+
+    static const char *methodName(Method method);
+
+private:
+    bool copyRanges(int inputFd, int outputFd, uint64_t totalBytes, const ProgressCallback &progress);
+    bool copyReadWrite(int inputFd, int outputFd, uint64_t totalBytes, const ProgressCallback &progress);
+    bool cancelled();
+
+    uint64_t m_bytesCopied;
+    Method m_method;
+    const CancellationToken *m_cancel;
+    std::string m_errorMessage;
+};
+
+#endif // FILE_COPY_H
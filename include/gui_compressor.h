@@ -1,15 +1,19 @@
 #ifndef GUI_COMPRESSOR_H
 #define GUI_COMPRESSOR_H
 
+#include <cstdint>
 #include <string>
+#include <vector>
+
+class CancellationToken;
 
 struct CompressionResult
 {
     bool success = false;
     std::string filename;
     std::string outputPath;
-    size_t originalSize = 0;
-    size_t compressedSize = 0;
+    uint64_t originalSize = 0;
+    uint64_t compressedSize = 0;
     double compressionRatio = 0.0;
     std::string errorMessage;
 };
@@ -17,14 +21,37 @@ struct CompressionResult
 class PureCppCompressor
 {
 public:
-    static CompressionResult compressFile(const std::string &inputPath, const std::string &outputPath);
+    // cancel may be set from another thread; the engines stop at their next
+    // block and the partial output is removed
+    static CompressionResult compressFile(const std::string &inputPath, const std::string &outputPath,
+                                          const CancellationToken *cancel = nullptr);
+
+    // One ZIP archive for every input (directories recursively); entries are
+    // deflated in parallel and unreadable ones are listed in failures
+    static CompressionResult compressToArchive(const std::vector<std::string> &inputPaths,
+                                               const std::string &outputPath,
+                                               std::vector<CompressionResult> *failures = nullptr,
+                                               const CancellationToken *cancel = nullptr);
+
+    // Standard .bz2 stream (".bz2" is appended unless outputPath has it);
+    // the 900 kB blocks are compressed in parallel
+    static CompressionResult compressToBzip2(const std::string &inputPath, const std::string &outputPath,
+                                             const CancellationToken *cancel = nullptr);
 
 private:
-    static CompressionResult compressTextFile(const std::string &inputPath, const std::string &outputPath);
-    static CompressionResult compressBinaryFile(const std::string &inputPath, const std::string &outputPath);
-    static CompressionResult compressPDF(const std::string &inputPath, const std::string &outputPath);
-    static CompressionResult compressToZip(const std::string &inputPath, const std::string &outputPath);
-    static CompressionResult compressImage(const std::string &inputPath, const std::string &outputPath);
+    static CompressionResult compressTextFile(const std::string &inputPath, const std::string &outputPath,
+                                              const CancellationToken *cancel);
+    static CompressionResult compressBinaryFile(const std::string &inputPath, const std::string &outputPath,
+                                                const CancellationToken *cancel);
+    static CompressionResult compressPDF(const std::string &inputPath, const std::string &outputPath,
+                                         const CancellationToken *cancel);
+    static CompressionResult compressToZip(const std::string &inputPath, const std::string &outputPath,
+                                           const CancellationToken *cancel);
+    static CompressionResult compressImage(const std::string &inputPath, const std::string &outputPath,
+                                           const CancellationToken *cancel);
+
+    // Space saved in percent; negative when the output grew, 0 for empty inputs
+    static double compressionRatio(uint64_t originalSize, uint64_t compressedSize);
 };
 
 #endif // GUI_COMPRESSOR_H
@@ -17,10 +17,16 @@
 #include <QDropEvent>
 #include <QVBoxLayout>
 #include <QStatusBar>
+#include <QMetaType>
+#include <QThread>
 
 // Include the compressor header
+#include "cancellation_token.h"
 #include "gui_compressor.h"
 
+// Results travel from the compression thread to the window by queued signals
+Q_DECLARE_METATYPE(CompressionResult)
+
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -40,6 +46,12 @@ private slots:
     void startCompression();
     void stopCompression();
     void clearResults();
+    void onFileCompressed(const CompressionResult &result, const QString &fileName);
+    void onCompressionFinished();
+
+signals:
+    // Emitted from the compression thread
+    void fileCompressed(const CompressionResult &result, const QString &fileName);
 
 private:
     void setupUI();
@@ -53,8 +65,12 @@ private:
     void createStatusBar();
 
     void compressFiles();
+
+    // Run on the compression thread: no widget access, results go out as fileCompressed
+    void compressBatch(const QStringList &files, const QString &outputDirectory, bool bzip2);
+    void compressToArchive(const QStringList &files, const QString &outputDirectory);
     void addResultToTable(const CompressionResult &result, const QString &fileName);
-    QString formatFileSize(size_t bytes);
+    QString formatFileSize(uint64_t bytes);
     void updateStatus();
     void loadSettings();
     void saveSettings();
@@ -83,6 +99,9 @@ private:
     QStringList m_selectedFiles;
     QString m_outputDirectory;
     bool m_isCompressing;
+    CancellationToken m_cancel;     // set by Detener, read by the running engines
+    QThread *m_compressionThread;
+    int m_filesCompressed;
 };
 
 #endif // GUI_MAINWINDOW_H
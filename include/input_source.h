@@ -0,0 +1,64 @@
+#ifndef INPUT_SOURCE_H
+#define INPUT_SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Read-only view of an input file shared by the compress paths. Regular files
+// are mapped with mmap (MADV_SEQUENTIAL); pipes and special files fall back to
+// large-block read() calls.
+class InputSource
+{
+public:
+    static constexpr size_t ReadBlockSize = 1024 * 1024;
+
+    InputSource();
+    ~InputSource();
+
+    InputSource(const InputSource &) = delete;
+    InputSource &operator=(const InputSource &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+
+    bool isOpen() const { return m_fd >= 0; }
+    bool isMapped() const { return m_map != nullptr; }
+
+    // Whole input as one contiguous range. Free for mapped files; unmapped
+    // inputs are drained into memory on first use.
+    const unsigned char *data();
+    uint64_t size();
+
+    // Sequential reads from the current position. Returns 0 at end of input
+    // and -1 on error.
+    long long read(unsigned char *buffer, size_t size);
+
+    // Moves back to the start of the input. Fails for pipes already consumed.
+    bool rewind();
+
+    // Asks the kernel to start reading a range that will be needed soon
+    // (mapped inputs only).
+    void willNeed(uint64_t offset, uint64_t length);
+
+    uint64_t position() const { return m_position; }
+
+    // Size known up front (regular files), 0 for pipes and special files
+    uint64_t knownSize() const { return m_size; }
+    int fileDescriptor() const { return m_fd; }
+    const std::string &errorMessage() const { return m_errorMessage; }
+
+private:
+    bool loadRemaining();
+
+    int m_fd;
+    void *m_map;
+    uint64_t m_size;
+    uint64_t m_position;
+    bool m_loaded;
+    std::vector<unsigned char> m_buffer;
+    std::string m_errorMessage;
+};
+
+#endif // INPUT_SOURCE_H
@@ -0,0 +1,86 @@
+#ifndef LZ4_STREAM_H
+#define LZ4_STREAM_H
+
+#include "deflate_stream.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CancellationToken;
+struct LZ4F_cctx_s;
+
+// Chunked LZ4 compressor with the same shape as DeflateStream and ZstdStream:
+// input is fed in buffers and the pieces of one LZ4 frame (.lz4, readable by
+// lz4 -d) go to a sink.
+//
+// Level 0 is the fast LZ4 path, several GB/s on one core at a ratio well
+// below deflate; FastestLevel (negative) trades more ratio for speed.
+// Levels HcMinLevel..MaxLevel switch to LZ4-HC, slower to compress but just
+// as fast to decompress. Blocks are 4 MiB and independent, as with the lz4
+// command, and the frame carries a content checksum.
+//
+// Only built with HAVE_LZ4; otherwise available() is false and every call
+// fails with an error message.
+class Lz4Stream
+{
+public:
+    static constexpr int FastestLevel = -16;    // acceleration 16
+    static constexpr int FastLevel = 0;
+    static constexpr int HcMinLevel = 3;
+    static constexpr int HcDefaultLevel = 9;
+    static constexpr int MaxLevel = 12;
+
+    struct Options
+    {
+        int level = FastLevel;          // clamped to FastestLevel..MaxLevel
+    };
+
+    static bool available();
+
+    // Approximate heap used by one stream with these options
+    static uint64_t memoryEstimate(const Options &options);
+
+    Lz4Stream();
+    explicit Lz4Stream(const Options &options, size_t bufferSize = DeflateStream::DefaultBufferSize);
+    ~Lz4Stream();
+
+    Lz4Stream(const Lz4Stream &) = delete;
+    Lz4Stream &operator=(const Lz4Stream &) = delete;
+
+    // Records the size in the frame header; call before the first write()
+    void setExpectedSize(uint64_t size);
+
+    bool write(const unsigned char *data, size_t size, const DeflateStream::Sink &sink);
+    bool finish(const DeflateStream::Sink &sink);
+
+    // Checked before every buffer-sized slice of input, as in DeflateStream
+    void setCancellationToken(const CancellationToken *token) { m_cancel = token; }
+
+    // Streams a whole file into a .lz4 file; a failed or cancelled run
+    // removes the output
+    bool compressFile(const std::string &inputPath, const std::string &outputPath,
+                      const DeflateStream::ProgressCallback &progress = nullptr);
+
+    uint64_t totalIn() const { return m_totalIn; }
+    uint64_t totalOut() const { return m_totalOut; }
+    const std::string &errorMessage() const { return m_errorMessage; }
+
+private:
+    bool begin(const DeflateStream::Sink &sink);
+    bool emit(size_t result, const DeflateStream::Sink &sink);
+
+    LZ4F_cctx_s *m_context;
+    Options m_options;
+    bool m_started;
+    bool m_finished;
+    size_t m_bufferSize;
+    uint64_t m_expectedSize;
+    std::vector<unsigned char> m_outBuffer;
+    uint64_t m_totalIn;
+    uint64_t m_totalOut;
+    const CancellationToken *m_cancel;
+    std::string m_errorMessage;
+};
+
+#endif // LZ4_STREAM_H
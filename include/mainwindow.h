@@ -15,10 +15,11 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QThread>
+#include <QFutureWatcher>
 #include <QCheckBox>
 #include <QSlider>
 #include <QSpinBox>
-#include "gui_compressor.h"
+#include "compressor.h"
 
 class MainWindow : public QMainWindow
 {
@@ -33,6 +34,7 @@ private slots:
     void clearFiles();
     void selectOutputDirectory();
     void startCompression();
+    void cancelCompression();
     void onCompressionFinished(const QList<CompressionResult> &results);
     void onErrorOccurred(const QString &error);
     void onProgressUpdated(const QString &message, int percentage);
@@ -66,6 +68,9 @@ private:
     QButtonGroup *m_compressionTypeGroup;
     QRadioButton *m_zipRadioButton;
     QRadioButton *m_gzipRadioButton;
+    QRadioButton *m_zstdRadioButton;
+    QRadioButton *m_xzRadioButton;
+    QRadioButton *m_storeRadioButton;
 
     // Optimization options
     QGroupBox *m_optimizationGroup;
@@ -85,6 +90,7 @@ private:
 
     // Control buttons
     QPushButton *m_compressButton;
+    QPushButton *m_cancelButton;
     QPushButton *m_exitButton;
 
     // Data
@@ -92,8 +98,9 @@ private:
     QString m_outputDirectory;
 
     // Compressor
-    // Compressor *m_compressor;
+    Compressor *m_compressor;
     QThread *m_compressorThread;
+    QFutureWatcher<QList<CompressionResult>> *m_compressionWatcher;
 };
 
 #endif // MAINWINDOW_H
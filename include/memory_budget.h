@@ -0,0 +1,65 @@
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Admission control for concurrent jobs. Each job is charged an estimate of
+// the memory it will hold (input, output and codec state) before it starts;
+// acquire() blocks until the charge fits under the limit, so many workers
+// cannot pile up large buffers at once. A job bigger than the whole budget
+// is admitted only when nothing else is running.
+//
+// Workers of a WorkStealingPool keep stealing block tasks while they wait.
+class MemoryBudget
+{
+public:
+    explicit MemoryBudget(uint64_t limit = 0);     // 0 = no limit, usage is still tracked
+
+    MemoryBudget(const MemoryBudget &) = delete;
+    MemoryBudget &operator=(const MemoryBudget &) = delete;
+
+    void acquire(uint64_t bytes);
+    void release(uint64_t bytes);
+
+    uint64_t limit() const { return m_limit; }
+    uint64_t inUse() const;
+    uint64_t peak() const;
+
+    // "4G", "512M", "64k", "1.5GiB" or plain bytes (binary units). Returns
+    // false for anything else.
+    static bool parseSize(const std::string &text, uint64_t &bytes);
+
+    // Charges a job for as long as the object lives
+    class Reservation
+    {
+    public:
+        Reservation(MemoryBudget &budget, uint64_t bytes)
+            : m_budget(budget)
+            , m_bytes(bytes)
+        {
+            m_budget.acquire(m_bytes);
+        }
+        ~Reservation() { m_budget.release(m_bytes); }
+
+        Reservation(const Reservation &) = delete;
+        Reservation &operator=(const Reservation &) = delete;
+
+    private:
+        MemoryBudget &m_budget;
+        uint64_t m_bytes;
+    };
+
+private:
+    bool tryAcquire(uint64_t bytes);
+
+    uint64_t m_limit;
+    uint64_t m_inUse;
+    uint64_t m_peak;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+
+#endif // MEMORY_BUDGET_H
@@ -0,0 +1,29 @@
+#ifndef PAGE_CACHE_H
+#define PAGE_CACHE_H
+
+#include <cstdint>
+
+// Page cache hints for large batch jobs that should not push other services'
+// data out of memory. Input is read ahead with posix_fadvise and dropped once
+// consumed; output is flushed with sync_file_range and then dropped. All calls
+// are best effort and do nothing where the platform lacks them.
+class PageCache
+{
+public:
+    // Whole-file sequential access (larger kernel readahead window)
+    static void adviseSequential(int fd);
+
+    // Starts reading a range that will be needed soon
+    static void willNeed(int fd, uint64_t offset, uint64_t length);
+
+    // Evicts input pages that have already been consumed
+    static void dropInput(int fd, uint64_t offset, uint64_t length);
+
+    // Queues writeback of freshly written pages without waiting for it
+    static void startWriteback(int fd, uint64_t offset, uint64_t length);
+
+    // Waits for writeback of a range and evicts it (clean pages only)
+    static void dropOutput(int fd, uint64_t offset, uint64_t length);
+};
+
+#endif // PAGE_CACHE_H
@@ -0,0 +1,39 @@
+#ifndef PARALLEL_BATCH_H
+#define PARALLEL_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Runs a batch of independent tasks on a bounded set of worker threads.
+// Tasks are started largest first on a WorkStealingPool, so the biggest file
+// is not the last one left running. Tasks for large files may split their
+// work into blocks (ParallelDeflate does so inside a pool) that idle workers
+// steal. Results are written by the tasks into slots indexed by task, which
+// keeps them in input order.
+class ParallelBatch
+{
+public:
+    // Files at least this big are worth splitting into block tasks
+    static constexpr uint64_t SplitThreshold = 8 * 1024 * 1024;
+
+    // index of the task, worker running it (0 .. workerCount() - 1).
+    // Tasks run on worker threads and must not throw.
+    using Task = std::function<void(size_t index, unsigned worker)>;
+
+    // workers 0 = CpuCount::available(); pinWorkers binds each worker to one CPU
+    explicit ParallelBatch(unsigned workers = 0, bool pinWorkers = false);
+
+    // Blocks until every task has run. sizes (bytes per task, optional)
+    // decides the start order; without it tasks start in index order.
+    void run(size_t taskCount, const Task &task, const std::vector<uint64_t> &sizes = {});
+
+    unsigned workerCount() const { return m_workers; }
+
+private:
+    unsigned m_workers;
+    bool m_pinWorkers;
+};
+
+#endif // PARALLEL_BATCH_H
@@ -0,0 +1,68 @@
+#ifndef PARALLEL_BZIP2_H
+#define PARALLEL_BZIP2_H
+
+#include "deflate_stream.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class CancellationToken;
+class InputSource;
+
+// Block-parallel bzip2 engine (lbzip2 layout). bzip2 blocks are independent
+// by design, so the input is cut into pieces that each fill exactly one
+// block, the pieces are compressed on several threads with libbz2, and the
+// blocks are spliced bit by bit into one standard .bz2 stream that bzip2 -d
+// reads like its own output.
+//
+// A piece ends where libbz2's first run-length stage would fill the block
+// (level x 100 kB), so every compressed piece holds one block whose bits are
+// copied between the stream header and the end-of-stream marker. The stream
+// CRC is rebuilt from the block CRCs as bzip2 does (rotate left 1, xor).
+//
+// Only built with HAVE_BZIP2; otherwise available() is false and every call
+// fails with an error message.
+class ParallelBzip2
+{
+public:
+    static constexpr int MinLevel = 1;
+    static constexpr int MaxLevel = 9;
+
+    struct Options
+    {
+        int level = MaxLevel;               // block size in 100 kB, clamped to MinLevel..MaxLevel
+        unsigned threads = 0;               // 0 = CpuCount::available()
+        const CancellationToken *cancel = nullptr;     // checked per block
+    };
+
+    static bool available();
+
+    ParallelBzip2();
+    explicit ParallelBzip2(const Options &options);
+
+    // Reads the input from its current position to the end
+    bool compress(InputSource &input, const DeflateStream::Sink &sink,
+                  const DeflateStream::ProgressCallback &progress = nullptr);
+
+    // File to file; a failed or cancelled run removes the output
+    bool compressFile(const std::string &inputPath, const std::string &outputPath,
+                      const DeflateStream::ProgressCallback &progress = nullptr);
+
+    uint64_t totalIn() const { return m_totalIn; }
+    uint64_t totalOut() const { return m_totalOut; }
+    uint32_t crc() const { return m_crc; }
+    uint64_t blockCount() const { return m_blocks; }
+    unsigned threadCount() const;
+
+    const std::string &errorMessage() const { return m_errorMessage; }
+
+private:
+    Options m_options;
+    uint64_t m_totalIn;
+    uint64_t m_totalOut;
+    uint32_t m_crc;
+    uint64_t m_blocks;
+    std::string m_errorMessage;
+};
+
+#endif // PARALLEL_BZIP2_H
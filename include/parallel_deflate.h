@@ -0,0 +1,76 @@
+#ifndef PARALLEL_DEFLATE_H
+#define PARALLEL_DEFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "deflate_stream.h"
+
+class CancellationToken;
+class InputSource;
+
+// Block-parallel deflate engine (pigz layout). The input is cut into blocks
+// that are deflated on several threads and handed to the sink in order.
+//
+// The blocks form one deflate stream: each block is primed with the previous
+// 32 KiB as a dictionary and ends on a sync flush, so the ratio stays close
+// to single-threaded output. The CRC-32 and Adler-32 of the whole input are
+// joined from per-block values with crc32_combine and adler32_combine, which
+// gives the zlib and gzip trailers (format) or a ZIP entry's CRC (Raw).
+// independentBlocks turns every block into its own gzip member instead.
+class ParallelDeflate
+{
+public:
+    struct Options
+    {
+        int level = Z_BEST_COMPRESSION;
+        size_t blockSize = 1024 * 1024;     // clamped to 32 KiB .. 64 MiB
+        unsigned threads = 0;               // 0 = CpuCount::available()
+        DeflateStream::Format format = DeflateStream::Format::Raw;
+        bool independentBlocks = false;     // Gzip only: one member per block, no priming
+        const CancellationToken *cancel = nullptr;     // checked per block and per 64 KiB slice
+    };
+
+    // Sizes of one gzip member, in output order (independentBlocks only)
+    struct Member
+    {
+        uint64_t compressedSize = 0;
+        uint64_t uncompressedSize = 0;
+    };
+
+    ParallelDeflate();
+    explicit ParallelDeflate(const Options &options);
+
+    // Reads the input from its current position to the end
+    bool compress(InputSource &input, const DeflateStream::Sink &sink,
+                  const DeflateStream::ProgressCallback &progress = nullptr);
+
+    // File to file; header bytes (e.g. a qCompress size prefix) go first
+    bool compressFile(const std::string &inputPath, const std::string &outputPath,
+                      const DeflateStream::ProgressCallback &progress = nullptr,
+                      const std::vector<unsigned char> &header = {});
+
+    uint64_t totalIn() const { return m_totalIn; }
+    uint64_t totalOut() const { return m_totalOut; }
+    uint32_t crc() const { return m_crc; }
+    uint32_t adler() const { return m_adler; }
+    const std::vector<Member> &members() const { return m_members; }
+    unsigned threadCount() const;
+
+    // Blocks in flight (input, dictionary, output) and one zlib state per thread
+    uint64_t memoryEstimate() const;
+
+    const std::string &errorMessage() const { return m_errorMessage; }
+
+private:
+    Options m_options;
+    uint64_t m_totalIn;
+    uint64_t m_totalOut;
+    uint32_t m_crc;
+    uint32_t m_adler;
+    std::vector<Member> m_members;
+    std::string m_errorMessage;
+};
+
+#endif // PARALLEL_DEFLATE_H
@@ -0,0 +1,55 @@
+#ifndef PARALLEL_GZIP_H
+#define PARALLEL_GZIP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "deflate_stream.h"
+
+class CancellationToken;
+
+// RFC 1952 gzip writer on top of ParallelDeflate: the input is split into
+// blocks deflated on several threads and written back in order, so memory is
+// bounded by the number of blocks in flight rather than the file size.
+class ParallelGzipWriter
+{
+public:
+    enum class Mode
+    {
+        // Every block is a complete gzip member (header, data, trailer).
+        IndependentMembers,
+        // One member; each block is primed with the previous 32 KiB and the
+        // per-block CRCs are joined with crc32_combine (pigz layout).
+        DictionaryPrimed
+    };
+
+    struct Options
+    {
+        int level = Z_BEST_COMPRESSION;
+        size_t blockSize = 1024 * 1024;
+        unsigned threads = 0;   // 0 = CpuCount::available()
+        Mode mode = Mode::DictionaryPrimed;
+        const CancellationToken *cancel = nullptr;
+    };
+
+    ParallelGzipWriter();
+    explicit ParallelGzipWriter(const Options &options);
+
+    bool compressFile(const std::string &inputPath, const std::string &outputPath,
+                      const DeflateStream::ProgressCallback &progress = nullptr);
+
+    uint64_t totalIn() const { return m_totalIn; }
+    uint64_t totalOut() const { return m_totalOut; }
+    uint32_t crc() const { return m_crc; }
+    unsigned threadCount() const;
+    const std::string &errorMessage() const { return m_errorMessage; }
+
+private:
+    Options m_options;
+    uint64_t m_totalIn;
+    uint64_t m_totalOut;
+    uint32_t m_crc;
+    std::string m_errorMessage;
+};
+
+#endif // PARALLEL_GZIP_H
@@ -0,0 +1,114 @@
+#ifndef SEEKABLE_GZIP_H
+#define SEEKABLE_GZIP_H
+
+#include "deflate_stream.h"
+#include "parallel_deflate.h"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class CancellationToken;
+class InputSource;
+
+// Seekable .gz layout for large logs read in pieces. The input is cut into
+// blocks, each compressed as its own gzip member (deflated in parallel by
+// ParallelDeflate), and an index of member sizes is appended as empty gzip
+// members whose FEXTRA field carries an "SX" subfield:
+//
+//   data members | index members ('I': up to 8000 pairs of LE32 compressed
+//   and uncompressed sizes each) | footer member ('F', version, LE64 block
+//   count, total input size and size of the index members)
+//
+// The footer has a fixed size, so a reader finds the index from the end of
+// the file. Empty members decompress to nothing: gzip -d, zcat and zlib see
+// an ordinary multi-member file with the original contents.
+class SeekableGzipWriter
+{
+public:
+    struct Options
+    {
+        int level = Z_BEST_COMPRESSION;
+        size_t blockSize = 1024 * 1024;     // bytes a range read may have to inflate
+        unsigned threads = 0;               // 0 = CpuCount::available()
+        const CancellationToken *cancel = nullptr;
+    };
+
+    SeekableGzipWriter();
+    explicit SeekableGzipWriter(const Options &options);
+
+    // Reads the input from its current position to the end
+    bool compress(InputSource &input, const DeflateStream::Sink &sink,
+                  const DeflateStream::ProgressCallback &progress = nullptr);
+
+    // File to file; a failed or cancelled run removes the output
+    bool compressFile(const std::string &inputPath, const std::string &outputPath,
+                      const DeflateStream::ProgressCallback &progress = nullptr);
+
+    uint64_t totalIn() const { return m_totalIn; }
+    uint64_t totalOut() const { return m_totalOut; }
+    uint64_t blockCount() const { return m_blocks; }
+
+    // What ParallelDeflate keeps in flight for these options
+    uint64_t memoryEstimate() const;
+
+    const std::string &errorMessage() const { return m_errorMessage; }
+
+private:
+    ParallelDeflate::Options deflateOptions() const;
+
+    Options m_options;
+    uint64_t m_totalIn;
+    uint64_t m_totalOut;
+    uint64_t m_blocks;
+    std::string m_errorMessage;
+};
+
+// Random access to a file written by SeekableGzipWriter. open() reads only
+// the index; read() inflates just the members the range overlaps and keeps
+// the last one, so sequential small reads inflate each member once.
+// Not thread-safe: use one reader per thread.
+class SeekableGzipReader
+{
+public:
+    SeekableGzipReader();
+
+    bool open(const std::string &path);
+    void close();
+
+    // Uncompressed size of the whole file
+    uint64_t size() const { return m_starts.empty() ? 0 : m_starts.back(); }
+    uint64_t blockCount() const { return m_sizes.size(); }
+
+    // Copies up to size bytes starting at offset; returns the bytes copied
+    // (less than size only past the end) or -1 on error
+    long long read(uint64_t offset, unsigned char *data, size_t size);
+
+    // Members inflated so far, to check how much a range read touched
+    uint64_t blocksInflated() const { return m_blocksInflated; }
+
+    const std::string &errorMessage() const { return m_errorMessage; }
+
+private:
+    struct BlockSize
+    {
+        uint32_t compressed;
+        uint32_t uncompressed;
+    };
+
+    bool readIndex(uint64_t fileSize);
+    bool inflateBlock(size_t index);
+
+    std::ifstream m_file;
+    std::vector<BlockSize> m_sizes;
+    std::vector<uint64_t> m_offsets;    // file offset of each member
+    std::vector<uint64_t> m_starts;     // uncompressed offset of each member, plus the total
+    size_t m_cachedBlock;
+    std::vector<unsigned char> m_cache;
+    std::vector<unsigned char> m_compressed;
+    uint64_t m_blocksInflated;
+    std::string m_errorMessage;
+};
+
+#endif // SEEKABLE_GZIP_H
@@ -0,0 +1,100 @@
+#ifndef SHARD_QUEUE_H
+#define SHARD_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// File-based work queue that lets several processes, on one host or on many
+// hosts sharing a directory (NFS), split a long list of files between them
+// without any service running.
+//
+// The coordinator writes the list as numbered shards under shards/. A worker
+// claims a shard by creating leases/<shard>.lease with O_EXCL, keeps it alive
+// by touching it (renew()), and acknowledges it by renaming a report into
+// done/ before dropping the lease. A lease not touched for leaseSeconds
+// belongs to a crashed worker: the next claim() or reclaimExpired() breaks
+// it by renaming it away, and the shard is handed out again. Ages are
+// measured against the file server's clock, so hosts need not agree on time.
+//
+// After a reclaim a slow (not dead) worker may still finish the shard; it
+// notices at its next renew(). Outputs should be renamed into place so that
+// a shard compressed twice is harmless.
+class ShardQueue
+{
+public:
+    struct Options
+    {
+        unsigned leaseSeconds = 300;
+    };
+
+    struct Lease
+    {
+        std::string shard;                  // e.g. "00000042"
+        std::vector<std::string> files;
+    };
+
+    struct Status
+    {
+        size_t shards = 0;
+        size_t done = 0;
+        size_t leased = 0;
+        size_t expired = 0;                 // leased, but not renewed in time
+    };
+
+    explicit ShardQueue(const std::string &directory);
+    ShardQueue(const std::string &directory, const Options &options);
+    ~ShardQueue();
+
+    ShardQueue(const ShardQueue &) = delete;
+    ShardQueue &operator=(const ShardQueue &) = delete;
+
+    // Coordinator: splits files into shards of filesPerShard entries. Fails
+    // if the directory already holds a queue.
+    bool create(const std::vector<std::string> &files, size_t filesPerShard);
+
+    // Breaks every expired lease; returns how many
+    size_t reclaimExpired();
+
+    Status status();
+
+    // One string per acknowledged shard, as given to acknowledge()
+    std::vector<std::string> reports();
+
+    // Worker: false with an empty errorMessage() when no shard is free right
+    // now (all done or leased by live workers).
+    bool claim(Lease &lease);
+
+    // False once the lease was reclaimed by someone else: stop the shard
+    bool renew(const Lease &lease);
+
+    bool acknowledge(const Lease &lease, const std::string &report);
+
+    // Gives the shard back unfinished
+    void release(const Lease &lease);
+
+    // "host:pid:start", written into each lease this process holds
+    const std::string &owner() const { return m_owner; }
+    unsigned leaseSeconds() const { return m_options.leaseSeconds; }
+    const std::string &errorMessage() const { return m_errorMessage; }
+
+private:
+    std::string shardPath(const std::string &shard) const;
+    std::string leasePath(const std::string &shard) const;
+    std::string donePath(const std::string &shard) const;
+    std::vector<std::string> listShards(const std::string &directory, const std::string &suffix) const;
+
+    bool serverNow(int64_t &now);
+    bool isExpired(const std::string &shard, int64_t now);
+    bool breakLease(const std::string &shard);
+    bool ownsLease(const std::string &shard) const;
+
+    std::string m_directory;
+    Options m_options;
+    std::string m_owner;
+    std::string m_clockPath;
+    std::string m_errorMessage;
+};
+
+#endif // SHARD_QUEUE_H
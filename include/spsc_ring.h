@@ -0,0 +1,113 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Bounded lock-free queue between exactly one producer thread and one
+// consumer thread. Each side writes only its own index (on its own cache
+// line), so a push or pop is a load, a copy and a release store.
+//
+// push() and pop() wait when the ring is full or empty: a short spin, then
+// yields, then 50 µs sleeps so a stalled stage does not burn a core. They
+// give up and return false once abort is set.
+template <typename T>
+class SpscRing
+{
+public:
+    // Rounded up to a power of two
+    explicit SpscRing(size_t capacity)
+        : m_slots(roundUp(capacity))
+        , m_mask(m_slots.size() - 1)
+    {
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    bool tryPush(const T &value)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == m_slots.size()) {
+            return false;
+        }
+        m_slots[tail & m_mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T &value)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = m_slots[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool push(const T &value, const std::atomic<bool> &abort)
+    {
+        Backoff backoff;
+        while (!tryPush(value)) {
+            if (abort.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            backoff.pause();
+        }
+        return true;
+    }
+
+    bool pop(T &value, const std::atomic<bool> &abort)
+    {
+        Backoff backoff;
+        while (!tryPop(value)) {
+            if (abort.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            backoff.pause();
+        }
+        return true;
+    }
+
+    size_t capacity() const { return m_slots.size(); }
+
+private:
+    class Backoff
+    {
+    public:
+        void pause()
+        {
+            if (m_rounds >= 128) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+                return;
+            }
+            if (m_rounds++ >= 64) {
+                std::this_thread::yield();
+            }
+        }
+
+    private:
+        unsigned m_rounds = 0;
+    };
+
+    static size_t roundUp(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    std::vector<T> m_slots;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_head{0};   // next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> m_tail{0};   // next slot to fill, written by the producer
+};
+
+#endif // SPSC_RING_H
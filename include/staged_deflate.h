@@ -0,0 +1,65 @@
+#ifndef STAGED_DEFLATE_H
+#define STAGED_DEFLATE_H
+
+#include "deflate_stream.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CancellationToken;
+
+// Compresses one file as a three-stage pipeline: a reader thread, deflate on
+// the calling thread and a writer thread. The stages hand each other
+// fixed-size chunks through SpscRing queues and send them back empty on a
+// second ring, so the buffers are allocated once and recycled for the whole
+// file. While deflate works on one chunk the reader fetches the next ones
+// and the writer flushes earlier output, so the wall time approaches that of
+// the slowest stage rather than the sum of all three.
+//
+// The output is a single deflate stream, byte for byte what
+// DeflateStream::compressFile produces at the same settings.
+class StagedDeflate
+{
+public:
+    struct Options
+    {
+        DeflateStream::Format format = DeflateStream::Format::Zlib;
+        int level = Z_BEST_COMPRESSION;
+        size_t chunkSize = 1024 * 1024;
+        unsigned chunks = 8;                        // per direction, in flight between two stages
+        const CancellationToken *cancel = nullptr;
+    };
+
+    // Busy time of each stage (waits excluded) and of the whole run, in seconds
+    struct StageTimes
+    {
+        double read = 0.0;
+        double compress = 0.0;
+        double write = 0.0;
+        double wall = 0.0;
+    };
+
+    StagedDeflate();
+    explicit StagedDeflate(const Options &options);
+
+    // Same contract as DeflateStream::compressFile; a failed or cancelled
+    // run removes the output.
+    bool compressFile(const std::string &inputPath, const std::string &outputPath,
+                      const DeflateStream::ProgressCallback &progress = nullptr,
+                      const std::vector<unsigned char> &header = {});
+
+    uint64_t totalIn() const { return m_totalIn; }
+    uint64_t totalOut() const { return m_totalOut; }
+    const StageTimes &stageTimes() const { return m_times; }
+    const std::string &errorMessage() const { return m_errorMessage; }
+
+private:
+    Options m_options;
+    uint64_t m_totalIn;
+    uint64_t m_totalOut;
+    StageTimes m_times;
+    std::string m_errorMessage;
+};
+
+#endif // STAGED_DEFLATE_H
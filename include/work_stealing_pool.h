@@ -0,0 +1,67 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+// Task scheduler for batches that mix whole-file and block-level work.
+//
+// Top-level tasks (one per file) wait in a shared queue in submission order.
+// A task may spawn subtasks (deflate blocks) onto its worker's own deque;
+// workers with nothing of their own steal from the other deques before they
+// start a new file, so a large file is finished by every core instead of
+// keeping one busy while the rest sit idle at the end of the batch.
+//
+// Tasks are coarse (a file or a block of about 1 MiB), so one mutex guards
+// all the queues.
+class WorkStealingPool
+{
+public:
+    // worker running the task (0 .. workerCount() - 1). Tasks must not throw.
+    using Task = std::function<void(unsigned worker)>;
+
+    // workers 0 = CpuCount::available(). pinWorkers binds each worker to one
+    // allowed CPU for the duration of run() (see CpuCount::ThreadPin).
+    explicit WorkStealingPool(unsigned workers = 0, bool pinWorkers = false);
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    // Queues a top-level task; they are started in submission order
+    void submit(Task task);
+
+    // Runs every submitted task and everything they spawn, then returns.
+    // The calling thread works as worker 0.
+    void run();
+
+    // From inside a task: queues a subtask that idle workers may steal
+    void spawn(Task task);
+
+    // From inside a task: runs queued subtasks until done() returns true.
+    // New top-level tasks are not started here, so waits stay short.
+    void helpUntil(const std::function<bool()> &done);
+
+    unsigned workerCount() const { return m_workers; }
+
+    // Pool the calling thread is working for, nullptr outside run()
+    static WorkStealingPool *current();
+
+private:
+    void work(unsigned worker);
+    bool takeLocked(unsigned worker, bool topLevel, Task &task);
+    void runTask(Task &task, unsigned worker, std::unique_lock<std::mutex> &lock);
+
+    unsigned m_workers;
+    bool m_pinWorkers;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<Task> m_topLevel;
+    std::vector<std::deque<Task>> m_local;
+    size_t m_running;
+};
+
+#endif // WORK_STEALING_POOL_H
@@ -0,0 +1,88 @@
+#ifndef XZ_STREAM_H
+#define XZ_STREAM_H
+
+#include "deflate_stream.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CancellationToken;
+
+// Chunked xz (LZMA2) compressor with the same shape as DeflateStream: input
+// is fed in buffers and the pieces of one .xz stream go to a sink.
+//
+// With threads > 1 it uses liblzma's multithreaded encoder
+// (lzma_stream_encoder_mt): the input is cut into blocks of blockSize bytes
+// compressed in parallel, so more threads cost memory (about threads x 3
+// block sizes plus the match finder at high levels) rather than ratio, and
+// the blocks let xz -d --threads decode in parallel too. blockSize 0 lets
+// liblzma pick three times the dictionary size (24-192 MiB at levels 6-9).
+//
+// Only built with HAVE_LZMA; otherwise available() is false and every call
+// fails with an error message.
+class XzStream
+{
+public:
+    static constexpr int MinLevel = 0;
+    static constexpr int MaxLevel = 9;
+    static constexpr int DefaultLevel = 9;
+
+    struct Options
+    {
+        int level = DefaultLevel;       // clamped to MinLevel..MaxLevel
+        bool extreme = false;           // xz -e: slower, a little smaller
+        unsigned threads = 0;           // 0 or 1 = single-threaded encoder
+        uint64_t blockSize = 0;         // per thread; 0 = liblzma default
+    };
+
+    static bool available();
+
+    // Encoder memory for these options as liblzma computes it, 0 if unknown
+    static uint64_t memoryEstimate(const Options &options);
+
+    XzStream();
+    explicit XzStream(const Options &options, size_t bufferSize = DeflateStream::DefaultBufferSize);
+    ~XzStream();
+
+    XzStream(const XzStream &) = delete;
+    XzStream &operator=(const XzStream &) = delete;
+
+    bool write(const unsigned char *data, size_t size, const DeflateStream::Sink &sink);
+    bool finish(const DeflateStream::Sink &sink);
+
+    // Checked before every buffer-sized slice of input, as in DeflateStream
+    void setCancellationToken(const CancellationToken *token) { m_cancel = token; }
+
+    // Streams a whole file into a .xz file; a failed or cancelled run
+    // removes the output
+    bool compressFile(const std::string &inputPath, const std::string &outputPath,
+                      const DeflateStream::ProgressCallback &progress = nullptr);
+
+    uint64_t totalIn() const { return m_totalIn; }
+    uint64_t totalOut() const { return m_totalOut; }
+    unsigned threadCount() const { return m_threads; }
+    // Memory of the encoder actually set up (after any single-thread fallback)
+    uint64_t memoryUsage() const { return m_memoryUsage; }
+    const std::string &errorMessage() const { return m_errorMessage; }
+
+private:
+    struct State;
+
+    bool code(const unsigned char *data, size_t size, bool end, const DeflateStream::Sink &sink);
+
+    std::unique_ptr<State> m_state;
+    Options m_options;
+    unsigned m_threads;
+    bool m_finished;
+    size_t m_bufferSize;
+    std::vector<unsigned char> m_outBuffer;
+    uint64_t m_totalIn;
+    uint64_t m_totalOut;
+    uint64_t m_memoryUsage;
+    const CancellationToken *m_cancel;
+    std::string m_errorMessage;
+};
+
+#endif // XZ_STREAM_H
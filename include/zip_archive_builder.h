@@ -0,0 +1,84 @@
+#ifndef ZIP_ARCHIVE_BUILDER_H
+#define ZIP_ARCHIVE_BUILDER_H
+
+#include "zstd_stream.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+class CancellationToken;
+
+// Builds one ZIP archive from many input files. Entries are deflated on a
+// ParallelBatch of workers, while a single writer thread appends the finished
+// local headers and data in entry order and writes the central directory once
+// at the end, so the archive is the same whatever the thread count.
+//
+// Workers stay at most a window of entries (and of buffered bytes) ahead of
+// the writer. Entries above streamThreshold are not buffered: the writer
+// streams them through ParallelDeflate when their turn comes.
+//
+// With zstd set, entries are Zstandard frames (method 93) instead; level is
+// then ignored in favour of zstdOptions.
+class ZipArchiveBuilder
+{
+public:
+    struct Entry
+    {
+        std::string inputPath;
+        std::string name;       // path inside the archive, '/' separated
+    };
+
+    struct EntryResult
+    {
+        bool success = false;
+        uint64_t originalSize = 0;
+        uint64_t compressedSize = 0;
+        std::string errorMessage;
+    };
+
+    struct Options
+    {
+        int level = Z_BEST_COMPRESSION;
+        unsigned workers = 0;                           // 0 = CpuCount::available()
+        uint64_t streamThreshold = 8 * 1024 * 1024;
+        uint64_t maxBufferedBytes = 256 * 1024 * 1024;  // compressed data waiting for the writer
+        const CancellationToken *cancel = nullptr;     // abandons the whole archive
+        bool zstd = false;
+        ZstdStream::Options zstdOptions;
+    };
+
+    // Called on the writer thread after each entry is written
+    using ProgressCallback = std::function<void(size_t entriesWritten, size_t entryCount)>;
+
+    // Files become entries named after themselves; directories are walked in
+    // sorted order with names relative to their parent. The archive itself
+    // and its ".part" temporaries are skipped, so an output directory inside
+    // an input one is not archived into the next run.
+    static std::vector<Entry> collectEntries(const std::vector<std::string> &inputPaths,
+                                             const std::string &outputPath);
+
+    ZipArchiveBuilder();
+    explicit ZipArchiveBuilder(const Options &options);
+
+    // Entries that cannot be read are left out and reported in results();
+    // false means the archive itself could not be written (and was removed).
+    bool build(const std::string &outputPath, const std::vector<Entry> &entries,
+               const ProgressCallback &progress = nullptr);
+
+    const std::vector<EntryResult> &results() const { return m_results; }
+    uint64_t totalIn() const { return m_totalIn; }
+    uint64_t archiveSize() const { return m_archiveSize; }
+    const std::string &errorMessage() const { return m_errorMessage; }
+
+private:
+    Options m_options;
+    std::vector<EntryResult> m_results;
+    uint64_t m_totalIn;
+    uint64_t m_archiveSize;
+    std::string m_errorMessage;
+};
+
+#endif // ZIP_ARCHIVE_BUILDER_H
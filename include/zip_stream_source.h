@@ -0,0 +1,23 @@
+#ifndef ZIP_STREAM_SOURCE_H
+#define ZIP_STREAM_SOURCE_H
+
+#include <cstdint>
+#include <string>
+#include <zip.h>
+
+class CancellationToken;
+
+// libzip source that streams a file in fixed-size chunks while libzip
+// compresses it, instead of handing it the whole file as one buffer.
+class ZipStreamSource
+{
+public:
+    // Opens inputPath and wraps it in a zip_source_function. The file is read
+    // during zip_close(); bytesRead (if given) must stay valid until then and
+    // receives the number of bytes libzip consumed. Returns nullptr on error.
+    // Once cancel is set the next read fails, so zip_close() gives up.
+    static zip_source_t *create(zip_t *zip, const std::string &inputPath, uint64_t *bytesRead,
+                                const CancellationToken *cancel = nullptr);
+};
+
+#endif // ZIP_STREAM_SOURCE_H
@@ -0,0 +1,85 @@
+#ifndef ZIP_WRITER_H
+#define ZIP_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+// Minimal ZIP archive writer for entries whose data we compress ourselves.
+// Raw deflate (or stored) data is copied into the archive as-is, together
+// with a CRC and sizes computed by the caller, so nothing is compressed twice.
+// Entries, offsets and entry counts past the classic limits use ZIP64.
+class ZipWriter
+{
+public:
+    static constexpr uint16_t MethodStore = 0;
+    static constexpr uint16_t MethodDeflate = 8;
+    static constexpr uint16_t MethodZstd = 93;     // APPNOTE 6.3.7; a whole .zst frame
+
+    ZipWriter();
+    ~ZipWriter();
+
+    ZipWriter(const ZipWriter &) = delete;
+    ZipWriter &operator=(const ZipWriter &) = delete;
+
+    bool open(const std::string &path);
+
+    // Appends a complete entry. data holds raw deflate (RFC 1951) for
+    // MethodDeflate, a Zstandard frame for MethodZstd or the original bytes
+    // for MethodStore.
+    bool addPrecompressed(const std::string &name, const unsigned char *data, size_t size,
+                          uint32_t crc, uint64_t uncompressedSize,
+                          uint16_t method = MethodDeflate, time_t modificationTime = 0);
+
+    // Streaming variant for entries larger than memory: the local header is
+    // patched with the final CRC and sizes in endEntry(). expectedSize is the
+    // input size when known; entries close to 4 GiB get ZIP64 local headers,
+    // and entries of unknown size (0) that end up larger than that fail.
+    bool beginEntry(const std::string &name, uint16_t method = MethodDeflate, time_t modificationTime = 0,
+                    uint64_t expectedSize = 0);
+    bool writeEntryData(const unsigned char *data, size_t size);
+    bool endEntry(uint32_t crc, uint64_t uncompressedSize);
+    // Drops the open entry and everything written for it
+    bool abortEntry();
+
+    // Writes the central directory and closes the file.
+    bool close();
+    // Closes and deletes a partially written archive.
+    void discard();
+
+    uint64_t bytesWritten() const { return m_offset; }
+    size_t entryCount() const { return m_entries.size(); }
+    const std::string &errorMessage() const { return m_errorMessage; }
+
+private:
+    struct Entry
+    {
+        std::string name;
+        uint16_t method = MethodDeflate;
+        uint16_t dosTime = 0;
+        uint16_t dosDate = 0;
+        uint32_t crc = 0;
+        uint64_t compressedSize = 0;
+        uint64_t uncompressedSize = 0;
+        uint64_t localHeaderOffset = 0;
+        bool zip64 = false;         // local header carries a ZIP64 extra field
+    };
+
+    std::vector<unsigned char> localHeader(const Entry &entry) const;
+    std::vector<unsigned char> centralHeader(const Entry &entry) const;
+    bool writeBytes(const unsigned char *data, size_t size);
+    bool writeAt(uint64_t offset, const std::vector<unsigned char> &bytes);
+    bool fail(const std::string &message);
+
+    int m_fd;
+    std::string m_path;
+    uint64_t m_offset;
+    bool m_entryOpen;
+    Entry m_current;
+    std::vector<Entry> m_entries;
+    std::string m_errorMessage;
+};
+
+#endif // ZIP_WRITER_H
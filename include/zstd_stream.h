@@ -0,0 +1,88 @@
+#ifndef ZSTD_STREAM_H
+#define ZSTD_STREAM_H
+
+#include "deflate_stream.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CancellationToken;
+struct ZSTD_CCtx_s;
+
+// Chunked Zstandard compressor with the same shape as DeflateStream: input is
+// fed in buffers and each piece of a single .zst frame goes to a sink.
+//
+// workers > 0 hands the frame to libzstd's own threads (ZSTD_c_nbWorkers),
+// which split it into jobs and keep the output a single frame; libzstd
+// built without threads falls back to one. longDistance turns on
+// long-distance matching with a 128 MiB window, which finds repeats far
+// apart in big logs; plain zstd -d still decodes it.
+//
+// Only built with HAVE_ZSTD; otherwise available() is false and every call
+// fails with an error message.
+class ZstdStream
+{
+public:
+    static constexpr int MinLevel = 1;
+    static constexpr int MaxLevel = 22;
+    static constexpr int DefaultLevel = 3;
+
+    struct Options
+    {
+        int level = DefaultLevel;       // clamped to MinLevel..MaxLevel
+        unsigned workers = 0;           // 0 = compress on the calling thread
+        bool longDistance = false;
+    };
+
+    static bool available();
+
+    // Approximate heap used by one stream with these options
+    static uint64_t memoryEstimate(const Options &options);
+
+    ZstdStream();
+    explicit ZstdStream(const Options &options, size_t bufferSize = DeflateStream::DefaultBufferSize);
+    ~ZstdStream();
+
+    ZstdStream(const ZstdStream &) = delete;
+    ZstdStream &operator=(const ZstdStream &) = delete;
+
+    // Lets libzstd record the size in the frame header and size its tables;
+    // call before the first write()
+    void setExpectedSize(uint64_t size);
+
+    bool write(const unsigned char *data, size_t size, const DeflateStream::Sink &sink);
+    bool finish(const DeflateStream::Sink &sink);
+
+    // Checked before every buffer-sized slice of input, as in DeflateStream
+    void setCancellationToken(const CancellationToken *token) { m_cancel = token; }
+
+    // Streams a whole file into a .zst file; a failed or cancelled run
+    // removes the output
+    bool compressFile(const std::string &inputPath, const std::string &outputPath,
+                      const DeflateStream::ProgressCallback &progress = nullptr);
+
+    uint64_t totalIn() const { return m_totalIn; }
+    uint64_t totalOut() const { return m_totalOut; }
+    // CRC32 of the input, for ZIP entries (method 93)
+    uint32_t crc() const { return m_crc; }
+    unsigned workerCount() const { return m_workers; }
+    const std::string &errorMessage() const { return m_errorMessage; }
+
+private:
+    bool compressBuffer(const unsigned char *data, size_t size, bool end, const DeflateStream::Sink &sink);
+
+    ZSTD_CCtx_s *m_context;
+    Options m_options;
+    unsigned m_workers;
+    bool m_finished;
+    size_t m_bufferSize;
+    std::vector<unsigned char> m_outBuffer;
+    uint64_t m_totalIn;
+    uint64_t m_totalOut;
+    uint32_t m_crc;
+    const CancellationToken *m_cancel;
+    std::string m_errorMessage;
+};
+
+#endif // ZSTD_STREAM_H
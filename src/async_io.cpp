@@ -0,0 +1,293 @@
+#include "async_io.h"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <unistd.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+namespace {
+
+// Fallback backend: each request runs as a blocking pread/pwrite on a worker
+class ThreadPoolIo : public AsyncIo
+{
+public:
+    explicit ThreadPoolIo(unsigned threads)
+        : m_nextTicket(1)
+        , m_stop(false)
+    {
+        for (unsigned i = 0; i < threads; ++i) {
+            m_threads.emplace_back([this]() { run(); });
+        }
+    }
+
+    ~ThreadPoolIo() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_workCondition.notify_all();
+        for (std::thread &thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    Ticket submitRead(int fd, unsigned char *buffer, size_t size, uint64_t offset) override
+    {
+        return submit(Request{0, false, fd, buffer, size, offset});
+    }
+
+    Ticket submitWrite(int fd, const unsigned char *buffer, size_t size, uint64_t offset) override
+    {
+        return submit(Request{0, true, fd, const_cast<unsigned char *>(buffer), size, offset});
+    }
+
+    long long wait(Ticket ticket) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_doneCondition.wait(lock, [this, ticket]() { return m_results.count(ticket) > 0; });
+        long long result = m_results[ticket];
+        m_results.erase(ticket);
+        return result;
+    }
+
+    const char *backendName() const override { return "thread-pool"; }
+
+private:
+    struct Request
+    {
+        Ticket ticket;
+        bool write;
+        int fd;
+        unsigned char *buffer;
+        size_t size;
+        uint64_t offset;
+    };
+
+    Ticket submit(Request request)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            request.ticket = m_nextTicket++;
+            m_queue.push_back(request);
+        }
+        m_workCondition.notify_one();
+        return request.ticket;
+    }
+
+    static long long perform(const Request &request)
+    {
+        // Loop so callers only see short counts at end of file
+        size_t done = 0;
+        while (done < request.size) {
+            ssize_t count = request.write
+                ? ::pwrite(request.fd, request.buffer + done, request.size - done, static_cast<off_t>(request.offset + done))
+                : ::pread(request.fd, request.buffer + done, request.size - done, static_cast<off_t>(request.offset + done));
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -errno;
+            }
+            if (count == 0) {
+                break;
+            }
+            done += static_cast<size_t>(count);
+        }
+        return static_cast<long long>(done);
+    }
+
+    void run()
+    {
+        while (true) {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_workCondition.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+                if (m_stop && m_queue.empty()) {
+                    return;
+                }
+                request = m_queue.front();
+                m_queue.pop_front();
+            }
+
+            long long result = perform(request);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_results[request.ticket] = result;
+            }
+            m_doneCondition.notify_all();
+        }
+    }
+
+    Ticket m_nextTicket;
+    bool m_stop;
+    std::mutex m_mutex;
+    std::condition_variable m_workCondition;
+    std::condition_variable m_doneCondition;
+    std::deque<Request> m_queue;
+    std::unordered_map<Ticket, long long> m_results;
+    std::vector<std::thread> m_threads;
+};
+
+#ifdef HAVE_LIBURING
+// io_uring backend. Used from a single thread (the pipeline's), so the ring
+// itself needs no locking.
+class UringIo : public AsyncIo
+{
+public:
+    UringIo()
+        : m_nextTicket(1)
+        , m_inFlight(0)
+        , m_ready(false)
+        , m_error(0)
+    {
+    }
+
+    ~UringIo() override
+    {
+        if (m_ready) {
+            // Never free the ring with requests still touching caller buffers
+            while (m_inFlight > 0) {
+                reapOne();
+            }
+            io_uring_queue_exit(&m_ring);
+        }
+    }
+
+    bool init(unsigned queueDepth)
+    {
+        m_ready = io_uring_queue_init(queueDepth, &m_ring, 0) == 0;
+        return m_ready;
+    }
+
+    Ticket submitRead(int fd, unsigned char *buffer, size_t size, uint64_t offset) override
+    {
+        io_uring_sqe *sqe = nextSqe();
+        if (!sqe) {
+            return failed();
+        }
+        io_uring_prep_read(sqe, fd, buffer, static_cast<unsigned>(size), offset);
+        return push(sqe);
+    }
+
+    Ticket submitWrite(int fd, const unsigned char *buffer, size_t size, uint64_t offset) override
+    {
+        io_uring_sqe *sqe = nextSqe();
+        if (!sqe) {
+            return failed();
+        }
+        io_uring_prep_write(sqe, fd, buffer, static_cast<unsigned>(size), offset);
+        return push(sqe);
+    }
+
+    long long wait(Ticket ticket) override
+    {
+        // A failed reap resolves every outstanding ticket, so this ends
+        while (m_results.count(ticket) == 0 && m_pending.count(ticket) > 0) {
+            reapOne();
+        }
+        if (m_results.count(ticket) == 0) {
+            return -EINVAL;
+        }
+        long long result = m_results[ticket];
+        m_results.erase(ticket);
+        return result;
+    }
+
+    const char *backendName() const override { return "io_uring"; }
+
+private:
+    io_uring_sqe *nextSqe()
+    {
+        io_uring_sqe *sqe = io_uring_get_sqe(&m_ring);
+        while (!sqe && m_inFlight > 0) {
+            // Submission queue full: make room by completing the oldest work
+            io_uring_submit(&m_ring);
+            if (!reapOne()) {
+                return nullptr;
+            }
+            sqe = io_uring_get_sqe(&m_ring);
+        }
+        return sqe;
+    }
+
+    Ticket push(io_uring_sqe *sqe)
+    {
+        Ticket ticket = m_nextTicket++;
+        sqe->user_data = ticket;
+        io_uring_submit(&m_ring);
+        m_pending.insert(ticket);
+        ++m_inFlight;
+        return ticket;
+    }
+
+    // Ticket that completes at once with the ring's error
+    Ticket failed()
+    {
+        Ticket ticket = m_nextTicket++;
+        m_results[ticket] = m_error != 0 ? m_error : -EIO;
+        return ticket;
+    }
+
+    bool reapOne()
+    {
+        io_uring_cqe *cqe = nullptr;
+        int ret = io_uring_wait_cqe(&m_ring, &cqe);
+        while (ret == -EINTR) {
+            ret = io_uring_wait_cqe(&m_ring, &cqe);
+        }
+        if (ret < 0) {
+            // The ring is unusable: every outstanding request fails with
+            // its error rather than leaving wait() spinning
+            m_error = ret;
+            for (Ticket ticket : m_pending) {
+                m_results[ticket] = ret;
+            }
+            m_pending.clear();
+            m_inFlight = 0;
+            return false;
+        }
+        m_results[cqe->user_data] = cqe->res;
+        m_pending.erase(cqe->user_data);
+        io_uring_cqe_seen(&m_ring, cqe);
+        --m_inFlight;
+        return true;
+    }
+
+    io_uring m_ring;
+    Ticket m_nextTicket;
+    unsigned m_inFlight;
+    bool m_ready;
+    int m_error;
+    std::unordered_set<Ticket> m_pending;
+    std::unordered_map<Ticket, long long> m_results;
+};
+#endif
+
+} // namespace
+
+std::unique_ptr<AsyncIo> AsyncIo::create(unsigned queueDepth)
+{
+    queueDepth = std::max(1u, queueDepth);
+
+#ifdef HAVE_LIBURING
+    // Kernels without io_uring (or sandboxes that block it) use the thread pool
+    std::unique_ptr<UringIo> uring(new UringIo());
+    if (uring->init(queueDepth)) {
+        return std::move(uring);
+    }
+#endif
+
+    return std::unique_ptr<AsyncIo>(new ThreadPoolIo(queueDepth));
+}
@@ -0,0 +1,424 @@
+#include "batch_pipeline.h"
+#include "cancellation_token.h"
+#include "page_cache.h"
+#include <algorithm>
+#include <cerrno>
+#include <deque>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct InputState
+{
+    int fd = -1;
+    bool opened = false;
+    bool regular = true;
+    bool failed = false;
+    bool abandoned = false;     // no further reads are queued for it
+    uint64_t size = 0;
+    uint64_t nextOffset = 0;
+};
+
+struct PendingRead
+{
+    size_t job = 0;
+    uint64_t offset = 0;
+    std::vector<unsigned char> buffer;
+    AsyncIo::Ticket ticket = 0;
+};
+
+struct PendingWrite
+{
+    std::vector<unsigned char> buffer;
+    AsyncIo::Ticket ticket = 0;
+    int fd = -1;
+    uint64_t offset = 0;
+};
+
+// State of one BatchPipeline::run() call
+class PipelineRun
+{
+public:
+    PipelineRun(const std::vector<BatchPipeline::Job> &jobs, const BatchPipeline::Options &options, AsyncIo &io)
+        : m_jobs(jobs)
+        , m_options(options)
+        , m_io(io)
+        , m_inputs(jobs.size())
+        , m_nextJob(0)
+        , m_droppedOutput(0)
+    {
+    }
+
+    ~PipelineRun()
+    {
+        // Buffers may only be released once the kernel is done with them
+        while (!m_reads.empty()) {
+            m_io.wait(m_reads.front().ticket);
+            m_reads.pop_front();
+        }
+        while (!m_writes.empty()) {
+            m_io.wait(m_writes.front().ticket);
+            m_writes.pop_front();
+        }
+        for (InputState &input : m_inputs) {
+            if (input.fd >= 0) {
+                ::close(input.fd);
+            }
+        }
+    }
+
+    BatchPipeline::JobResult runJob(size_t index)
+    {
+        BatchPipeline::JobResult result;
+        const BatchPipeline::Job &job = m_jobs[index];
+        InputState &input = m_inputs[index];
+
+        fillReads();
+
+        if (input.failed) {
+            result.errorMessage = "No se pudo abrir el archivo de entrada";
+            return result;
+        }
+
+        if (CancellationToken::cancelled(m_options.cancel)) {
+            discardReads(index);
+            closeInput(input);
+            result.errorMessage = CancellationToken::CancelledMessage;
+            return result;
+        }
+
+        if (!input.regular) {
+            // Pipes and devices cannot be read at offsets; stream them directly
+            closeInput(input);
+            DeflateStream stream(job.format, m_options.level, m_options.chunkSize);
+            stream.setCancellationToken(m_options.cancel);
+            result.success = stream.compressFile(job.inputPath, job.outputPath, nullptr, job.header);
+            result.bytesIn = stream.totalIn();
+            result.bytesOut = stream.totalOut() + job.header.size();
+            result.errorMessage = stream.errorMessage();
+            return result;
+        }
+
+        int outputFd = ::open(job.outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (outputFd < 0) {
+            discardReads(index);
+            closeInput(input);
+            result.errorMessage = "No se pudo crear el archivo de salida";
+            return result;
+        }
+
+        DeflateStream stream(job.format, m_options.level, m_options.chunkSize);
+        stream.setCancellationToken(m_options.cancel);
+        m_droppedOutput = 0;
+        std::vector<unsigned char> pending = takeBuffer();
+        pending.assign(job.header.begin(), job.header.end());
+        uint64_t outputOffset = 0;
+        bool writeOk = true;
+
+        // Compressed output is batched into chunk-sized asynchronous writes
+        DeflateStream::Sink sink = [&](const unsigned char *data, size_t size) {
+            pending.insert(pending.end(), data, data + size);
+            if (pending.size() >= m_options.chunkSize) {
+                writeOk = submitWrite(outputFd, pending, outputOffset);
+                pending = takeBuffer();
+            }
+            return writeOk;
+        };
+
+        bool ok = true;
+        while (true) {
+            fillReads();
+            if (m_reads.empty() || m_reads.front().job != index) {
+                break;
+            }
+
+            PendingRead read = std::move(m_reads.front());
+            m_reads.pop_front();
+            long long got = finishRead(input.fd, read, m_io.wait(read.ticket));
+
+            if (ok && got < 0) {
+                ok = false;
+                result.errorMessage = "Error al leer el archivo de entrada";
+            } else if (ok && !stream.write(read.buffer.data(), static_cast<size_t>(got), sink)) {
+                ok = false;
+                result.errorMessage = writeOk ? stream.errorMessage() : "Error al escribir los datos comprimidos";
+            }
+            if (!ok) {
+                // Only the reads already queued are drained
+                input.abandoned = true;
+            }
+            if (m_options.dropCache) {
+                PageCache::dropInput(input.fd, read.offset, read.buffer.size());
+            }
+            recycleBuffer(std::move(read.buffer));
+        }
+
+        if (ok && !stream.finish(sink)) {
+            ok = false;
+            result.errorMessage = writeOk ? stream.errorMessage() : "Error al escribir los datos comprimidos";
+        }
+        if (ok && !pending.empty() && !submitWrite(outputFd, pending, outputOffset)) {
+            ok = false;
+            result.errorMessage = "Error al escribir los datos comprimidos";
+        }
+        if (!completeWrites() && ok) {
+            ok = false;
+            result.errorMessage = "Error al escribir los datos comprimidos";
+        }
+        if (m_options.dropCache) {
+            // A last pass over both files catches pages that were still
+            // queued on another CPU's LRU list when their chunk was dropped
+            PageCache::dropInput(input.fd, 0, input.size);
+            PageCache::dropOutput(outputFd, 0, outputOffset);
+        }
+
+        closeInput(input);
+        if (::close(outputFd) != 0 && ok) {
+            ok = false;
+            result.errorMessage = "Error al escribir los datos comprimidos";
+        }
+        if (!ok) {
+            ::unlink(job.outputPath.c_str());
+        }
+
+        result.success = ok;
+        result.bytesIn = stream.totalIn();
+        result.bytesOut = outputOffset;
+        if (ok) {
+            result.errorMessage.clear();
+        }
+        return result;
+    }
+
+private:
+    // Keeps up to readsInFlight chunk reads queued, running ahead into the
+    // following files once the current one is fully requested
+    void fillReads()
+    {
+        while (m_reads.size() < m_options.readsInFlight && m_nextJob < m_jobs.size()) {
+            InputState &input = m_inputs[m_nextJob];
+
+            if (!input.opened) {
+                input.opened = true;
+                input.fd = ::open(m_jobs[m_nextJob].inputPath.c_str(), O_RDONLY | O_CLOEXEC);
+                struct stat info;
+                if (input.fd < 0 || fstat(input.fd, &info) != 0) {
+                    input.failed = true;
+                    ++m_nextJob;
+                    continue;
+                }
+                if (!S_ISREG(info.st_mode)) {
+                    input.regular = false;
+                    ++m_nextJob;
+                    continue;
+                }
+                input.size = static_cast<uint64_t>(info.st_size);
+                if (m_options.dropCache) {
+                    PageCache::adviseSequential(input.fd);
+                }
+            }
+
+            if (input.abandoned || input.nextOffset >= input.size) {
+                ++m_nextJob;
+                continue;
+            }
+
+            size_t length = static_cast<size_t>(std::min<uint64_t>(m_options.chunkSize, input.size - input.nextOffset));
+            PendingRead read;
+            read.job = m_nextJob;
+            read.offset = input.nextOffset;
+            read.buffer = takeBuffer();
+            read.buffer.resize(length);
+            read.ticket = m_io.submitRead(input.fd, read.buffer.data(), length, input.nextOffset);
+            input.nextOffset += length;
+            if (m_options.dropCache) {
+                // Keep the kernel one chunk ahead of the queued reads
+                PageCache::willNeed(input.fd, input.nextOffset, m_options.chunkSize);
+            }
+            m_reads.push_back(std::move(read));
+        }
+    }
+
+    // Finish short reads synchronously, so a chunk is only short at the end
+    // of the file and the next one starts where this one stopped
+    static long long finishRead(int fd, PendingRead &read, long long got)
+    {
+        size_t done = got >= 0 ? static_cast<size_t>(got) : 0;
+        while (got >= 0 && done < read.buffer.size()) {
+            ssize_t count = ::pread(fd, read.buffer.data() + done, read.buffer.size() - done,
+                                    static_cast<off_t>(read.offset + done));
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count < 0) {
+                return -errno;
+            }
+            if (count == 0) {
+                // File shrank since it was opened
+                break;
+            }
+            done += static_cast<size_t>(count);
+        }
+        return got >= 0 ? static_cast<long long>(done) : got;
+    }
+
+    bool submitWrite(int fd, std::vector<unsigned char> &buffer, uint64_t &offset)
+    {
+        bool ok = true;
+        while (m_writes.size() >= m_options.writesInFlight) {
+            ok = completeOldestWrite() && ok;
+        }
+
+        PendingWrite write;
+        write.buffer = std::move(buffer);
+        write.fd = fd;
+        write.offset = offset;
+        write.ticket = m_io.submitWrite(fd, write.buffer.data(), write.buffer.size(), offset);
+        offset += write.buffer.size();
+        m_writes.push_back(std::move(write));
+        return ok;
+    }
+
+    bool completeOldestWrite()
+    {
+        PendingWrite write = std::move(m_writes.front());
+        m_writes.pop_front();
+
+        long long written = m_io.wait(write.ticket);
+        bool ok = written >= 0;
+
+        // Finish short writes synchronously
+        size_t done = ok ? static_cast<size_t>(written) : 0;
+        while (ok && done < write.buffer.size()) {
+            ssize_t count = ::pwrite(write.fd, write.buffer.data() + done, write.buffer.size() - done,
+                                     static_cast<off_t>(write.offset + done));
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            ok = count > 0;
+            done += ok ? static_cast<size_t>(count) : 0;
+        }
+
+        if (ok && m_options.dropCache) {
+            // Writes complete in order, so everything before this one was
+            // already queued for writeback and can be waited on and evicted
+            PageCache::dropOutput(write.fd, m_droppedOutput, write.offset - m_droppedOutput);
+            PageCache::startWriteback(write.fd, write.offset, write.buffer.size());
+            m_droppedOutput = write.offset;
+        }
+
+        recycleBuffer(std::move(write.buffer));
+        return ok;
+    }
+
+    bool completeWrites()
+    {
+        bool ok = true;
+        while (!m_writes.empty()) {
+            ok = completeOldestWrite() && ok;
+        }
+        return ok;
+    }
+
+    void discardReads(size_t job)
+    {
+        m_inputs[job].abandoned = true;
+        while (true) {
+            fillReads();
+            if (m_reads.empty() || m_reads.front().job != job) {
+                return;
+            }
+            m_io.wait(m_reads.front().ticket);
+            recycleBuffer(std::move(m_reads.front().buffer));
+            m_reads.pop_front();
+        }
+    }
+
+    void closeInput(InputState &input)
+    {
+        if (input.fd >= 0) {
+            ::close(input.fd);
+            input.fd = -1;
+        }
+    }
+
+    std::vector<unsigned char> takeBuffer()
+    {
+        if (m_spare.empty()) {
+            std::vector<unsigned char> buffer;
+            buffer.reserve(m_options.chunkSize + m_options.chunkSize / 4);
+            return buffer;
+        }
+        std::vector<unsigned char> buffer = std::move(m_spare.back());
+        m_spare.pop_back();
+        buffer.clear();
+        return buffer;
+    }
+
+    void recycleBuffer(std::vector<unsigned char> &&buffer)
+    {
+        if (m_spare.size() < m_options.readsInFlight + m_options.writesInFlight + 2) {
+            m_spare.push_back(std::move(buffer));
+        }
+    }
+
+    const std::vector<BatchPipeline::Job> &m_jobs;
+    const BatchPipeline::Options &m_options;
+    AsyncIo &m_io;
+    std::vector<InputState> m_inputs;
+    size_t m_nextJob;
+    uint64_t m_droppedOutput;
+    std::deque<PendingRead> m_reads;
+    std::deque<PendingWrite> m_writes;
+    std::vector<std::vector<unsigned char>> m_spare;
+};
+
+} // namespace
+
+BatchPipeline::BatchPipeline()
+    : BatchPipeline(Options())
+{
+}
+
+BatchPipeline::BatchPipeline(const Options &options)
+    : m_options(options)
+{
+    m_options.chunkSize = std::max<size_t>(m_options.chunkSize, 4096);
+    m_options.readsInFlight = std::max(1u, m_options.readsInFlight);
+    m_options.writesInFlight = std::max(1u, m_options.writesInFlight);
+    m_io = AsyncIo::create(m_options.readsInFlight + m_options.writesInFlight);
+}
+
+BatchPipeline::~BatchPipeline() = default;
+
+uint64_t BatchPipeline::memoryEstimate(const Options &options)
+{
+    // Spare buffers are kept for every read and write in flight plus two,
+    // each reserved a quarter larger than a chunk
+    uint64_t chunkSize = std::max<size_t>(options.chunkSize, 4096);
+    uint64_t buffers = std::max(1u, options.readsInFlight) + std::max(1u, options.writesInFlight) + 2;
+    return buffers * (chunkSize + chunkSize / 4) + DeflateStream::memoryEstimate(chunkSize);
+}
+
+const char *BatchPipeline::backendName() const
+{
+    return m_io->backendName();
+}
+
+std::vector<BatchPipeline::JobResult> BatchPipeline::run(const std::vector<Job> &jobs, const JobCallback &onJobFinished)
+{
+    std::vector<JobResult> results;
+    results.reserve(jobs.size());
+
+    PipelineRun run(jobs, m_options, *m_io);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        results.push_back(run.runJob(i));
+        if (onJobFinished) {
+            onJobFinished(i, results.back());
+        }
+    }
+
+    return results;
+}
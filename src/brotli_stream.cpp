@@ -0,0 +1,244 @@
+#include "brotli_stream.h"
+#include "cancellation_token.h"
+#include "input_source.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#ifdef HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+namespace {
+
+const char *const UnavailableMessage = "Esta versión se compiló sin soporte para brotli";
+
+} // namespace
+
+bool BrotliStream::available()
+{
+#ifdef HAVE_BROTLI
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t BrotliStream::memoryEstimate(const Options &options)
+{
+#ifdef HAVE_BROTLI
+    // Measured peaks: the window ring buffer plus hash chains that grow with
+    // quality (a binary tree over the whole window at 10-11)
+    uint64_t window = uint64_t(1) << std::clamp(options.windowBits, MinWindowBits, MaxWindowBits);
+    int quality = std::clamp(options.quality, MinQuality, MaxQuality);
+    uint64_t encoder = quality >= 10 ? 16 * window
+                     : quality >= 5 ? 11 * window
+                     : 2 * window + 1024 * 1024;
+    return encoder + DeflateStream::DefaultBufferSize;
+#else
+    (void)options;
+    return 0;
+#endif
+}
+
+BrotliStream::BrotliStream()
+    : BrotliStream(Options())
+{
+}
+
+BrotliStream::BrotliStream(const Options &options, size_t bufferSize)
+    : m_state(nullptr)
+    , m_options(options)
+    , m_finished(false)
+    , m_bufferSize(std::max<size_t>(bufferSize, 4096))
+    , m_totalIn(0)
+    , m_totalOut(0)
+    , m_cancel(nullptr)
+{
+    m_options.quality = std::clamp(m_options.quality, MinQuality, MaxQuality);
+    m_options.windowBits = std::clamp(m_options.windowBits, MinWindowBits, MaxWindowBits);
+    m_outBuffer.resize(m_bufferSize);
+
+#ifdef HAVE_BROTLI
+    m_state = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+    if (!m_state) {
+        m_errorMessage = "No se pudo inicializar brotli";
+        return;
+    }
+    BrotliEncoderSetParameter(m_state, BROTLI_PARAM_QUALITY, static_cast<uint32_t>(m_options.quality));
+    BrotliEncoderSetParameter(m_state, BROTLI_PARAM_LGWIN, static_cast<uint32_t>(m_options.windowBits));
+#else
+    m_errorMessage = UnavailableMessage;
+#endif
+}
+
+BrotliStream::~BrotliStream()
+{
+#ifdef HAVE_BROTLI
+    if (m_state) {
+        BrotliEncoderDestroyInstance(m_state);
+    }
+#endif
+}
+
+void BrotliStream::setExpectedSize(uint64_t size)
+{
+#ifdef HAVE_BROTLI
+    if (m_state && m_totalIn == 0) {
+        uint64_t hint = std::min<uint64_t>(size, uint64_t(1) << 30);
+        BrotliEncoderSetParameter(m_state, BROTLI_PARAM_SIZE_HINT, static_cast<uint32_t>(hint));
+    }
+#else
+    (void)size;
+#endif
+}
+
+bool BrotliStream::write(const unsigned char *data, size_t size, const DeflateStream::Sink &sink)
+{
+    if (!m_state || m_finished) {
+        if (m_errorMessage.empty()) {
+            m_errorMessage = "El flujo de compresión ya fue cerrado";
+        }
+        return false;
+    }
+
+    while (size > 0) {
+        if (CancellationToken::cancelled(m_cancel)) {
+            m_errorMessage = CancellationToken::CancelledMessage;
+            return false;
+        }
+        size_t slice = std::min(size, m_bufferSize);
+        if (!compressBuffer(data, slice, false, sink)) {
+            return false;
+        }
+        data += slice;
+        size -= slice;
+    }
+    return true;
+}
+
+bool BrotliStream::finish(const DeflateStream::Sink &sink)
+{
+    if (!m_state || m_finished) {
+        if (m_errorMessage.empty()) {
+            m_errorMessage = "El flujo de compresión ya fue cerrado";
+        }
+        return false;
+    }
+
+    bool ok = compressBuffer(nullptr, 0, true, sink);
+    m_finished = true;
+    return ok;
+}
+
+bool BrotliStream::compressBuffer(const unsigned char *data, size_t size, bool end, const DeflateStream::Sink &sink)
+{
+#ifdef HAVE_BROTLI
+    const uint8_t *nextIn = data;
+    size_t availableIn = size;
+    BrotliEncoderOperation operation = end ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_PROCESS;
+
+    // process: until the input is taken; finish: until the stream is complete
+    while (true) {
+        uint8_t *nextOut = m_outBuffer.data();
+        size_t availableOut = m_outBuffer.size();
+        if (!BrotliEncoderCompressStream(m_state, operation, &availableIn, &nextIn, &availableOut, &nextOut,
+                                         nullptr)) {
+            m_errorMessage = "Error en la compresión brotli";
+            return false;
+        }
+
+        size_t produced = m_outBuffer.size() - availableOut;
+        if (produced > 0) {
+            if (!sink(m_outBuffer.data(), produced)) {
+                if (m_errorMessage.empty()) {
+                    m_errorMessage = "Error al escribir los datos comprimidos";
+                }
+                return false;
+            }
+            m_totalOut += produced;
+        }
+
+        bool done = end ? BrotliEncoderIsFinished(m_state)
+                        : availableIn == 0 && !BrotliEncoderHasMoreOutput(m_state);
+        if (done) {
+            break;
+        }
+    }
+
+    m_totalIn += size;
+    return true;
+#else
+    (void)data;
+    (void)size;
+    (void)end;
+    (void)sink;
+    m_errorMessage = UnavailableMessage;
+    return false;
+#endif
+}
+
+bool BrotliStream::compressFile(const std::string &inputPath, const std::string &outputPath,
+                                const DeflateStream::ProgressCallback &progress)
+{
+    if (!m_state) {
+        return false;
+    }
+
+    InputSource inputFile;
+    if (!inputFile.open(inputPath)) {
+        m_errorMessage = inputFile.errorMessage();
+        return false;
+    }
+    uint64_t totalBytes = inputFile.knownSize();
+    if (totalBytes > 0) {
+        setExpectedSize(totalBytes);
+    }
+
+    std::ofstream outputFile(outputPath, std::ios::binary | std::ios::trunc);
+    if (!outputFile.is_open()) {
+        m_errorMessage = "No se pudo crear el archivo de salida";
+        return false;
+    }
+
+    DeflateStream::Sink sink = [&outputFile](const unsigned char *data, size_t size) {
+        outputFile.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(outputFile);
+    };
+
+    auto abandon = [&](const std::string &message) {
+        if (!message.empty()) {
+            m_errorMessage = message;
+        }
+        outputFile.close();
+        std::remove(outputPath.c_str());
+        return false;
+    };
+
+    std::vector<unsigned char> inBuffer(InputSource::ReadBlockSize);
+    while (true) {
+        long long got = inputFile.read(inBuffer.data(), inBuffer.size());
+        if (got < 0) {
+            return abandon(inputFile.errorMessage());
+        }
+        if (got == 0) {
+            break;
+        }
+        if (!write(inBuffer.data(), static_cast<size_t>(got), sink)) {
+            return abandon(std::string());
+        }
+        if (progress) {
+            progress(m_totalIn, totalBytes);
+        }
+    }
+
+    if (!finish(sink)) {
+        return abandon(std::string());
+    }
+
+    outputFile.close();
+    if (!outputFile) {
+        return abandon("Error al escribir los datos comprimidos");
+    }
+    return true;
+}
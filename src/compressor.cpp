@@ -3,16 +3,34 @@
 #include <QDir>
 #include <QDebug>
 #include <QImage>
+#include <QImageReader>
 #include <QImageWriter>
 #include <QBuffer>
 #include <QDataStream>
 #include <QIODevice>
 #include <QProcess>
 #include <QThread>
+#include <QVector>
+#include <QSet>
 #include <zlib.h>
 #include <png.h>
 #include <jpeglib.h>
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include "cancellation_token.h"
+#include "cpu_count.h"
+#include "deflate_stream.h"
+#include "parallel_deflate.h"
+#include "parallel_gzip.h"
+#include "batch_pipeline.h"
+#include "file_copy.h"
+#include "parallel_batch.h"
+#include "memory_budget.h"
+#include "work_stealing_pool.h"
+#include "xz_stream.h"
+#include "zstd_stream.h"
 
 // PIMPL implementation
 class Compressor::Impl
@@ -21,14 +39,87 @@ public:
     // Image compression using Qt
     static CompressionResult compressImageQt(const QString &inputPath, const QString &outputPath);
     
-    // ZIP compression using zlib
-    static CompressionResult compressZip(const QString &inputPath, const QString &outputPath);
+    // ZIP compression using zlib, one block per core
+    static CompressionResult compressZip(const QString &inputPath, const QString &outputPath,
+                                         size_t bufferSize, unsigned threads,
+                                         const DeflateStream::ProgressCallback &progress,
+                                         const CancellationToken *cancel);
     
-    // GZIP compression using zlib
-    static CompressionResult compressGzip(const QString &inputPath, const QString &outputPath);
+    // GZIP compression using zlib, one block per core
+    static CompressionResult compressGzip(const QString &inputPath, const QString &outputPath,
+                                          unsigned threads, const DeflateStream::ProgressCallback &progress,
+                                          const CancellationToken *cancel);
+    
+    // Single .zst frame; libzstd's own workers when options.workers > 0
+    static CompressionResult compressZstd(const QString &inputPath, const QString &outputPath,
+                                          const ZstdStream::Options &options,
+                                          const DeflateStream::ProgressCallback &progress,
+                                          const CancellationToken *cancel);
+    
+    // .xz stream; liblzma's multithreaded encoder when options.threads > 1
+    static CompressionResult compressXz(const QString &inputPath, const QString &outputPath,
+                                        const XzStream::Options &options,
+                                        const DeflateStream::ProgressCallback &progress,
+                                        const CancellationToken *cancel);
     
     // PDF compression (basic implementation)
-    static CompressionResult compressPdf(const QString &inputPath, const QString &outputPath);
+    static CompressionResult compressPdf(const QString &inputPath, const QString &outputPath,
+                                         const CancellationToken *cancel);
+
+    // Stored (uncompressed) copy done inside the kernel where possible
+    static CompressionResult storeFile(const QString &inputPath, const QString &outputPath,
+                                       const FileCopy::ProgressCallback &progress,
+                                       const CancellationToken *cancel);
+
+    // 4-byte big-endian size prefix that qUncompress expects
+    static std::vector<unsigned char> qCompressHeader(qint64 inputSize);
+
+    // Memory a batch job is charged before it starts (see MemoryBudget)
+    static quint64 memoryEstimate(const QString &inputPath, const QString &compressionType, bool pipelined,
+                                  const BatchPipeline::Options &pipelineOptions, unsigned threads,
+                                  const ZstdStream::Options &zstdOptions, const XzStream::Options &xzOptions);
+
+    // Settings for the "xz" type; parallel unless called from a batch worker
+    XzStream::Options xzOptions() const;
+
+    // Chunked single-stream deflate path
+    static CompressionResult compressStream(const QString &inputPath, const QString &outputPath,
+                                            DeflateStream::Format format, const std::vector<unsigned char> &header,
+                                            size_t bufferSize, const DeflateStream::ProgressCallback &progress,
+                                            const CancellationToken *cancel);
+
+    // Result for a file skipped or abandoned by cancel()
+    static CompressionResult cancelledResult(const QString &inputPath);
+
+    // Streaming buffer size used by single-threaded compressZip and batches
+    size_t bufferSize = DeflateStream::DefaultBufferSize;
+
+    // Compression threads for compressZip/compressGzip (0 = CpuCount::available())
+    unsigned threadCount = 0;
+
+    // Settings for the "zstd" type
+    int zstdLevel = ZstdStream::DefaultLevel;
+    bool longDistance = false;
+
+    // Settings for the "xz" type
+    int xzLevel = XzStream::DefaultLevel;
+    quint64 xzBlockSize = 0;
+
+    // Parallel files in compressMultipleFiles (0 = CpuCount::available())
+    unsigned workerCount = 0;
+
+    // Admission limit for compressMultipleFiles (0 = none) and its last peak
+    quint64 memoryBudget = 0;
+    std::atomic<quint64> peakMemory{0};
+
+    // Progress may be reported from several batch workers at once
+    std::mutex progressMutex;
+
+    // Per-file progress is muted while a batch reports aggregated progress
+    bool fileProgress = true;
+
+    // Set by cancel(), cleared by resetCancellation() before the next run
+    CancellationToken cancellation;
 };
 
 Compressor::Compressor(QObject *parent)
@@ -44,8 +135,117 @@ void Compressor::setProgressCallback(ProgressCallback callback)
     m_progressCallback = callback;
 }
 
+void Compressor::setBufferSize(size_t bytes)
+{
+    m_impl->bufferSize = bytes;
+}
+
+size_t Compressor::bufferSize() const
+{
+    return m_impl->bufferSize;
+}
+
+void Compressor::setThreadCount(unsigned threads)
+{
+    m_impl->threadCount = threads;
+}
+
+unsigned Compressor::threadCount() const
+{
+    return m_impl->threadCount;
+}
+
+void Compressor::setZstdLevel(int level)
+{
+    m_impl->zstdLevel = std::clamp(level, ZstdStream::MinLevel, ZstdStream::MaxLevel);
+}
+
+int Compressor::zstdLevel() const
+{
+    return m_impl->zstdLevel;
+}
+
+void Compressor::setLongDistanceMatching(bool enabled)
+{
+    m_impl->longDistance = enabled;
+}
+
+bool Compressor::longDistanceMatching() const
+{
+    return m_impl->longDistance;
+}
+
+void Compressor::setXzLevel(int level)
+{
+    m_impl->xzLevel = std::clamp(level, XzStream::MinLevel, XzStream::MaxLevel);
+}
+
+int Compressor::xzLevel() const
+{
+    return m_impl->xzLevel;
+}
+
+void Compressor::setXzBlockSize(quint64 bytes)
+{
+    m_impl->xzBlockSize = bytes;
+}
+
+quint64 Compressor::xzBlockSize() const
+{
+    return m_impl->xzBlockSize;
+}
+
+quint64 Compressor::xzMemoryEstimate() const
+{
+    return XzStream::memoryEstimate(m_impl->xzOptions());
+}
+
+void Compressor::setWorkerCount(unsigned workers)
+{
+    m_impl->workerCount = workers;
+}
+
+unsigned Compressor::workerCount() const
+{
+    return m_impl->workerCount;
+}
+
+void Compressor::setMemoryBudget(quint64 bytes)
+{
+    m_impl->memoryBudget = bytes;
+}
+
+quint64 Compressor::memoryBudget() const
+{
+    return m_impl->memoryBudget;
+}
+
+quint64 Compressor::peakMemory() const
+{
+    return m_impl->peakMemory;
+}
+
+void Compressor::cancel()
+{
+    m_impl->cancellation.cancel();
+}
+
+void Compressor::resetCancellation()
+{
+    m_impl->cancellation.reset();
+}
+
 CompressionResult Compressor::compressFile(const QString &inputPath, const QString &outputPath, const QString &compressionType)
 {
+    return compressSingleFile(inputPath, outputPath, compressionType);
+}
+
+CompressionResult Compressor::compressSingleFile(const QString &inputPath, const QString &outputPath, const QString &compressionType)
+{
+    if (m_impl->cancellation.isCancelled()) {
+        return Impl::cancelledResult(inputPath);
+    }
+
     try {
         QString extension = getFileExtension(inputPath).toLower();
         
@@ -67,76 +267,224 @@ CompressionResult Compressor::compressFile(const QString &inputPath, const QStri
 
 QList<CompressionResult> Compressor::compressMultipleFiles(const QStringList &filePaths, const QString &outputDir, const QString &compressionType)
 {
-    QList<CompressionResult> results;
+    std::vector<CompressionResult> results(static_cast<size_t>(filePaths.size()));
+    std::vector<uint64_t> fileSizes(static_cast<size_t>(filePaths.size()));
+    QVector<QString> outputPaths(filePaths.size());
+    QVector<bool> pipelinedFiles(filePaths.size(), false);
+    QVector<bool> duplicateOutputs(filePaths.size(), false);
+    QSet<QString> usedOutputs;
     int totalFiles = filePaths.size();
+    int completed = 0;
+    std::mutex completedMutex;
+
+    // General zip/gzip files go through the asynchronous read/deflate/write pipeline
+    const bool pipelined = compressionType == "zip" || compressionType == "gzip";
     
     for (int i = 0; i < filePaths.size(); ++i) {
-        const QString &filePath = filePaths[i];
+        // Create output filename
+        QFileInfo fileInfo(filePaths[i]);
+        // Whole names, so a.txt and a.log (or x.tar.gz and x.txt) get distinct outputs
+        QString fileName = fileInfo.fileName();
+        QString baseName = fileInfo.completeBaseName();
+        QString extension = fileInfo.suffix().toLower();
+        fileSizes[static_cast<size_t>(i)] = static_cast<uint64_t>(std::max<qint64>(fileInfo.size(), 0));
         
-        try {
-            // Create output filename
-            QFileInfo fileInfo(filePath);
-            QString baseName = fileInfo.baseName();
-            QString extension = fileInfo.suffix().toLower();
-            QString outputPath;
-            
-            if (extension == "png" || extension == "jpg" || extension == "jpeg" || 
-                extension == "bmp" || extension == "tiff" || extension == "tif") {
-                outputPath = QString("%1/%2_compressed.%3").arg(outputDir, baseName, extension);
-            } else if (extension == "pdf") {
-                outputPath = QString("%1/%2_compressed.%3").arg(outputDir, baseName, extension);
+        if (extension == "png" || extension == "jpg" || extension == "jpeg" || 
+            extension == "bmp" || extension == "tiff" || extension == "tif") {
+            outputPaths[i] = QString("%1/%2_compressed.%3").arg(outputDir, baseName, extension);
+        } else if (extension == "pdf") {
+            outputPaths[i] = QString("%1/%2_compressed.%3").arg(outputDir, baseName, extension);
+        } else {
+            // Large files are split into deflate blocks that idle workers steal
+            pipelinedFiles[i] = pipelined && fileSizes[static_cast<size_t>(i)] < ParallelBatch::SplitThreshold;
+            if (compressionType == "zip") {
+                outputPaths[i] = QString("%1/%2.zip").arg(outputDir, fileName);
+            } else if (compressionType == "zstd") {
+                outputPaths[i] = QString("%1/%2.zst").arg(outputDir, fileName);
+            } else if (compressionType == "xz") {
+                outputPaths[i] = QString("%1/%2.xz").arg(outputDir, fileName);
+            } else if (compressionType == "store") {
+                outputPaths[i] = extension.isEmpty()
+                    ? QString("%1/%2_stored").arg(outputDir, baseName)
+                    : QString("%1/%2_stored.%3").arg(outputDir, baseName, extension);
             } else {
+                outputPaths[i] = QString("%1/%2.gz").arg(outputDir, fileName);
+            }
+        }
+
+        // Files run concurrently: a second input writing the same output
+        // (same name from another folder) would corrupt the first one's
+        QString key = QDir::cleanPath(QFileInfo(outputPaths[i]).absoluteFilePath());
+        duplicateOutputs[i] = usedOutputs.contains(key);
+        usedOutputs.insert(key);
+    }
+
+    ParallelBatch batch(m_impl->workerCount);
+    MemoryBudget budget(m_impl->memoryBudget);
+
+    // One pipeline (and I/O backend) per worker, created on first use
+    std::vector<std::unique_ptr<BatchPipeline>> pipelines(batch.workerCount());
+    ZstdStream::Options zstdOptions;
+    zstdOptions.level = m_impl->zstdLevel;
+    zstdOptions.longDistance = m_impl->longDistance;
+    // Batch workers compress one xz file each, single-threaded
+    XzStream::Options xzOptions = m_impl->xzOptions();
+    xzOptions.threads = 0;
+    BatchPipeline::Options pipelineOptions;
+    pipelineOptions.chunkSize = m_impl->bufferSize;
+    pipelineOptions.cancel = &m_impl->cancellation;
+
+    m_impl->fileProgress = totalFiles <= 1;
+
+    auto finishFile = [&](size_t index, const CompressionResult &result) {
+        // Each worker owns a distinct slot, so results stay in input order
+        results[index] = result;
+
+        // Update progress
+        std::lock_guard<std::mutex> lock(completedMutex);
+        ++completed;
+        int progress = (completed * 100) / totalFiles;
+        updateProgress(QString("Progreso: %1/%2 archivos").arg(completed).arg(totalFiles), progress);
+    };
+
+    batch.run(static_cast<size_t>(totalFiles), [&](size_t index, unsigned worker) {
+        int i = static_cast<int>(index);
+        const QString &filePath = filePaths.at(i);
+        const QString &outputPath = outputPaths.at(i);
+        CompressionResult result;
+
+        if (duplicateOutputs.at(i)) {
+            result.success = false;
+            result.filename = QFileInfo(filePath).fileName();
+            result.errorMessage = QString("Otro archivo de la lista ya se comprime en %1").arg(outputPath);
+            finishFile(index, result);
+            return;
+        }
+        if (m_impl->cancellation.isCancelled()) {
+            // Files not started yet fail straight away, without waiting for budget
+            finishFile(index, Impl::cancelledResult(filePath));
+            return;
+        }
+        
+        try {
+            MemoryBudget::Reservation reservation(budget, Impl::memoryEstimate(filePath, compressionType,
+                                                                              pipelinedFiles.at(i),
+                                                                              pipelineOptions,
+                                                                              m_impl->threadCount,
+                                                                              zstdOptions, xzOptions));
+            if (m_impl->cancellation.isCancelled()) {
+                // Cancelled while waiting for budget
+                result = Impl::cancelledResult(filePath);
+            } else if (pipelinedFiles.at(i)) {
+                BatchPipeline::Job job;
+                job.inputPath = QFile::encodeName(filePath).toStdString();
+                job.outputPath = QFile::encodeName(outputPath).toStdString();
                 if (compressionType == "zip") {
-                    outputPath = QString("%1/%2.zip").arg(outputDir, baseName);
+                    job.format = DeflateStream::Format::Zlib;
+                    job.header = Impl::qCompressHeader(QFileInfo(filePath).size());
                 } else {
-                    outputPath = QString("%1/%2.gz").arg(outputDir, baseName);
+                    job.format = DeflateStream::Format::Gzip;
+                }
+
+                if (!pipelines[worker]) {
+                    pipelines[worker] = std::make_unique<BatchPipeline>(pipelineOptions);
                 }
+                BatchPipeline::JobResult jobResult = pipelines[worker]->run({job}).front();
+                result.success = jobResult.success;
+                result.originalSize = static_cast<qint64>(jobResult.bytesIn);
+                result.compressedSize = static_cast<qint64>(jobResult.bytesOut);
+                result.compressionRatio = calculateCompressionRatio(result.originalSize, result.compressedSize);
+                result.errorMessage = QString::fromStdString(jobResult.errorMessage);
+            } else {
+                // Compress file
+                result = compressSingleFile(filePath, outputPath, compressionType);
             }
-            
-            // Compress file
-            CompressionResult result = compressFile(filePath, outputPath, compressionType);
-            result.filename = fileInfo.fileName();
+            result.filename = QFileInfo(filePath).fileName();
             result.outputPath = outputPath;
-            results.append(result);
-            
-            // Update progress
-            int progress = ((i + 1) * 100) / totalFiles;
-            updateProgress(QString("Progreso: %1/%2 archivos").arg(i + 1).arg(totalFiles), progress);
             
         } catch (const std::exception &e) {
-            CompressionResult result;
+            result = CompressionResult();
             result.success = false;
             result.filename = QFileInfo(filePath).fileName();
             result.errorMessage = QString("Error: %1").arg(e.what());
-            results.append(result);
         }
+
+        finishFile(index, result);
+    }, fileSizes);
+
+    m_impl->peakMemory = budget.peak();
+
+    m_impl->fileProgress = true;
+
+    QList<CompressionResult> orderedResults;
+    for (const CompressionResult &result : results) {
+        orderedResults.append(result);
     }
-    
-    return results;
+    return orderedResults;
 }
 
 CompressionResult Compressor::compressImage(const QString &inputPath, const QString &outputPath)
 {
-    updateProgress(QString("Comprimiendo imagen: %1").arg(QFileInfo(inputPath).fileName()), 10);
+    updateFileProgress(QString("Comprimiendo imagen: %1").arg(QFileInfo(inputPath).fileName()), 10);
     
     return Impl::compressImageQt(inputPath, outputPath);
 }
 
 CompressionResult Compressor::compressPDF(const QString &inputPath, const QString &outputPath)
 {
-    updateProgress(QString("Comprimiendo PDF: %1").arg(QFileInfo(inputPath).fileName()), 10);
+    updateFileProgress(QString("Comprimiendo PDF: %1").arg(QFileInfo(inputPath).fileName()), 10);
     
-    return Impl::compressPdf(inputPath, outputPath);
+    return Impl::compressPdf(inputPath, outputPath, &m_impl->cancellation);
 }
 
 CompressionResult Compressor::compressGeneralFile(const QString &inputPath, const QString &outputPath, const QString &compressionType)
 {
-    updateProgress(QString("Comprimiendo archivo: %1").arg(QFileInfo(inputPath).fileName()), 10);
+    QString message = QString("Comprimiendo archivo: %1").arg(QFileInfo(inputPath).fileName());
+    updateFileProgress(message, 0);
+
+    // Report from the stream's total_in, only when the percentage changes
+    int lastPercentage = -1;
+    DeflateStream::ProgressCallback progress = [this, message, lastPercentage](uint64_t bytesIn, uint64_t totalBytes) mutable {
+        int percentage = totalBytes > 0 ? static_cast<int>((bytesIn * 100) / totalBytes) : 100;
+        if (percentage != lastPercentage) {
+            lastPercentage = percentage;
+            updateFileProgress(message, percentage);
+        }
+    };
     
     if (compressionType == "zip") {
-        return Impl::compressZip(inputPath, outputPath);
+        return Impl::compressZip(inputPath, outputPath, m_impl->bufferSize, m_impl->threadCount, progress,
+                                 &m_impl->cancellation);
     } else if (compressionType == "gzip") {
-        return Impl::compressGzip(inputPath, outputPath);
+        return Impl::compressGzip(inputPath, outputPath, m_impl->threadCount, progress, &m_impl->cancellation);
+    } else if (compressionType == "zstd") {
+        ZstdStream::Options options;
+        options.level = m_impl->zstdLevel;
+        options.longDistance = m_impl->longDistance;
+        // Batch workers already fill every CPU, one frame each
+        if (!WorkStealingPool::current()) {
+            unsigned threads = m_impl->threadCount > 0 ? m_impl->threadCount : CpuCount::available();
+            options.workers = threads > 1 ? threads : 0;
+        }
+        return Impl::compressZstd(inputPath, outputPath, options, progress, &m_impl->cancellation);
+    } else if (compressionType == "xz") {
+        XzStream::Options options = m_impl->xzOptions();
+        // Batch workers were already admitted by the budget; a single file
+        // that does not fit even with one thread is refused
+        quint64 estimate = XzStream::memoryEstimate(options);
+        if (!WorkStealingPool::current() && m_impl->memoryBudget > 0 && estimate > m_impl->memoryBudget) {
+            CompressionResult result;
+            result.success = false;
+            result.filename = QFileInfo(inputPath).fileName();
+            result.errorMessage = QString("xz nivel %1 necesita %2 MB de memoria y el límite es %3 MB")
+                                      .arg(options.level)
+                                      .arg(estimate / (1024 * 1024))
+                                      .arg(m_impl->memoryBudget / (1024 * 1024));
+            return result;
+        }
+        return Impl::compressXz(inputPath, outputPath, options, progress, &m_impl->cancellation);
+    } else if (compressionType == "store") {
+        return Impl::storeFile(inputPath, outputPath, progress, &m_impl->cancellation);
     } else {
         CompressionResult result;
         result.success = false;
@@ -164,12 +512,20 @@ double Compressor::calculateCompressionRatio(qint64 originalSize, qint64 compres
 
 void Compressor::updateProgress(const QString &message, int percentage)
 {
+    std::lock_guard<std::mutex> lock(m_impl->progressMutex);
     if (m_progressCallback) {
         m_progressCallback(message, percentage);
     }
     emit progressUpdated(message, percentage);
 }
 
+void Compressor::updateFileProgress(const QString &message, int percentage)
+{
+    if (m_impl->fileProgress) {
+        updateProgress(message, percentage);
+    }
+}
+
 // PIMPL Implementation
 CompressionResult Compressor::Impl::compressImageQt(const QString &inputPath, const QString &outputPath)
 {
@@ -200,118 +556,250 @@ CompressionResult Compressor::Impl::compressImageQt(const QString &inputPath, co
     // Calculate sizes
     qint64 originalSize = QFileInfo(inputPath).size();
     qint64 compressedSize = QFileInfo(outputPath).size();
-    double ratio = ((originalSize - compressedSize) * 100.0) / originalSize;
+    double ratio = originalSize > 0 ? ((originalSize - compressedSize) * 100.0) / originalSize : 0.0;
     
     return CompressionResult(true, QFileInfo(inputPath).fileName(), outputPath, originalSize, compressedSize, ratio);
 }
 
-CompressionResult Compressor::Impl::compressZip(const QString &inputPath, const QString &outputPath)
+CompressionResult Compressor::Impl::compressZip(const QString &inputPath, const QString &outputPath,
+                                                size_t bufferSize, unsigned threads,
+                                                const DeflateStream::ProgressCallback &progress,
+                                                const CancellationToken *cancel)
 {
-    QFile inputFile(inputPath);
-    if (!inputFile.open(QIODevice::ReadOnly)) {
-        CompressionResult result;
-        result.success = false;
-        result.errorMessage = "No se pudo abrir el archivo de entrada";
-        return result;
+    // Keep the qCompress layout (size prefix, then a zlib stream) so existing
+    // qUncompress readers still work
+    std::vector<unsigned char> header = qCompressHeader(QFileInfo(inputPath).size());
+
+    ParallelDeflate::Options options;
+    options.threads = threads;
+    options.format = DeflateStream::Format::Zlib;
+    options.cancel = cancel;
+
+    ParallelDeflate deflater(options);
+    if (deflater.threadCount() <= 1) {
+        // A single thread gains nothing from blocks and would lose a little ratio
+        return compressStream(inputPath, outputPath, DeflateStream::Format::Zlib, header, bufferSize, progress,
+                              cancel);
     }
-    
-    QFile outputFile(outputPath);
-    if (!outputFile.open(QIODevice::WriteOnly)) {
+
+    if (!deflater.compressFile(QFile::encodeName(inputPath).toStdString(),
+                               QFile::encodeName(outputPath).toStdString(), progress, header)) {
+        QFile::remove(outputPath);
         CompressionResult result;
         result.success = false;
-        result.errorMessage = "No se pudo crear el archivo de salida";
+        result.errorMessage = QString::fromStdString(deflater.errorMessage());
         return result;
     }
-    
-    // Read input file
-    QByteArray inputData = inputFile.readAll();
-    inputFile.close();
-    
-    // Compress with zlib
-    QByteArray compressedData = qCompress(inputData, 9); // Maximum compression
-    
-    // Write compressed data
-    outputFile.write(compressedData);
-    outputFile.close();
-    
+
     // Calculate sizes
-    qint64 originalSize = inputData.size();
-    qint64 compressedSize = compressedData.size();
-    double ratio = ((originalSize - compressedSize) * 100.0) / originalSize;
-    
+    qint64 originalSize = static_cast<qint64>(deflater.totalIn());
+    qint64 compressedSize = QFileInfo(outputPath).size();
+    double ratio = originalSize > 0 ? ((originalSize - compressedSize) * 100.0) / originalSize : 0.0;
+
     return CompressionResult(true, QFileInfo(inputPath).fileName(), outputPath, originalSize, compressedSize, ratio);
 }
 
-CompressionResult Compressor::Impl::compressGzip(const QString &inputPath, const QString &outputPath)
+quint64 Compressor::Impl::memoryEstimate(const QString &inputPath, const QString &compressionType, bool pipelined,
+                                         const BatchPipeline::Options &pipelineOptions, unsigned threads,
+                                         const ZstdStream::Options &zstdOptions, const XzStream::Options &xzOptions)
+{
+    QFileInfo fileInfo(inputPath);
+    QString extension = fileInfo.suffix().toLower();
+    quint64 fileSize = static_cast<quint64>(std::max<qint64>(fileInfo.size(), 0));
+
+    if (extension == "png" || extension == "jpg" || extension == "jpeg" ||
+        extension == "bmp" || extension == "tiff" || extension == "tif") {
+        // Encoded file, decoded RGB32 image, its converted copy and the output
+        QSize size = QImageReader(inputPath).size();
+        quint64 pixels = size.isValid() ? static_cast<quint64>(size.width()) * static_cast<quint64>(size.height()) : 0;
+        return 2 * fileSize + 2 * pixels * 4;
+    }
+    if (extension == "pdf" || compressionType == "store") {
+        // Kernel copies need no buffer; the read()/write() fallback uses 1 MiB
+        return 1024 * 1024;
+    }
+    if (pipelined) {
+        return BatchPipeline::memoryEstimate(pipelineOptions);
+    }
+    if (compressionType == "zstd") {
+        return ZstdStream::memoryEstimate(zstdOptions);
+    }
+    if (compressionType == "xz") {
+        return XzStream::memoryEstimate(xzOptions);
+    }
+
+    ParallelDeflate::Options options;
+    options.threads = threads;
+    return ParallelDeflate(options).memoryEstimate();
+}
+
+XzStream::Options Compressor::Impl::xzOptions() const
+{
+    XzStream::Options options;
+    options.level = xzLevel;
+    options.blockSize = xzBlockSize;
+    // Batch workers already fill every CPU, one stream each
+    if (!WorkStealingPool::current()) {
+        options.threads = threadCount > 0 ? threadCount : CpuCount::available();
+        // Fewer threads rather than more encoder memory than the budget
+        while (memoryBudget > 0 && options.threads > 1 && XzStream::memoryEstimate(options) > memoryBudget) {
+            --options.threads;
+        }
+    }
+    return options;
+}
+
+std::vector<unsigned char> Compressor::Impl::qCompressHeader(qint64 inputSize)
+{
+    // Sizes beyond QByteArray's limit store 0; qUncompress could not hold them anyway
+    quint32 sizeHint = (inputSize >= 0 && inputSize <= 0x7fffffff) ? static_cast<quint32>(inputSize) : 0;
+    return {
+        static_cast<unsigned char>((sizeHint >> 24) & 0xff),
+        static_cast<unsigned char>((sizeHint >> 16) & 0xff),
+        static_cast<unsigned char>((sizeHint >> 8) & 0xff),
+        static_cast<unsigned char>(sizeHint & 0xff)
+    };
+}
+
+CompressionResult Compressor::Impl::compressGzip(const QString &inputPath, const QString &outputPath,
+                                                 unsigned threads, const DeflateStream::ProgressCallback &progress,
+                                                 const CancellationToken *cancel)
 {
-    QFile inputFile(inputPath);
-    if (!inputFile.open(QIODevice::ReadOnly)) {
+    ParallelGzipWriter::Options options;
+    options.threads = threads;
+    options.cancel = cancel;
+
+    ParallelGzipWriter writer(options);
+    if (!writer.compressFile(QFile::encodeName(inputPath).toStdString(),
+                             QFile::encodeName(outputPath).toStdString(), progress)) {
+        QFile::remove(outputPath);
         CompressionResult result;
         result.success = false;
-        result.errorMessage = "No se pudo abrir el archivo de entrada";
+        result.errorMessage = QString::fromStdString(writer.errorMessage());
         return result;
     }
-    
-    QFile outputFile(outputPath);
-    if (!outputFile.open(QIODevice::WriteOnly)) {
+
+    // Calculate sizes
+    qint64 originalSize = static_cast<qint64>(writer.totalIn());
+    qint64 compressedSize = QFileInfo(outputPath).size();
+    double ratio = originalSize > 0 ? ((originalSize - compressedSize) * 100.0) / originalSize : 0.0;
+
+    return CompressionResult(true, QFileInfo(inputPath).fileName(), outputPath, originalSize, compressedSize, ratio);
+}
+
+CompressionResult Compressor::Impl::compressStream(const QString &inputPath, const QString &outputPath,
+                                                   DeflateStream::Format format, const std::vector<unsigned char> &header,
+                                                   size_t bufferSize, const DeflateStream::ProgressCallback &progress,
+                                                   const CancellationToken *cancel)
+{
+    DeflateStream stream(format, Z_BEST_COMPRESSION, bufferSize);
+    stream.setCancellationToken(cancel);
+    if (!stream.compressFile(QFile::encodeName(inputPath).toStdString(),
+                             QFile::encodeName(outputPath).toStdString(), progress, header)) {
+        QFile::remove(outputPath);
         CompressionResult result;
         result.success = false;
-        result.errorMessage = "No se pudo crear el archivo de salida";
+        result.errorMessage = QString::fromStdString(stream.errorMessage());
         return result;
     }
     
-    // Read input file
-    QByteArray inputData = inputFile.readAll();
-    inputFile.close();
-    
-    // Compress with zlib (gzip format)
-    QByteArray compressedData = qCompress(inputData, 9);
-    
-    // Write compressed data
-    outputFile.write(compressedData);
-    outputFile.close();
-    
     // Calculate sizes
-    qint64 originalSize = inputData.size();
-    qint64 compressedSize = compressedData.size();
-    double ratio = ((originalSize - compressedSize) * 100.0) / originalSize;
+    qint64 originalSize = static_cast<qint64>(stream.totalIn());
+    qint64 compressedSize = QFileInfo(outputPath).size();
+    double ratio = originalSize > 0 ? ((originalSize - compressedSize) * 100.0) / originalSize : 0.0;
     
     return CompressionResult(true, QFileInfo(inputPath).fileName(), outputPath, originalSize, compressedSize, ratio);
 }
 
-CompressionResult Compressor::Impl::compressPdf(const QString &inputPath, const QString &outputPath)
+CompressionResult Compressor::Impl::compressZstd(const QString &inputPath, const QString &outputPath,
+                                                 const ZstdStream::Options &options,
+                                                 const DeflateStream::ProgressCallback &progress,
+                                                 const CancellationToken *cancel)
 {
-    // For PDF compression, we'll use a simple approach
-    // In a real implementation, you might want to use a PDF library like Poppler
-    
-    QFile inputFile(inputPath);
-    if (!inputFile.open(QIODevice::ReadOnly)) {
+    ZstdStream stream(options);
+    stream.setCancellationToken(cancel);
+    if (!stream.compressFile(QFile::encodeName(inputPath).toStdString(),
+                             QFile::encodeName(outputPath).toStdString(), progress)) {
+        QFile::remove(outputPath);
         CompressionResult result;
         result.success = false;
-        result.errorMessage = "No se pudo abrir el archivo PDF";
+        result.errorMessage = QString::fromStdString(stream.errorMessage());
         return result;
     }
-    
-    QFile outputFile(outputPath);
-    if (!outputFile.open(QIODevice::WriteOnly)) {
+
+    // Calculate sizes
+    qint64 originalSize = static_cast<qint64>(stream.totalIn());
+    qint64 compressedSize = QFileInfo(outputPath).size();
+    double ratio = originalSize > 0 ? ((originalSize - compressedSize) * 100.0) / originalSize : 0.0;
+
+    return CompressionResult(true, QFileInfo(inputPath).fileName(), outputPath, originalSize, compressedSize, ratio);
+}
+
+CompressionResult Compressor::Impl::compressXz(const QString &inputPath, const QString &outputPath,
+                                               const XzStream::Options &options,
+                                               const DeflateStream::ProgressCallback &progress,
+                                               const CancellationToken *cancel)
+{
+    XzStream stream(options);
+    stream.setCancellationToken(cancel);
+    if (!stream.compressFile(QFile::encodeName(inputPath).toStdString(),
+                             QFile::encodeName(outputPath).toStdString(), progress)) {
+        QFile::remove(outputPath);
         CompressionResult result;
         result.success = false;
-        result.errorMessage = "No se pudo crear el archivo PDF de salida";
+        result.errorMessage = QString::fromStdString(stream.errorMessage());
         return result;
     }
-    
+
+    // Calculate sizes
+    qint64 originalSize = static_cast<qint64>(stream.totalIn());
+    qint64 compressedSize = QFileInfo(outputPath).size();
+    double ratio = originalSize > 0 ? ((originalSize - compressedSize) * 100.0) / originalSize : 0.0;
+
+    CompressionResult result(true, QFileInfo(inputPath).fileName(), outputPath, originalSize, compressedSize, ratio);
+    result.memoryUsage = stream.memoryUsage();
+    return result;
+}
+
+CompressionResult Compressor::Impl::compressPdf(const QString &inputPath, const QString &outputPath,
+                                                const CancellationToken *cancel)
+{
+    // For PDF compression, we'll use a simple approach
+    // In a real implementation, you might want to use a PDF library like Poppler
+
     // For now, just copy the file (basic implementation)
     // In a real implementation, you would use a PDF library to optimize the PDF
-    QByteArray pdfData = inputFile.readAll();
-    outputFile.write(pdfData);
-    
-    inputFile.close();
-    outputFile.close();
-    
+    return storeFile(inputPath, outputPath, nullptr, cancel);
+}
+
+CompressionResult Compressor::Impl::storeFile(const QString &inputPath, const QString &outputPath,
+                                              const FileCopy::ProgressCallback &progress,
+                                              const CancellationToken *cancel)
+{
+    FileCopy copier;
+    copier.setCancellationToken(cancel);
+    if (!copier.copy(QFile::encodeName(inputPath).toStdString(),
+                     QFile::encodeName(outputPath).toStdString(), progress)) {
+        QFile::remove(outputPath);
+        CompressionResult result;
+        result.success = false;
+        result.errorMessage = QString::fromStdString(copier.errorMessage());
+        return result;
+    }
+
     // Calculate sizes
-    qint64 originalSize = QFileInfo(inputPath).size();
+    qint64 originalSize = static_cast<qint64>(copier.bytesCopied());
     qint64 compressedSize = QFileInfo(outputPath).size();
-    double ratio = ((originalSize - compressedSize) * 100.0) / originalSize;
-    
+    double ratio = originalSize > 0 ? ((originalSize - compressedSize) * 100.0) / originalSize : 0.0;
+
     return CompressionResult(true, QFileInfo(inputPath).fileName(), outputPath, originalSize, compressedSize, ratio);
-} 
\ No newline at end of file
+}
+
+CompressionResult Compressor::Impl::cancelledResult(const QString &inputPath)
+{
+    CompressionResult result;
+    result.success = false;
+    result.filename = QFileInfo(inputPath).fileName();
+    result.errorMessage = CancellationToken::CancelledMessage;
+    return result;
+}
@@ -10,7 +10,14 @@
 #include <QProcess>
 #include <QThread>
 #include <zlib.h>
+#include <algorithm>
 #include <memory>
+#include <vector>
+#include "cancellation_token.h"
+#include "deflate_stream.h"
+#include "file_copy.h"
+#include "xz_stream.h"
+#include "zstd_stream.h"
 
 // PIMPL implementation
 class Compressor::Impl
@@ -27,6 +34,32 @@ public:
 
     // PDF compression (basic implementation)
     static CompressionResult compressPdf(const QString &inputPath, const QString &outputPath);
+
+    // Chunked deflate from file to file
+    static CompressionResult compressStream(const QString &inputPath, const QString &outputPath,
+                                            DeflateStream::Format format, const std::vector<unsigned char> &header,
+                                            const CancellationToken *cancel);
+
+    // Single .zst frame on the calling thread
+    static CompressionResult compressZstd(const QString &inputPath, const QString &outputPath,
+                                          const ZstdStream::Options &options, const CancellationToken *cancel);
+
+    // .xz stream on the calling thread
+    static CompressionResult compressXz(const QString &inputPath, const QString &outputPath,
+                                        const XzStream::Options &options, const CancellationToken *cancel);
+
+    // Settings for the "zstd" type
+    int zstdLevel = ZstdStream::DefaultLevel;
+    bool longDistance = false;
+
+    // Settings for the "xz" type
+    XzStream::Options xzOptions;
+
+    // Files run one at a time here, so the budget is only recorded
+    quint64 memoryBudget = 0;
+
+    // Set by cancel(), cleared by resetCancellation() before the next run
+    CancellationToken cancellation;
 };
 
 Compressor::Compressor(QObject *parent)
@@ -42,8 +75,91 @@ void Compressor::setProgressCallback(ProgressCallback callback)
     m_progressCallback = callback;
 }
 
+void Compressor::setZstdLevel(int level)
+{
+    m_impl->zstdLevel = std::clamp(level, ZstdStream::MinLevel, ZstdStream::MaxLevel);
+}
+
+int Compressor::zstdLevel() const
+{
+    return m_impl->zstdLevel;
+}
+
+void Compressor::setLongDistanceMatching(bool enabled)
+{
+    m_impl->longDistance = enabled;
+}
+
+bool Compressor::longDistanceMatching() const
+{
+    return m_impl->longDistance;
+}
+
+void Compressor::setXzLevel(int level)
+{
+    m_impl->xzOptions.level = std::clamp(level, XzStream::MinLevel, XzStream::MaxLevel);
+}
+
+int Compressor::xzLevel() const
+{
+    return m_impl->xzOptions.level;
+}
+
+void Compressor::setXzBlockSize(quint64 bytes)
+{
+    m_impl->xzOptions.blockSize = bytes;
+}
+
+quint64 Compressor::xzBlockSize() const
+{
+    return m_impl->xzOptions.blockSize;
+}
+
+quint64 Compressor::xzMemoryEstimate() const
+{
+    return XzStream::memoryEstimate(m_impl->xzOptions);
+}
+
+void Compressor::setMemoryBudget(quint64 bytes)
+{
+    m_impl->memoryBudget = bytes;
+}
+
+quint64 Compressor::memoryBudget() const
+{
+    return m_impl->memoryBudget;
+}
+
+quint64 Compressor::peakMemory() const
+{
+    // Streaming buffers only: one DeflateStream at a time
+    return DeflateStream::memoryEstimate();
+}
+
+void Compressor::cancel()
+{
+    m_impl->cancellation.cancel();
+}
+
+void Compressor::resetCancellation()
+{
+    m_impl->cancellation.reset();
+}
+
 CompressionResult Compressor::compressFile(const QString &inputPath, const QString &outputPath, const QString &compressionType)
 {
+    return compressSingleFile(inputPath, outputPath, compressionType);
+}
+
+CompressionResult Compressor::compressSingleFile(const QString &inputPath, const QString &outputPath, const QString &compressionType)
+{
+    if (m_impl->cancellation.isCancelled()) {
+        CompressionResult result;
+        result.success = false;
+        result.errorMessage = CancellationToken::CancelledMessage;
+        return result;
+    }
+
     try {
         QString extension = getFileExtension(inputPath).toLower();
 
@@ -74,7 +190,9 @@ QList<CompressionResult> Compressor::compressMultipleFiles(const QStringList &fi
         try {
             // Create output filename
             QFileInfo fileInfo(filePath);
-            QString baseName = fileInfo.baseName();
+            // Whole names, so a.txt and a.log (or x.tar.gz and x.txt) get distinct outputs
+            QString fileName = fileInfo.fileName();
+            QString baseName = fileInfo.completeBaseName();
             QString extension = fileInfo.suffix().toLower();
             QString outputPath;
 
@@ -85,14 +203,18 @@ QList<CompressionResult> Compressor::compressMultipleFiles(const QStringList &fi
                 outputPath = QString("%1/%2_compressed.%3").arg(outputDir, baseName, extension);
             } else {
                 if (compressionType == "zip") {
-                    outputPath = QString("%1/%2.zip").arg(outputDir, baseName);
+                    outputPath = QString("%1/%2.zip").arg(outputDir, fileName);
+                } else if (compressionType == "zstd") {
+                    outputPath = QString("%1/%2.zst").arg(outputDir, fileName);
+                } else if (compressionType == "xz") {
+                    outputPath = QString("%1/%2.xz").arg(outputDir, fileName);
                 } else {
-                    outputPath = QString("%1/%2.gz").arg(outputDir, baseName);
+                    outputPath = QString("%1/%2.gz").arg(outputDir, fileName);
                 }
             }
 
             // Compress file
-            CompressionResult result = compressFile(filePath, outputPath, compressionType);
+            CompressionResult result = compressSingleFile(filePath, outputPath, compressionType);
             result.filename = fileInfo.fileName();
             result.outputPath = outputPath;
             results.append(result);
@@ -173,6 +295,13 @@ CompressionResult Compressor::compressGeneralFile(const QString &inputPath, cons
 {
     if (compressionType == "zip") {
         return compressZip(inputPath, outputPath);
+    } else if (compressionType == "zstd") {
+        ZstdStream::Options options;
+        options.level = m_impl->zstdLevel;
+        options.longDistance = m_impl->longDistance;
+        return Impl::compressZstd(inputPath, outputPath, options, &m_impl->cancellation);
+    } else if (compressionType == "xz") {
+        return Impl::compressXz(inputPath, outputPath, m_impl->xzOptions, &m_impl->cancellation);
     } else {
         return compressGzip(inputPath, outputPath);
     }
@@ -180,83 +309,99 @@ CompressionResult Compressor::compressGeneralFile(const QString &inputPath, cons
 
 CompressionResult Compressor::compressZip(const QString &inputPath, const QString &outputPath)
 {
-    CompressionResult result;
-
-    try {
-        QFile inputFile(inputPath);
-        if (!inputFile.open(QIODevice::ReadOnly)) {
-            result.success = false;
-            result.errorMessage = "No se pudo abrir el archivo de entrada";
-            return result;
-        }
-
-        QFile outputFile(outputPath);
-        if (!outputFile.open(QIODevice::WriteOnly)) {
-            result.success = false;
-            result.errorMessage = "No se pudo crear el archivo de salida";
-            return result;
-        }
-
-        QByteArray inputData = inputFile.readAll();
-        QByteArray compressedData;
-
-        // Simple zlib compression
-        compressedData = qCompress(inputData, 9);
+    // qCompress layout (4-byte big-endian size, then zlib), streamed so the
+    // input never has to fit in a QByteArray
+    qint64 inputSize = QFileInfo(inputPath).size();
+    quint32 sizeHint = (inputSize >= 0 && inputSize <= 0x7fffffff) ? static_cast<quint32>(inputSize) : 0;
+    std::vector<unsigned char> header = {
+        static_cast<unsigned char>((sizeHint >> 24) & 0xff),
+        static_cast<unsigned char>((sizeHint >> 16) & 0xff),
+        static_cast<unsigned char>((sizeHint >> 8) & 0xff),
+        static_cast<unsigned char>(sizeHint & 0xff)
+    };
+
+    return Impl::compressStream(inputPath, outputPath, DeflateStream::Format::Zlib, header, &m_impl->cancellation);
+}
 
-        outputFile.write(compressedData);
+CompressionResult Compressor::compressGzip(const QString &inputPath, const QString &outputPath)
+{
+    return Impl::compressStream(inputPath, outputPath, DeflateStream::Format::Gzip, {}, &m_impl->cancellation);
+}
 
-        result.success = true;
-        result.originalSize = inputData.size();
-        result.compressedSize = compressedData.size();
-        result.compressionRatio = calculateCompressionRatio(result.originalSize, result.compressedSize);
-        result.outputPath = outputPath;
+CompressionResult Compressor::Impl::compressStream(const QString &inputPath, const QString &outputPath,
+                                                   DeflateStream::Format format, const std::vector<unsigned char> &header,
+                                                   const CancellationToken *cancel)
+{
+    CompressionResult result;
 
-    } catch (const std::exception &e) {
+    DeflateStream stream(format, Z_BEST_COMPRESSION);
+    stream.setCancellationToken(cancel);
+    if (!stream.compressFile(QFile::encodeName(inputPath).toStdString(),
+                             QFile::encodeName(outputPath).toStdString(), nullptr, header)) {
+        QFile::remove(outputPath);
         result.success = false;
-        result.errorMessage = QString("Error: %1").arg(e.what());
+        result.errorMessage = QString::fromStdString(stream.errorMessage());
+        return result;
     }
 
+    result.success = true;
+    result.originalSize = static_cast<qint64>(stream.totalIn());
+    result.compressedSize = static_cast<qint64>(stream.totalOut() + header.size());
+    result.compressionRatio = result.originalSize > 0
+        ? ((double)(result.originalSize - result.compressedSize) / result.originalSize) * 100.0
+        : 0.0;
+    result.outputPath = outputPath;
     return result;
 }
 
-CompressionResult Compressor::compressGzip(const QString &inputPath, const QString &outputPath)
+CompressionResult Compressor::Impl::compressZstd(const QString &inputPath, const QString &outputPath,
+                                                 const ZstdStream::Options &options, const CancellationToken *cancel)
 {
     CompressionResult result;
 
-    try {
-        QFile inputFile(inputPath);
-        if (!inputFile.open(QIODevice::ReadOnly)) {
-            result.success = false;
-            result.errorMessage = "No se pudo abrir el archivo de entrada";
-            return result;
-        }
-
-        QFile outputFile(outputPath);
-        if (!outputFile.open(QIODevice::WriteOnly)) {
-            result.success = false;
-            result.errorMessage = "No se pudo crear el archivo de salida";
-            return result;
-        }
-
-        QByteArray inputData = inputFile.readAll();
-        QByteArray compressedData;
-
-        // Simple zlib compression
-        compressedData = qCompress(inputData, 9);
+    ZstdStream stream(options);
+    stream.setCancellationToken(cancel);
+    if (!stream.compressFile(QFile::encodeName(inputPath).toStdString(),
+                             QFile::encodeName(outputPath).toStdString())) {
+        QFile::remove(outputPath);
+        result.success = false;
+        result.errorMessage = QString::fromStdString(stream.errorMessage());
+        return result;
+    }
 
-        outputFile.write(compressedData);
+    result.success = true;
+    result.originalSize = static_cast<qint64>(stream.totalIn());
+    result.compressedSize = static_cast<qint64>(stream.totalOut());
+    result.compressionRatio = result.originalSize > 0
+        ? ((double)(result.originalSize - result.compressedSize) / result.originalSize) * 100.0
+        : 0.0;
+    result.outputPath = outputPath;
+    return result;
+}
 
-        result.success = true;
-        result.originalSize = inputData.size();
-        result.compressedSize = compressedData.size();
-        result.compressionRatio = calculateCompressionRatio(result.originalSize, result.compressedSize);
-        result.outputPath = outputPath;
+CompressionResult Compressor::Impl::compressXz(const QString &inputPath, const QString &outputPath,
+                                               const XzStream::Options &options, const CancellationToken *cancel)
+{
+    CompressionResult result;
 
-    } catch (const std::exception &e) {
+    XzStream stream(options);
+    stream.setCancellationToken(cancel);
+    if (!stream.compressFile(QFile::encodeName(inputPath).toStdString(),
+                             QFile::encodeName(outputPath).toStdString())) {
+        QFile::remove(outputPath);
         result.success = false;
-        result.errorMessage = QString("Error: %1").arg(e.what());
+        result.errorMessage = QString::fromStdString(stream.errorMessage());
+        return result;
     }
 
+    result.success = true;
+    result.originalSize = static_cast<qint64>(stream.totalIn());
+    result.compressedSize = static_cast<qint64>(stream.totalOut());
+    result.compressionRatio = result.originalSize > 0
+        ? ((double)(result.originalSize - result.compressedSize) / result.originalSize) * 100.0
+        : 0.0;
+    result.outputPath = outputPath;
+    result.memoryUsage = stream.memoryUsage();
     return result;
 }
 
@@ -265,34 +410,20 @@ CompressionResult Compressor::compressPDF(const QString &inputPath, const QStrin
     // Basic PDF compression - just copy for now
     CompressionResult result;
 
-    try {
-        QFile inputFile(inputPath);
-        if (!inputFile.open(QIODevice::ReadOnly)) {
-            result.success = false;
-            result.errorMessage = "No se pudo abrir el archivo PDF";
-            return result;
-        }
-
-        QFile outputFile(outputPath);
-        if (!outputFile.open(QIODevice::WriteOnly)) {
-            result.success = false;
-            result.errorMessage = "No se pudo crear el archivo PDF de salida";
-            return result;
-        }
-
-        QByteArray pdfData = inputFile.readAll();
-        outputFile.write(pdfData);
-
-        result.success = true;
-        result.originalSize = pdfData.size();
-        result.compressedSize = pdfData.size();
-        result.compressionRatio = 0.0; // No compression for now
-        result.outputPath = outputPath;
-
-    } catch (const std::exception &e) {
+    FileCopy copier;
+    copier.setCancellationToken(&m_impl->cancellation);
+    if (!copier.copy(QFile::encodeName(inputPath).toStdString(), QFile::encodeName(outputPath).toStdString())) {
+        QFile::remove(outputPath);
         result.success = false;
-        result.errorMessage = QString("Error: %1").arg(e.what());
+        result.errorMessage = QString::fromStdString(copier.errorMessage());
+        return result;
     }
 
+    result.success = true;
+    result.originalSize = static_cast<qint64>(copier.bytesCopied());
+    result.compressedSize = result.originalSize;
+    result.compressionRatio = 0.0; // No compression for now
+    result.outputPath = outputPath;
+
     return result;
 }
@@ -0,0 +1,242 @@
+#include "cpu_count.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#ifdef HAVE_LIBNUMA
+#include <numa.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+// "max 100000" or "<quota> <period>"; returns 0 for no limit
+double readCpuMax(const std::string &path)
+{
+    std::ifstream file(path);
+    std::string quota;
+    double period = 0;
+    if (!(file >> quota >> period) || quota == "max" || period <= 0) {
+        return 0;
+    }
+    return std::strtod(quota.c_str(), nullptr) / period;
+}
+
+double readCfsQuota(const std::string &directory)
+{
+    std::ifstream quotaFile(directory + "/cpu.cfs_quota_us");
+    std::ifstream periodFile(directory + "/cpu.cfs_period_us");
+    double quota = 0;
+    double period = 0;
+    if (!(quotaFile >> quota) || !(periodFile >> period) || quota <= 0 || period <= 0) {
+        return 0;
+    }
+    return quota / period;
+}
+
+// Tightest limit between our cgroup and its ancestors
+double cgroupV2Quota()
+{
+    std::ifstream cgroupFile("/proc/self/cgroup");
+    std::string line;
+    std::string path;
+    while (std::getline(cgroupFile, line)) {
+        if (line.compare(0, 3, "0::") == 0) {
+            path = line.substr(3);
+            break;
+        }
+    }
+    if (path.empty()) {
+        return 0;
+    }
+
+    double limit = 0;
+    while (true) {
+        double quota = readCpuMax("/sys/fs/cgroup" + path + "/cpu.max");
+        if (quota > 0 && (limit == 0 || quota < limit)) {
+            limit = quota;
+        }
+        if (path.empty() || path == "/") {
+            break;
+        }
+        size_t slash = path.find_last_of('/');
+        path = slash == 0 || slash == std::string::npos ? "" : path.substr(0, slash);
+    }
+    return limit;
+}
+
+std::vector<unsigned> threadAffinity()
+{
+    std::vector<unsigned> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+bool setThreadAffinity(const std::vector<unsigned> &cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned cpu : cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    // pid 0 is the calling thread, not the whole process
+    return !cpus.empty() && sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+#endif
+
+} // namespace
+
+unsigned CpuCount::available()
+{
+    unsigned count = std::max(1u, std::thread::hardware_concurrency());
+
+    unsigned allowed = affinity();
+    if (allowed > 0) {
+        count = std::min(count, allowed);
+    }
+
+    // A quota of 2.5 CPUs still keeps 3 workers busy part of the time
+    double quota = cgroupQuota();
+    if (quota > 0) {
+        count = std::min(count, std::max(1u, static_cast<unsigned>(std::ceil(quota))));
+    }
+
+    return count;
+}
+
+unsigned CpuCount::affinity()
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        return static_cast<unsigned>(CPU_COUNT(&set));
+    }
+#endif
+    return 0;
+}
+
+double CpuCount::cgroupQuota()
+{
+#ifdef __linux__
+    double quota = cgroupV2Quota();
+    if (quota > 0) {
+        return quota;
+    }
+
+    // cgroup v1 mounts the controller under one of these names
+    for (const char *directory : {"/sys/fs/cgroup/cpu,cpuacct", "/sys/fs/cgroup/cpu"}) {
+        quota = readCfsQuota(directory);
+        if (quota > 0) {
+            return quota;
+        }
+    }
+#endif
+    return 0;
+}
+
+std::vector<unsigned> CpuCount::allowedCpus()
+{
+    std::vector<unsigned> cpus;
+#ifdef __linux__
+    cpus = threadAffinity();
+#endif
+    if (cpus.empty()) {
+        for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+
+#ifdef HAVE_LIBNUMA
+    if (numa_available() >= 0) {
+        std::stable_sort(cpus.begin(), cpus.end(), [](unsigned a, unsigned b) {
+            return numa_node_of_cpu(static_cast<int>(a)) < numa_node_of_cpu(static_cast<int>(b));
+        });
+    }
+#endif
+    return cpus;
+}
+
+unsigned CpuCount::numaNodes()
+{
+#ifdef HAVE_LIBNUMA
+    if (numa_available() >= 0) {
+        std::set<int> nodes;
+        for (unsigned cpu : allowedCpus()) {
+            nodes.insert(numa_node_of_cpu(static_cast<int>(cpu)));
+        }
+        return std::max<unsigned>(1, static_cast<unsigned>(nodes.size()));
+    }
+#endif
+    return 1;
+}
+
+std::string CpuCount::summary()
+{
+    std::ostringstream text;
+    text << available() << " de " << std::max(1u, std::thread::hardware_concurrency()) << " CPUs";
+
+    std::vector<std::string> limits;
+    if (unsigned allowed = affinity()) {
+        limits.push_back("afinidad " + std::to_string(allowed));
+    }
+    if (double quota = cgroupQuota()) {
+        std::ostringstream value;
+        value.setf(std::ios::fixed);
+        value.precision(1);
+        value << quota;
+        limits.push_back("cuota cgroup " + value.str());
+    }
+    unsigned nodes = numaNodes();
+    if (nodes > 1) {
+        limits.push_back(std::to_string(nodes) + " nodos NUMA");
+    }
+
+    for (size_t i = 0; i < limits.size(); ++i) {
+        text << (i == 0 ? " (" : ", ") << limits[i];
+    }
+    if (!limits.empty()) {
+        text << ")";
+    }
+    return text.str();
+}
+
+CpuCount::ThreadPin::ThreadPin(unsigned worker)
+    : m_pinned(false)
+{
+#ifdef __linux__
+    std::vector<unsigned> cpus = allowedCpus();
+    m_previous = threadAffinity();
+    m_pinned = !m_previous.empty() && setThreadAffinity({cpus[worker % cpus.size()]});
+#else
+    (void)worker;
+#endif
+}
+
+CpuCount::ThreadPin::~ThreadPin()
+{
+#ifdef __linux__
+    if (m_pinned) {
+        setThreadAffinity(m_previous);
+    }
+#endif
+}
@@ -0,0 +1,321 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include "deflate_stream.h"
+#include "input_source.h"
+#include "lz4_stream.h"
+#include "parallel_deflate.h"
+#include "xz_stream.h"
+#include "zstd_stream.h"
+
+// Compares single-threaded deflate against the block-parallel engine on the
+// same input, reporting output size, ratio loss and throughput per block size.
+// Builds with zstd add Zstandard rows at several levels, multithreaded and
+// with long-distance matching, builds with lz4 add LZ4 and LZ4-HC rows and
+// builds with liblzma add xz rows; a negative loss means smaller than deflate. "Total" adds the time to send
+// the output over a link of the given speed (MB/s, 1 Gbit/s by default), which
+// is where a fast codec with a worse ratio can still beat deflate.
+
+struct BenchmarkResult
+{
+    bool success = false;
+    uint64_t inputSize = 0;
+    uint64_t outputSize = 0;
+    double seconds = 0.0;
+    std::string errorMessage;
+};
+
+static BenchmarkResult runSingleThread(const std::string &inputPath, int level)
+{
+    BenchmarkResult result;
+    InputSource input;
+    if (!input.open(inputPath)) {
+        result.errorMessage = input.errorMessage();
+        return result;
+    }
+
+    DeflateStream deflater(DeflateStream::Format::Raw, level);
+    DeflateStream::Sink sink = [](const unsigned char *, size_t) { return true; };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<unsigned char> buffer(InputSource::ReadBlockSize);
+    bool ok = true;
+    while (ok) {
+        long long got = input.read(buffer.data(), buffer.size());
+        if (got <= 0) {
+            ok = got == 0;
+            break;
+        }
+        ok = deflater.write(buffer.data(), static_cast<size_t>(got), sink);
+    }
+    ok = ok && deflater.finish(sink);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!ok) {
+        result.errorMessage = !deflater.errorMessage().empty() ? deflater.errorMessage() : input.errorMessage();
+        return result;
+    }
+
+    result.success = true;
+    result.inputSize = deflater.totalIn();
+    result.outputSize = deflater.totalOut();
+    return result;
+}
+
+static BenchmarkResult runParallel(const std::string &inputPath, int level, size_t blockSize, unsigned threads)
+{
+    BenchmarkResult result;
+    InputSource input;
+    if (!input.open(inputPath)) {
+        result.errorMessage = input.errorMessage();
+        return result;
+    }
+
+    ParallelDeflate::Options options;
+    options.level = level;
+    options.blockSize = blockSize;
+    options.threads = threads;
+    options.format = DeflateStream::Format::Raw;
+
+    ParallelDeflate deflater(options);
+    DeflateStream::Sink sink = [](const unsigned char *, size_t) { return true; };
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = deflater.compress(input, sink);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!ok) {
+        result.errorMessage = deflater.errorMessage();
+        return result;
+    }
+
+    result.success = true;
+    result.inputSize = deflater.totalIn();
+    result.outputSize = deflater.totalOut();
+    return result;
+}
+
+template <typename Stream>
+static void setExpectedSize(Stream &compressor, uint64_t size)
+{
+    compressor.setExpectedSize(size);
+}
+
+// .xz headers carry no size
+static void setExpectedSize(XzStream &, uint64_t)
+{
+}
+
+// Any stream with write(), finish() and the totals
+template <typename Stream>
+static BenchmarkResult runStream(const std::string &inputPath, Stream &compressor)
+{
+    BenchmarkResult result;
+    InputSource input;
+    if (!input.open(inputPath)) {
+        result.errorMessage = input.errorMessage();
+        return result;
+    }
+
+    setExpectedSize(compressor, input.knownSize());
+    DeflateStream::Sink sink = [](const unsigned char *, size_t) { return true; };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<unsigned char> buffer(InputSource::ReadBlockSize);
+    bool ok = true;
+    while (ok) {
+        long long got = input.read(buffer.data(), buffer.size());
+        if (got <= 0) {
+            ok = got == 0;
+            break;
+        }
+        ok = compressor.write(buffer.data(), static_cast<size_t>(got), sink);
+    }
+    ok = ok && compressor.finish(sink);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!ok) {
+        result.errorMessage = !compressor.errorMessage().empty() ? compressor.errorMessage() : input.errorMessage();
+        return result;
+    }
+
+    result.success = true;
+    result.inputSize = compressor.totalIn();
+    result.outputSize = compressor.totalOut();
+    return result;
+}
+
+static BenchmarkResult runZstd(const std::string &inputPath, const ZstdStream::Options &options)
+{
+    ZstdStream compressor(options);
+    return runStream(inputPath, compressor);
+}
+
+static BenchmarkResult runLz4(const std::string &inputPath, const Lz4Stream::Options &options)
+{
+    Lz4Stream compressor(options);
+    return runStream(inputPath, compressor);
+}
+
+static BenchmarkResult runXz(const std::string &inputPath, const XzStream::Options &options)
+{
+    XzStream compressor(options);
+    return runStream(inputPath, compressor);
+}
+
+static void printRow(const std::string &label, const BenchmarkResult &result, uint64_t baselineSize,
+                     double linkSpeed)
+{
+    double throughput = result.seconds > 0.0 ? result.inputSize / result.seconds / (1024.0 * 1024.0) : 0.0;
+    double ratioLoss = baselineSize > 0
+        ? (static_cast<double>(result.outputSize) - static_cast<double>(baselineSize)) * 100.0 / baselineSize
+        : 0.0;
+    double total = result.seconds + result.outputSize / (linkSpeed * 1024.0 * 1024.0);
+
+    std::cout << std::left << std::setw(14) << label << std::right
+              << std::setw(14) << result.outputSize
+              << std::setw(11) << std::fixed << std::setprecision(3) << ratioLoss << "%"
+              << std::setw(10) << std::setprecision(2) << result.seconds << "s"
+              << std::setw(10) << std::setprecision(1) << throughput << " MB/s"
+              << std::setw(10) << std::setprecision(2) << total << "s" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        std::cout << "Uso: " << argv[0] << " <archivo> [nivel] [hilos] [MB/s del enlace]" << std::endl;
+        std::cout << "Compara deflate de un hilo con deflate por bloques (128K, 256K, 512K, 1M), zstd, lz4 y xz" << std::endl;
+        return 1;
+    }
+
+    std::string inputPath = argv[1];
+    int level = argc > 2 ? std::atoi(argv[2]) : Z_BEST_COMPRESSION;
+    unsigned threads = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 0;
+    double linkSpeed = argc > 4 ? std::atof(argv[4]) : 0.0;
+    if (linkSpeed <= 0.0) {
+        linkSpeed = 125.0;
+    }
+
+    BenchmarkResult baseline = runSingleThread(inputPath, level);
+    if (!baseline.success) {
+        std::cerr << "❌ " << baseline.errorMessage << std::endl;
+        return 1;
+    }
+
+    ParallelDeflate::Options options;
+    options.threads = threads;
+    std::cout << "📄 " << inputPath << " (" << baseline.inputSize << " bytes, nivel " << level
+              << ", " << ParallelDeflate(options).threadCount() << " hilos, enlace de "
+              << std::setprecision(0) << std::fixed << linkSpeed << " MB/s)" << std::endl;
+    std::cout << std::left << std::setw(14) << "Modo" << std::right
+              << std::setw(14) << "Tamaño" << std::setw(12) << "Pérdida"
+              << std::setw(11) << "Tiempo" << std::setw(15) << "Velocidad" << std::setw(11) << "Total" << std::endl;
+
+    printRow("1 hilo", baseline, baseline.outputSize, linkSpeed);
+
+    const size_t blockSizes[] = { 128 * 1024, 256 * 1024, 512 * 1024, 1024 * 1024 };
+    for (size_t blockSize : blockSizes) {
+        BenchmarkResult result = runParallel(inputPath, level, blockSize, threads);
+        if (!result.success) {
+            std::cerr << "❌ " << result.errorMessage << std::endl;
+            return 1;
+        }
+        printRow("bloques " + std::to_string(blockSize / 1024) + "K", result, baseline.outputSize, linkSpeed);
+    }
+
+    if (Lz4Stream::available()) {
+        struct Lz4Case
+        {
+            std::string label;
+            int level;
+        };
+        const Lz4Case lz4Cases[] = {
+            { "lz4 acel 8", -8 },
+            { "lz4", Lz4Stream::FastLevel },
+            { "lz4-hc 3", Lz4Stream::HcMinLevel },
+            { "lz4-hc 9", Lz4Stream::HcDefaultLevel },
+            { "lz4-hc 12", Lz4Stream::MaxLevel },
+        };
+        for (const Lz4Case &lz4Case : lz4Cases) {
+            Lz4Stream::Options lz4Options;
+            lz4Options.level = lz4Case.level;
+            BenchmarkResult result = runLz4(inputPath, lz4Options);
+            if (!result.success) {
+                std::cerr << "❌ " << result.errorMessage << std::endl;
+                return 1;
+            }
+            printRow(lz4Case.label, result, baseline.outputSize, linkSpeed);
+        }
+    }
+
+    if (XzStream::available()) {
+        unsigned xzThreads = ParallelDeflate(options).threadCount();
+        struct XzCase
+        {
+            std::string label;
+            int level;
+            unsigned threads;
+        };
+        const XzCase xzCases[] = {
+            { "xz 6", 6, 0 },
+            { "xz 9", 9, 0 },
+            { "xz 9 " + std::to_string(xzThreads) + "h", 9, xzThreads },
+        };
+        for (const XzCase &xzCase : xzCases) {
+            if (xzCase.threads == 1) {
+                continue;       // same as the single-threaded row
+            }
+            XzStream::Options xzOptions;
+            xzOptions.level = xzCase.level;
+            xzOptions.threads = xzCase.threads;
+            BenchmarkResult result = runXz(inputPath, xzOptions);
+            if (!result.success) {
+                std::cerr << "❌ " << result.errorMessage << std::endl;
+                return 1;
+            }
+            printRow(xzCase.label, result, baseline.outputSize, linkSpeed);
+        }
+    }
+
+    if (!ZstdStream::available()) {
+        return 0;
+    }
+
+    unsigned zstdWorkers = ParallelDeflate(options).threadCount();
+    struct ZstdCase
+    {
+        std::string label;
+        int level;
+        unsigned workers;
+        bool longDistance;
+    };
+    const ZstdCase zstdCases[] = {
+        { "zstd 1", 1, 0, false },
+        { "zstd 3", 3, 0, false },
+        { "zstd 9", 9, 0, false },
+        { "zstd 19", 19, 0, false },
+        { "zstd 19 larga", 19, 0, true },
+        { "zstd 19 " + std::to_string(zstdWorkers) + "h", 19, zstdWorkers, false },
+    };
+    for (const ZstdCase &zstdCase : zstdCases) {
+        if (zstdCase.workers == 1) {
+            continue;       // same as the single-threaded row
+        }
+        ZstdStream::Options zstdOptions;
+        zstdOptions.level = zstdCase.level;
+        zstdOptions.workers = zstdCase.workers;
+        zstdOptions.longDistance = zstdCase.longDistance;
+        BenchmarkResult result = runZstd(inputPath, zstdOptions);
+        if (!result.success) {
+            std::cerr << "❌ " << result.errorMessage << std::endl;
+            return 1;
+        }
+        printRow(zstdCase.label, result, baseline.outputSize, linkSpeed);
+    }
+
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include "deflate_stream.h"
+#include "cancellation_token.h"
+#include "input_source.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+int windowBitsFor(DeflateStream::Format format)
+{
+    switch (format) {
+        case DeflateStream::Format::Gzip:
+            return 15 + 16;
+        case DeflateStream::Format::Raw:
+            return -15;
+        case DeflateStream::Format::Zlib:
+        default:
+            return 15;
+    }
+}
+
+} // namespace
+
+DeflateStream::DeflateStream(Format format, int level, size_t bufferSize)
+    : m_initialized(false)
+    , m_finished(false)
+    , m_bufferSize(std::max<size_t>(bufferSize, 4096))
+    , m_totalIn(0)
+    , m_totalOut(0)
+    , m_crc(crc32(0L, Z_NULL, 0))
+    , m_cancel(nullptr)
+{
+    std::memset(&m_stream, 0, sizeof(m_stream));
+    m_outBuffer.resize(m_bufferSize);
+
+    if (deflateInit2(&m_stream, level, Z_DEFLATED, windowBitsFor(format), 8, Z_DEFAULT_STRATEGY) == Z_OK) {
+        m_initialized = true;
+    } else {
+        m_errorMessage = "No se pudo inicializar zlib";
+    }
+}
+
+DeflateStream::~DeflateStream()
+{
+    if (m_initialized) {
+        deflateEnd(&m_stream);
+    }
+}
+
+bool DeflateStream::write(const unsigned char *data, size_t size, const Sink &sink)
+{
+    if (!m_initialized || m_finished) {
+        if (m_errorMessage.empty()) {
+            m_errorMessage = "El flujo de compresión ya fue cerrado";
+        }
+        return false;
+    }
+
+    // avail_in is a uInt, so very large buffers are fed in slices
+    while (size > 0) {
+        if (CancellationToken::cancelled(m_cancel)) {
+            m_errorMessage = CancellationToken::CancelledMessage;
+            return false;
+        }
+        size_t slice = std::min<size_t>(size, m_bufferSize);
+        m_crc = crc32(m_crc, data, static_cast<uInt>(slice));
+        if (!deflateBuffer(data, slice, Z_NO_FLUSH, sink)) {
+            return false;
+        }
+        data += slice;
+        size -= slice;
+    }
+    return true;
+}
+
+bool DeflateStream::finish(const Sink &sink)
+{
+    if (!m_initialized || m_finished) {
+        if (m_errorMessage.empty()) {
+            m_errorMessage = "El flujo de compresión ya fue cerrado";
+        }
+        return false;
+    }
+
+    bool ok = deflateBuffer(nullptr, 0, Z_FINISH, sink);
+    m_finished = true;
+    return ok;
+}
+
+bool DeflateStream::flush(const Sink &sink)
+{
+    if (!m_initialized || m_finished) {
+        if (m_errorMessage.empty()) {
+            m_errorMessage = "El flujo de compresión ya fue cerrado";
+        }
+        return false;
+    }
+
+    return deflateBuffer(nullptr, 0, Z_SYNC_FLUSH, sink);
+}
+
+bool DeflateStream::setDictionary(const unsigned char *data, size_t size)
+{
+    if (!m_initialized || size == 0) {
+        return m_initialized;
+    }
+
+    if (deflateSetDictionary(&m_stream, data, static_cast<uInt>(size)) != Z_OK) {
+        m_errorMessage = "No se pudo establecer el diccionario zlib";
+        return false;
+    }
+    return true;
+}
+
+bool DeflateStream::deflateBuffer(const unsigned char *data, size_t size, int flush, const Sink &sink)
+{
+    m_stream.next_in = const_cast<Bytef *>(data);
+    m_stream.avail_in = static_cast<uInt>(size);
+
+    // total_in/total_out are uLong (32-bit on some platforms), so only the
+    // per-call deltas are accumulated into the 64-bit counters
+    uLong inBefore = m_stream.total_in;
+
+    int ret = Z_OK;
+    do {
+        m_stream.next_out = m_outBuffer.data();
+        m_stream.avail_out = static_cast<uInt>(m_outBuffer.size());
+
+        ret = deflate(&m_stream, flush);
+        if (ret == Z_STREAM_ERROR) {
+            m_errorMessage = "Error en la compresión zlib";
+            return false;
+        }
+
+        size_t produced = m_outBuffer.size() - m_stream.avail_out;
+        if (produced > 0) {
+            if (!sink(m_outBuffer.data(), produced)) {
+                if (m_errorMessage.empty()) {
+                    m_errorMessage = "Error al escribir los datos comprimidos";
+                }
+                return false;
+            }
+            m_totalOut += produced;
+        }
+    } while (m_stream.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+
+    m_totalIn += static_cast<uLong>(m_stream.total_in - inBefore);
+    return true;
+}
+
+bool DeflateStream::compressFile(const std::string &inputPath, const std::string &outputPath,
+                                 const ProgressCallback &progress,
+                                 const std::vector<unsigned char> &header)
+{
+    InputSource inputFile;
+    if (!inputFile.open(inputPath)) {
+        m_errorMessage = inputFile.errorMessage();
+        return false;
+    }
+    uint64_t totalBytes = inputFile.knownSize();
+
+    std::ofstream outputFile(outputPath, std::ios::binary | std::ios::trunc);
+    if (!outputFile.is_open()) {
+        m_errorMessage = "No se pudo crear el archivo de salida";
+        return false;
+    }
+
+    Sink sink = [&outputFile](const unsigned char *data, size_t size) {
+        outputFile.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(outputFile);
+    };
+
+    // A failed or cancelled run leaves no partial output behind
+    auto abandon = [&](const std::string &message) {
+        if (!message.empty()) {
+            m_errorMessage = message;
+        }
+        outputFile.close();
+        std::remove(outputPath.c_str());
+        return false;
+    };
+
+    if (!header.empty() && !sink(header.data(), header.size())) {
+        return abandon("Error al escribir los datos comprimidos");
+    }
+
+    std::vector<unsigned char> inBuffer(m_bufferSize);
+    while (true) {
+        long long got = inputFile.read(inBuffer.data(), inBuffer.size());
+        if (got < 0) {
+            return abandon(inputFile.errorMessage());
+        }
+        if (got == 0) {
+            break;
+        }
+        if (!write(inBuffer.data(), static_cast<size_t>(got), sink)) {
+            return abandon(std::string());
+        }
+        if (progress) {
+            progress(m_totalIn, totalBytes);
+        }
+    }
+
+    if (!finish(sink)) {
+        return abandon(std::string());
+    }
+
+    outputFile.close();
+    if (!outputFile) {
+        return abandon("Error al escribir los datos comprimidos");
+    }
+
+    return true;
+}
@@ -0,0 +1,226 @@
+#include "file_copy.h"
+#include "cancellation_token.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#endif
+
+namespace {
+
+// Errors meaning "this kernel or filesystem pair cannot do it", not a real I/O failure
+bool unsupported(int error)
+{
+    return error == ENOSYS || error == EXDEV || error == EINVAL || error == EOPNOTSUPP
+        || error == ENOTSUP || error == EBADF || error == ETXTBSY;
+}
+
+} // namespace
+
+FileCopy::FileCopy()
+    : m_bytesCopied(0)
+    , m_method(Method::None)
+    , m_cancel(nullptr)
+{
+}
+
+const char *FileCopy::methodName(Method method)
+{
+    switch (method) {
+        case Method::Reflink:
+            return "reflink";
+        case Method::CopyFileRange:
+            return "copy_file_range";
+        case Method::Sendfile:
+            return "sendfile";
+        case Method::ReadWrite:
+            return "read/write";
+        case Method::None:
+        default:
+            return "ninguno";
+    }
+}
+
+bool FileCopy::copy(const std::string &inputPath, const std::string &outputPath, const ProgressCallback &progress)
+{
+    m_bytesCopied = 0;
+    m_method = Method::None;
+
+    int inputFd = ::open(inputPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (inputFd < 0) {
+        m_errorMessage = "No se pudo abrir el archivo de entrada";
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(inputFd, &info) != 0) {
+        m_errorMessage = "No se pudo leer la información del archivo";
+        ::close(inputFd);
+        return false;
+    }
+
+    int outputFd = ::open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (outputFd < 0) {
+        m_errorMessage = "No se pudo crear el archivo de salida";
+        ::close(inputFd);
+        return false;
+    }
+
+    // Empty regular files may still have content (procfs, sysfs), so only
+    // files with a known size take the in-kernel paths
+    bool ok;
+    if (S_ISREG(info.st_mode) && info.st_size > 0) {
+        ok = copyRanges(inputFd, outputFd, static_cast<uint64_t>(info.st_size), progress);
+    } else {
+        ok = copyReadWrite(inputFd, outputFd, 0, progress);
+    }
+
+    ::close(inputFd);
+    if (::close(outputFd) != 0 && ok) {
+        m_errorMessage = "Error al escribir el archivo de salida";
+        ok = false;
+    }
+    if (!ok) {
+        ::unlink(outputPath.c_str());
+    }
+    return ok;
+}
+
+bool FileCopy::cancelled()
+{
+    if (!CancellationToken::cancelled(m_cancel)) {
+        return false;
+    }
+    m_errorMessage = CancellationToken::CancelledMessage;
+    return true;
+}
+
+bool FileCopy::copyRanges(int inputFd, int outputFd, uint64_t totalBytes, const ProgressCallback &progress)
+{
+#ifdef __linux__
+    // Shares the extents on btrfs/XFS/bcachefs: no data is read or written
+    if (ioctl(outputFd, FICLONE, inputFd) == 0) {
+        m_method = Method::Reflink;
+        m_bytesCopied = totalBytes;
+        if (progress) {
+            progress(m_bytesCopied, totalBytes);
+        }
+        return true;
+    }
+
+    // In-kernel copy; may still become a server-side copy or reflink underneath
+    m_method = Method::CopyFileRange;
+    while (m_bytesCopied < totalBytes) {
+        if (cancelled()) {
+            return false;
+        }
+        ssize_t copied = copy_file_range(inputFd, nullptr, outputFd, nullptr, ChunkSize, 0);
+        if (copied < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (m_bytesCopied == 0 && unsupported(errno)) {
+                break;
+            }
+            m_errorMessage = "Error al copiar el archivo";
+            return false;
+        }
+        if (copied == 0) {
+            // procfs, sysfs and some FUSE/network filesystems report a size
+            // but copy nothing; past the first chunk the file shrank
+            if (m_bytesCopied == 0) {
+                break;
+            }
+            return true;
+        }
+        m_bytesCopied += static_cast<uint64_t>(copied);
+        if (progress) {
+            progress(m_bytesCopied, totalBytes);
+        }
+    }
+    if (m_bytesCopied > 0) {
+        return true;
+    }
+
+    m_method = Method::Sendfile;
+    while (m_bytesCopied < totalBytes) {
+        if (cancelled()) {
+            return false;
+        }
+        ssize_t copied = sendfile(outputFd, inputFd, nullptr, ChunkSize);
+        if (copied < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (m_bytesCopied == 0 && unsupported(errno)) {
+                break;
+            }
+            m_errorMessage = "Error al copiar el archivo";
+            return false;
+        }
+        if (copied == 0) {
+            if (m_bytesCopied == 0) {
+                break;
+            }
+            return true;
+        }
+        m_bytesCopied += static_cast<uint64_t>(copied);
+        if (progress) {
+            progress(m_bytesCopied, totalBytes);
+        }
+    }
+    if (m_bytesCopied > 0) {
+        return true;
+    }
+#endif
+
+    return copyReadWrite(inputFd, outputFd, totalBytes, progress);
+}
+
+bool FileCopy::copyReadWrite(int inputFd, int outputFd, uint64_t totalBytes, const ProgressCallback &progress)
+{
+    m_method = Method::ReadWrite;
+    std::vector<char> buffer(1024 * 1024);
+
+    while (true) {
+        if (cancelled()) {
+            return false;
+        }
+        ssize_t got = ::read(inputFd, buffer.data(), buffer.size());
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            m_errorMessage = "Error al leer el archivo de entrada";
+            return false;
+        }
+        if (got == 0) {
+            break;
+        }
+
+        ssize_t written = 0;
+        while (written < got) {
+            ssize_t count = ::write(outputFd, buffer.data() + written, static_cast<size_t>(got - written));
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                m_errorMessage = "Error al escribir el archivo de salida";
+                return false;
+            }
+            written += count;
+        }
+
+        m_bytesCopied += static_cast<uint64_t>(got);
+        if (progress) {
+            progress(m_bytesCopied, totalBytes);
+        }
+    }
+    return true;
+}
@@ -1,4 +1,12 @@
 #include "gui_compressor.h"
+#include "cancellation_token.h"
+#include "input_source.h"
+#include "zip_stream_source.h"
+#include "zip_writer.h"
+#include "deflate_stream.h"
+#include "parallel_bzip2.h"
+#include "parallel_deflate.h"
+#include "zip_archive_builder.h"
 #include <QFileInfo>
 #include <QDir>
 #include <QDebug>
@@ -12,13 +20,20 @@
 #include <algorithm>
 #include <zip.h>
 #include <cstring>
+#include <sys/stat.h>
 
 namespace fs = std::filesystem;
 
-CompressionResult PureCppCompressor::compressFile(const std::string &inputPath, const std::string &outputPath)
+CompressionResult PureCppCompressor::compressFile(const std::string &inputPath, const std::string &outputPath,
+                                                  const CancellationToken *cancel)
 {
     CompressionResult result;
 
+    if (CancellationToken::cancelled(cancel)) {
+        result.errorMessage = CancellationToken::CancelledMessage;
+        return result;
+    }
+
     try {
         fs::path inputFile(inputPath);
         std::string extension = inputFile.extension().string();
@@ -27,17 +42,17 @@ CompressionResult PureCppCompressor::compressFile(const std::string &inputPath,
         std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
 
         if (extension == ".pdf") {
-            return compressPDF(inputPath, outputPath);
+            return compressPDF(inputPath, outputPath, cancel);
         } else if (extension == ".jpg" || extension == ".jpeg" || extension == ".png" ||
                    extension == ".gif" || extension == ".bmp" || extension == ".tiff") {
-            return compressImage(inputPath, outputPath);
+            return compressImage(inputPath, outputPath, cancel);
         } else if (extension == ".txt" || extension == ".log" || extension == ".csv" ||
                    extension == ".json" || extension == ".xml" || extension == ".html" ||
                    extension == ".css" || extension == ".js" || extension == ".cpp" ||
                    extension == ".h" || extension == ".py" || extension == ".java") {
-            return compressTextFile(inputPath, outputPath);
+            return compressTextFile(inputPath, outputPath, cancel);
         } else {
-            return compressToZip(inputPath, outputPath);
+            return compressToZip(inputPath, outputPath, cancel);
         }
     } catch (const std::exception &e) {
         result.success = false;
@@ -46,7 +61,8 @@ CompressionResult PureCppCompressor::compressFile(const std::string &inputPath,
     }
 }
 
-CompressionResult PureCppCompressor::compressTextFile(const std::string &inputPath, const std::string &outputPath)
+CompressionResult PureCppCompressor::compressTextFile(const std::string &inputPath, const std::string &outputPath,
+                                                      const CancellationToken *cancel)
 {
     CompressionResult result;
 
@@ -65,36 +81,39 @@ CompressionResult PureCppCompressor::compressTextFile(const std::string &inputPa
             return result;
         }
 
-        // Read file content
-        std::ifstream inputFile(inputPath, std::ios::binary);
-        if (!inputFile.is_open()) {
-            zip_close(zip);
+        // Stream the file into the archive while libzip compresses it
+        uint64_t bytesRead = 0;
+        zip_source_t *source = ZipStreamSource::create(zip, inputPath, &bytesRead, cancel);
+        if (!source) {
+            zip_discard(zip);
             result.success = false;
             result.errorMessage = "No se pudo abrir el archivo de entrada";
             return result;
         }
 
-        std::vector<unsigned char> content((std::istreambuf_iterator<char>(inputFile)),
-                                          std::istreambuf_iterator<char>());
-        inputFile.close();
-
         // Add file directly to ZIP (ZIP will handle compression)
         fs::path inputFileName = fs::path(inputPath).filename();
-        zip_source_t *source = zip_source_buffer(zip, content.data(), content.size(), 0);
         if (zip_file_add(zip, inputFileName.string().c_str(), source, ZIP_FL_OVERWRITE) < 0) {
             zip_source_free(source);
-            zip_close(zip);
+            zip_discard(zip);
             result.success = false;
             result.errorMessage = "Error al agregar archivo al ZIP";
             return result;
         }
 
-        zip_close(zip);
+        // The input is read and compressed here
+        if (zip_close(zip) < 0) {
+            zip_discard(zip);
+            result.success = false;
+            result.errorMessage = CancellationToken::cancelled(cancel) ? CancellationToken::CancelledMessage
+                                                                       : "Error al escribir el archivo ZIP";
+            return result;
+        }
 
         result.success = true;
-        result.originalSize = content.size();
+        result.originalSize = bytesRead;
         result.compressedSize = fs::file_size(zipPath);
-        result.compressionRatio = ((double)(result.originalSize - result.compressedSize) / result.originalSize) * 100.0;
+        result.compressionRatio = compressionRatio(result.originalSize, result.compressedSize);
         result.outputPath = zipPath;
 
     } catch (const std::exception &e) {
@@ -105,12 +124,14 @@ CompressionResult PureCppCompressor::compressTextFile(const std::string &inputPa
     return result;
 }
 
-CompressionResult PureCppCompressor::compressBinaryFile(const std::string &inputPath, const std::string &outputPath)
+CompressionResult PureCppCompressor::compressBinaryFile(const std::string &inputPath, const std::string &outputPath,
+                                                        const CancellationToken *cancel)
 {
-    return compressToZip(inputPath, outputPath);
+    return compressToZip(inputPath, outputPath, cancel);
 }
 
-CompressionResult PureCppCompressor::compressPDF(const std::string &inputPath, const std::string &outputPath)
+CompressionResult PureCppCompressor::compressPDF(const std::string &inputPath, const std::string &outputPath,
+                                                 const CancellationToken *cancel)
 {
     CompressionResult result;
 
@@ -129,36 +150,39 @@ CompressionResult PureCppCompressor::compressPDF(const std::string &inputPath, c
             return result;
         }
 
-        // Read PDF file
-        std::ifstream pdfFile(inputPath, std::ios::binary);
-        if (!pdfFile.is_open()) {
-            zip_close(zip);
+        // Stream the PDF into the archive while libzip compresses it
+        uint64_t bytesRead = 0;
+        zip_source_t *source = ZipStreamSource::create(zip, inputPath, &bytesRead, cancel);
+        if (!source) {
+            zip_discard(zip);
             result.success = false;
             result.errorMessage = "No se pudo abrir el archivo PDF";
             return result;
         }
 
-        std::vector<unsigned char> pdfContent((std::istreambuf_iterator<char>(pdfFile)),
-                                             std::istreambuf_iterator<char>());
-        pdfFile.close();
-
         // Add PDF directly to ZIP (ZIP will handle compression)
         fs::path inputFileName = fs::path(inputPath).filename();
-        zip_source_t *source = zip_source_buffer(zip, pdfContent.data(), pdfContent.size(), 0);
         if (zip_file_add(zip, inputFileName.string().c_str(), source, ZIP_FL_OVERWRITE) < 0) {
             zip_source_free(source);
-            zip_close(zip);
+            zip_discard(zip);
             result.success = false;
             result.errorMessage = "Error al agregar PDF al ZIP";
             return result;
         }
 
-        zip_close(zip);
+        // The input is read and compressed here
+        if (zip_close(zip) < 0) {
+            zip_discard(zip);
+            result.success = false;
+            result.errorMessage = CancellationToken::cancelled(cancel) ? CancellationToken::CancelledMessage
+                                                                       : "Error al escribir el archivo ZIP";
+            return result;
+        }
 
         result.success = true;
-        result.originalSize = pdfContent.size();
+        result.originalSize = bytesRead;
         result.compressedSize = fs::file_size(zipPath);
-        result.compressionRatio = ((double)(result.originalSize - result.compressedSize) / result.originalSize) * 100.0;
+        result.compressionRatio = compressionRatio(result.originalSize, result.compressedSize);
         result.outputPath = zipPath;
 
     } catch (const std::exception &e) {
@@ -169,7 +193,8 @@ CompressionResult PureCppCompressor::compressPDF(const std::string &inputPath, c
     return result;
 }
 
-CompressionResult PureCppCompressor::compressToZip(const std::string &inputPath, const std::string &outputPath)
+CompressionResult PureCppCompressor::compressToZip(const std::string &inputPath, const std::string &outputPath,
+                                                   const CancellationToken *cancel)
 {
     CompressionResult result;
 
@@ -179,57 +204,57 @@ CompressionResult PureCppCompressor::compressToZip(const std::string &inputPath,
             zipPath = zipPath.substr(0, zipPath.find_last_of('.')) + ".zip";
         }
 
-        int err = 0;
-        zip_t *zip = zip_open(zipPath.c_str(), ZIP_CREATE | ZIP_TRUNCATE, &err);
-        if (!zip) {
+        ZipWriter zip;
+        if (!zip.open(zipPath)) {
             result.success = false;
             result.errorMessage = "No se pudo crear el archivo ZIP";
             return result;
         }
 
-        // Read file content
-        std::ifstream inputFile(inputPath, std::ios::binary);
-        if (!inputFile.is_open()) {
-            zip_close(zip);
+        InputSource content;
+        if (!content.open(inputPath)) {
+            zip.discard();
             result.success = false;
             result.errorMessage = "No se pudo abrir el archivo de entrada";
             return result;
         }
 
-        std::vector<unsigned char> content((std::istreambuf_iterator<char>(inputFile)),
-                                          std::istreambuf_iterator<char>());
-        inputFile.close();
-
-        // Compress content
-        std::vector<unsigned char> compressed;
-        uLong compressedSize = compressBound(content.size());
-        compressed.resize(compressedSize);
-
-        if (compress2(compressed.data(), &compressedSize,
-                     content.data(), content.size(), Z_BEST_COMPRESSION) != Z_OK) {
-            zip_close(zip);
-            result.success = false;
-            result.errorMessage = "Error en la compresión";
-            return result;
+        // Deflate once ourselves and copy the raw stream straight into the entry
+        fs::path inputFileName = fs::path(inputPath).filename();
+        time_t modificationTime = 0;
+        struct stat info;
+        if (fstat(content.fileDescriptor(), &info) == 0) {
+            modificationTime = info.st_mtime;
         }
 
-        // Add compressed file to ZIP
-        fs::path inputFileName = fs::path(inputPath).filename();
-        zip_source_t *source = zip_source_buffer(zip, compressed.data(), compressedSize, 0);
-        if (zip_file_add(zip, inputFileName.string().c_str(), source, ZIP_FL_OVERWRITE) < 0) {
-            zip_source_free(source);
-            zip_close(zip);
+        // Blocks are deflated on every core and joined into one raw stream
+        ParallelDeflate::Options options;
+        options.cancel = cancel;
+        ParallelDeflate deflater(options);
+        DeflateStream::Sink sink = [&zip](const unsigned char *data, size_t size) {
+            return zip.writeEntryData(data, size);
+        };
+
+        bool ok = zip.beginEntry(inputFileName.string(), ZipWriter::MethodDeflate, modificationTime,
+                                 content.knownSize())
+               && deflater.compress(content, sink)
+               && zip.endEntry(deflater.crc(), deflater.totalIn())
+               && zip.close();
+
+        if (!ok) {
+            std::string message = !zip.errorMessage().empty() ? zip.errorMessage()
+                                : !deflater.errorMessage().empty() ? deflater.errorMessage()
+                                : content.errorMessage();
+            zip.discard();
             result.success = false;
-            result.errorMessage = "Error al agregar archivo al ZIP";
+            result.errorMessage = message.empty() ? "Error en la compresión" : message;
             return result;
         }
 
-        zip_close(zip);
-
         result.success = true;
-        result.originalSize = content.size();
+        result.originalSize = deflater.totalIn();
         result.compressedSize = fs::file_size(zipPath);
-        result.compressionRatio = ((double)(result.originalSize - result.compressedSize) / result.originalSize) * 100.0;
+        result.compressionRatio = compressionRatio(result.originalSize, result.compressedSize);
         result.outputPath = zipPath;
 
     } catch (const std::exception &e) {
@@ -240,7 +265,8 @@ CompressionResult PureCppCompressor::compressToZip(const std::string &inputPath,
     return result;
 }
 
-CompressionResult PureCppCompressor::compressImage(const std::string &inputPath, const std::string &outputPath)
+CompressionResult PureCppCompressor::compressImage(const std::string &inputPath, const std::string &outputPath,
+                                                   const CancellationToken *cancel)
 {
     CompressionResult result;
 
@@ -258,36 +284,39 @@ CompressionResult PureCppCompressor::compressImage(const std::string &inputPath,
             return result;
         }
 
-        // Read image file
-        std::ifstream imageFile(inputPath, std::ios::binary);
-        if (!imageFile.is_open()) {
-            zip_close(zip);
+        // Stream the image into the archive while libzip compresses it
+        uint64_t bytesRead = 0;
+        zip_source_t *source = ZipStreamSource::create(zip, inputPath, &bytesRead, cancel);
+        if (!source) {
+            zip_discard(zip);
             result.success = false;
             result.errorMessage = "No se pudo abrir el archivo de imagen";
             return result;
         }
 
-        std::vector<unsigned char> imageContent((std::istreambuf_iterator<char>(imageFile)),
-                                               std::istreambuf_iterator<char>());
-        imageFile.close();
-
         // Add image directly to ZIP (ZIP will handle compression)
         fs::path inputFileName = fs::path(inputPath).filename();
-        zip_source_t *source = zip_source_buffer(zip, imageContent.data(), imageContent.size(), 0);
         if (zip_file_add(zip, inputFileName.string().c_str(), source, ZIP_FL_OVERWRITE) < 0) {
             zip_source_free(source);
-            zip_close(zip);
+            zip_discard(zip);
             result.success = false;
             result.errorMessage = "Error al agregar imagen al ZIP";
             return result;
         }
 
-        zip_close(zip);
+        // The input is read and compressed here
+        if (zip_close(zip) < 0) {
+            zip_discard(zip);
+            result.success = false;
+            result.errorMessage = CancellationToken::cancelled(cancel) ? CancellationToken::CancelledMessage
+                                                                       : "Error al escribir el archivo ZIP";
+            return result;
+        }
 
         result.success = true;
-        result.originalSize = imageContent.size();
+        result.originalSize = bytesRead;
         result.compressedSize = fs::file_size(zipPath);
-        result.compressionRatio = ((double)(result.originalSize - result.compressedSize) / result.originalSize) * 100.0;
+        result.compressionRatio = compressionRatio(result.originalSize, result.compressedSize);
         result.outputPath = zipPath;
 
     } catch (const std::exception &e) {
@@ -297,3 +326,81 @@ CompressionResult PureCppCompressor::compressImage(const std::string &inputPath,
 
     return result;
 }
+
+CompressionResult PureCppCompressor::compressToArchive(const std::vector<std::string> &inputPaths,
+                                                       const std::string &outputPath,
+                                                       std::vector<CompressionResult> *failures,
+                                                       const CancellationToken *cancel)
+{
+    CompressionResult result;
+    result.filename = fs::path(outputPath).filename().string();
+    result.outputPath = outputPath;
+
+    try {
+        std::vector<ZipArchiveBuilder::Entry> entries = ZipArchiveBuilder::collectEntries(inputPaths, outputPath);
+
+        ZipArchiveBuilder::Options options;
+        options.cancel = cancel;
+        ZipArchiveBuilder builder(options);
+        if (!builder.build(outputPath, entries)) {
+            result.errorMessage = builder.errorMessage();
+            return result;
+        }
+
+        for (size_t i = 0; i < entries.size() && failures; ++i) {
+            const ZipArchiveBuilder::EntryResult &entryResult = builder.results()[i];
+            if (!entryResult.success) {
+                CompressionResult failure;
+                failure.filename = entries[i].name;
+                failure.errorMessage = entryResult.errorMessage;
+                failures->push_back(failure);
+            }
+        }
+
+        result.success = true;
+        result.originalSize = builder.totalIn();
+        result.compressedSize = builder.archiveSize();
+        result.compressionRatio = compressionRatio(result.originalSize, result.compressedSize);
+    } catch (const std::exception &e) {
+        result.success = false;
+        result.errorMessage = std::string("Error: ") + e.what();
+    }
+
+    return result;
+}
+
+CompressionResult PureCppCompressor::compressToBzip2(const std::string &inputPath, const std::string &outputPath,
+                                                     const CancellationToken *cancel)
+{
+    CompressionResult result;
+    result.filename = fs::path(inputPath).filename().string();
+
+    std::string bzip2Path = outputPath;
+    if (fs::path(bzip2Path).extension() != ".bz2") {
+        bzip2Path += ".bz2";
+    }
+    result.outputPath = bzip2Path;
+
+    ParallelBzip2::Options options;
+    options.cancel = cancel;
+    ParallelBzip2 engine(options);
+    if (!engine.compressFile(inputPath, bzip2Path)) {
+        result.errorMessage = engine.errorMessage();
+        return result;
+    }
+
+    result.success = true;
+    result.originalSize = engine.totalIn();
+    result.compressedSize = engine.totalOut();
+    result.compressionRatio = compressionRatio(result.originalSize, result.compressedSize);
+    return result;
+}
+
+double PureCppCompressor::compressionRatio(uint64_t originalSize, uint64_t compressedSize)
+{
+    if (originalSize == 0) {
+        return 0.0;
+    }
+    // Signed maths in double: the sizes are unsigned and the output can be larger
+    return (static_cast<double>(originalSize) - static_cast<double>(compressedSize)) / originalSize * 100.0;
+}
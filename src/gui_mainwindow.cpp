@@ -1,5 +1,6 @@
 #include "gui_mainwindow.h"
 #include "gui_compressor.h"
+#include "parallel_batch.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGroupBox>
@@ -18,7 +19,8 @@
 #include <QSettings>
 #include <QHeaderView>
 #include <QMimeData>
-#include <QDebug> // Added for qDebug
+#include <QSet>
+#include <algorithm>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -41,7 +43,11 @@ MainWindow::MainWindow(QWidget *parent)
     , m_overwriteCheck(nullptr)
     , m_resultsTable(nullptr)
     , m_isCompressing(false)
+    , m_compressionThread(nullptr)
+    , m_filesCompressed(0)
 {
+    qRegisterMetaType<CompressionResult>();
+
     setupUI();
     setupConnections();
     loadSettings();
@@ -62,6 +68,12 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    if (m_compressionThread) {
+        // The batch uses this window's token and signals: stop it first
+        m_cancel.cancel();
+        m_compressionThread->wait();
+        delete m_compressionThread;
+    }
     saveSettings();
 }
 
@@ -136,7 +148,7 @@ void MainWindow::createCompressionOptionsSection(QVBoxLayout *mainLayout)
     QHBoxLayout *typeLayout = new QHBoxLayout;
     QLabel *typeLabel = new QLabel("Tipo de compresión:");
     m_compressionTypeCombo = new QComboBox;
-    m_compressionTypeCombo->addItems({"Automático", "ZIP", "GZIP", "Optimizado"});
+    m_compressionTypeCombo->addItems({"Automático", "ZIP", "GZIP", "Optimizado", "ZIP (un solo archivo)", "BZIP2"});
     typeLayout->addWidget(typeLabel);
     typeLayout->addWidget(m_compressionTypeCombo);
     optionsLayout->addLayout(typeLayout);
@@ -241,6 +253,9 @@ void MainWindow::setupConnections()
     connect(m_stopButton, &QPushButton::clicked, this, &MainWindow::stopCompression);
     connect(m_clearResultsButton, &QPushButton::clicked, this, &MainWindow::clearResults);
 
+    // Queued: emitted from the compression thread
+    connect(this, &MainWindow::fileCompressed, this, &MainWindow::onFileCompressed, Qt::QueuedConnection);
+
     // Connect slider signals
     connect(m_compressionLevelSlider, &QSlider::valueChanged, [this](int value) {
         m_compressionLevelLabel->setText(QString("Nivel de compresión: %1").arg(value));
@@ -253,8 +268,6 @@ void MainWindow::setupConnections()
 
 void MainWindow::addFiles()
 {
-    qDebug() << "addFiles() called";
-
     // Use non-native dialog to ensure it works on macOS
     QFileDialog *dialog = new QFileDialog(this);
     dialog->setWindowTitle("Seleccionar archivos para comprimir");
@@ -272,7 +285,6 @@ void MainWindow::addFiles()
 
     if (dialog->exec() == QDialog::Accepted) {
         QStringList files = dialog->selectedFiles();
-        qDebug() << "Files selected:" << files;
 
         if (!files.isEmpty()) {
             for (const QString &file : files) {
@@ -286,8 +298,6 @@ void MainWindow::addFiles()
         } else {
             QMessageBox::information(this, "Info", "No se seleccionaron archivos");
         }
-    } else {
-        qDebug() << "Dialog was cancelled";
     }
 
     dialog->deleteLater();
@@ -295,8 +305,6 @@ void MainWindow::addFiles()
 
 void MainWindow::clearFiles()
 {
-    QMessageBox::information(this, "Debug", "Botón 'Limpiar Lista' fue presionado");
-
     m_selectedFiles.clear();
     m_fileListWidget->clear();
     updateStatus();
@@ -306,8 +314,6 @@ void MainWindow::clearFiles()
 
 void MainWindow::selectOutputDirectory()
 {
-    qDebug() << "selectOutputDirectory() called";
-
     // Use non-native dialog to ensure it works on macOS
     QFileDialog *dialog = new QFileDialog(this);
     dialog->setWindowTitle("Seleccionar directorio de salida");
@@ -327,8 +333,6 @@ void MainWindow::selectOutputDirectory()
         QStringList dirs = dialog->selectedFiles();
         if (!dirs.isEmpty()) {
             QString dir = dirs.first();
-            qDebug() << "Directory selected:" << dir;
-
             m_outputDirectory = dir;
             m_outputPathLabel->setText("Directorio de salida: " + dir);
             updateStatus();
@@ -336,8 +340,6 @@ void MainWindow::selectOutputDirectory()
         } else {
             QMessageBox::information(this, "Info", "No se seleccionó ningún directorio");
         }
-    } else {
-        qDebug() << "Directory dialog was cancelled";
     }
 
     dialog->deleteLater();
@@ -345,7 +347,9 @@ void MainWindow::selectOutputDirectory()
 
 void MainWindow::startCompression()
 {
-    QMessageBox::information(this, "Debug", "Botón 'Iniciar Compresión' fue presionado");
+    if (m_compressionThread) {
+        return;
+    }
 
     if (m_selectedFiles.isEmpty()) {
         QMessageBox::warning(this, "Error", "Por favor selecciona al menos un archivo.");
@@ -358,6 +362,8 @@ void MainWindow::startCompression()
     }
 
     m_isCompressing = true;
+    m_cancel.reset();
+    m_filesCompressed = 0;
     m_compressButton->setEnabled(false);
     m_stopButton->setEnabled(true);
     m_progressBar->setVisible(true);
@@ -368,19 +374,17 @@ void MainWindow::startCompression()
     // Clear previous results
     m_resultsTable->setRowCount(0);
 
-    // Start compression synchronously
     compressFiles();
 }
 
 void MainWindow::stopCompression()
 {
-    QMessageBox::information(this, "Debug", "Botón 'Detener' fue presionado");
+    // The running files stop at their next block and their outputs are
+    // removed; onCompressionFinished restores the controls
+    m_cancel.cancel();
 
-    m_isCompressing = false;
-    m_compressButton->setEnabled(true);
     m_stopButton->setEnabled(false);
-    m_progressBar->setVisible(false);
-    m_progressLabel->setText("Compresión detenida");
+    m_progressLabel->setText("Deteniendo compresión...");
 }
 
 void MainWindow::clearResults()
@@ -391,29 +395,122 @@ void MainWindow::clearResults()
 
 void MainWindow::compressFiles()
 {
-    for (int i = 0; i < m_selectedFiles.size(); ++i) {
-        if (!m_isCompressing) break;
+    const QStringList files = m_selectedFiles;
+    const QString outputDirectory = m_outputDirectory;
+    const bool archive = m_compressionTypeCombo->currentText() == "ZIP (un solo archivo)";
+    const bool bzip2 = m_compressionTypeCombo->currentText() == "BZIP2";
+
+    if (archive) {
+        m_progressBar->setRange(0, 0);
+        m_progressLabel->setText("Comprimiendo en un solo archivo ZIP...");
+    }
+
+    // The batch runs off the UI thread; each result comes back as a queued
+    // fileCompressed signal and the thread's finished signal ends the run
+    m_compressionThread = QThread::create([this, files, outputDirectory, archive, bzip2]() {
+        if (archive) {
+            compressToArchive(files, outputDirectory);
+        } else {
+            compressBatch(files, outputDirectory, bzip2);
+        }
+    });
+    connect(m_compressionThread, &QThread::finished, this, &MainWindow::onCompressionFinished);
+    m_compressionThread->start();
+}
+
+void MainWindow::compressBatch(const QStringList &files, const QString &outputDirectory, bool bzip2)
+{
+    std::vector<uint64_t> sizes;
+    for (const QString &file : files) {
+        sizes.push_back(static_cast<uint64_t>(std::max<qint64>(QFileInfo(file).size(), 0)));
+    }
+
+    // Outputs are named after the whole input name (a.txt.zip, a.txt.bz2).
+    // Files run concurrently, so a second input with the same name from
+    // another folder would truncate the first one's output mid-write: it
+    // fails up front instead
+    QStringList outputFiles;
+    std::vector<bool> duplicate(static_cast<size_t>(files.size()), false);
+    QSet<QString> seen;
+    for (int i = 0; i < files.size(); ++i) {
+        QString outputFile = outputDirectory + "/" + QFileInfo(files.at(i)).fileName() + (bzip2 ? ".bz2" : ".zip");
+        outputFiles.append(outputFile);
+        QString key = QDir::cleanPath(QFileInfo(outputFile).absoluteFilePath());
+        if (seen.contains(key)) {
+            duplicate[static_cast<size_t>(i)] = true;
+        }
+        seen.insert(key);
+    }
+
+    // One worker per available CPU, largest files first; big files are split
+    // into deflate or bzip2 blocks that idle workers pick up
+    ParallelBatch batch;
+    batch.run(static_cast<size_t>(files.size()), [&](size_t index, unsigned) {
+        if (m_cancel.isCancelled()) {
+            return;
+        }
+
+        QFileInfo fileInfo(files.at(static_cast<int>(index)));
+        const QString &outputFile = outputFiles.at(static_cast<int>(index));
+        CompressionResult result;
+        if (duplicate[index]) {
+            result.filename = fileInfo.fileName().toStdString();
+            result.errorMessage = QString("Otro archivo de la lista ya se comprime en %1")
+                                      .arg(QFileInfo(outputFile).fileName()).toStdString();
+        } else if (bzip2) {
+            result = PureCppCompressor::compressToBzip2(fileInfo.filePath().toStdString(), outputFile.toStdString(),
+                                                        &m_cancel);
+        } else {
+            result = PureCppCompressor::compressFile(fileInfo.filePath().toStdString(), outputFile.toStdString(),
+                                                     &m_cancel);
+        }
+        emit fileCompressed(result, fileInfo.fileName());
+    }, sizes);
+}
 
-        QString inputFile = m_selectedFiles[i];
-        QFileInfo fileInfo(inputFile);
-        QString outputFile = m_outputDirectory + "/" + fileInfo.baseName() + "_compressed";
+void MainWindow::compressToArchive(const QStringList &files, const QString &outputDirectory)
+{
+    std::vector<std::string> inputPaths;
+    for (const QString &file : files) {
+        inputPaths.push_back(file.toStdString());
+    }
+    QString outputFile = outputDirectory + "/archivo.zip";
 
-        CompressionResult result = PureCppCompressor::compressFile(inputFile.toStdString(), outputFile.toStdString());
+    std::vector<CompressionResult> failures;
+    CompressionResult result = PureCppCompressor::compressToArchive(inputPaths, outputFile.toStdString(), &failures,
+                                                                    &m_cancel);
 
-        addResultToTable(result, fileInfo.fileName());
-        m_progressBar->setValue(i + 1);
-        m_progressLabel->setText(QString("Comprimiendo %1...").arg(fileInfo.fileName()));
+    for (const CompressionResult &failure : failures) {
+        emit fileCompressed(failure, QString::fromStdString(failure.filename));
+    }
+    emit fileCompressed(result, QFileInfo(outputFile).fileName());
+}
 
-        // Process events to keep UI responsive
-        QApplication::processEvents();
+void MainWindow::onFileCompressed(const CompressionResult &result, const QString &fileName)
+{
+    addResultToTable(result, fileName);
+
+    if (m_progressBar->maximum() > 0) {
+        ++m_filesCompressed;
+        m_progressBar->setValue(m_filesCompressed);
+        if (!m_cancel.isCancelled()) {
+            m_progressLabel->setText(QString("Comprimido %1 (%2/%3)")
+                                         .arg(fileName).arg(m_filesCompressed).arg(m_progressBar->maximum()));
+        }
     }
+}
+
+void MainWindow::onCompressionFinished()
+{
+    m_compressionThread->deleteLater();
+    m_compressionThread = nullptr;
 
-    // Compression finished
     m_isCompressing = false;
     m_compressButton->setEnabled(true);
     m_stopButton->setEnabled(false);
+    m_progressBar->setRange(0, m_selectedFiles.size());
     m_progressBar->setVisible(false);
-    m_progressLabel->setText("Compresión completada");
+    m_progressLabel->setText(m_cancel.isCancelled() ? "Compresión detenida" : "Compresión completada");
     updateStatus();
 }
 
@@ -432,7 +529,7 @@ void MainWindow::addResultToTable(const CompressionResult &result, const QString
     m_resultsTable->setItem(row, 4, statusItem);
 }
 
-QString MainWindow::formatFileSize(size_t bytes)
+QString MainWindow::formatFileSize(uint64_t bytes)
 {
     const char* units[] = {"B", "KB", "MB", "GB"};
     int unit = 0;
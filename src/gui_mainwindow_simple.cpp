@@ -397,6 +397,7 @@ void MainWindow::clearResults()
 void MainWindow::compressFiles()
 {
     int totalFiles = m_selectedFiles.size();
+    const bool bzip2 = m_compressionTypeCombo->currentText() == "BZIP2";
 
     for (int i = 0; i < totalFiles && !m_compressionWatcher->isCanceled(); ++i) {
         const QString &filePath = m_selectedFiles[i];
@@ -412,8 +413,11 @@ void MainWindow::compressFiles()
         // Compress file
         QString outputPath = m_outputDirectory + "/" + fileInfo.baseName() + "_compressed" + fileInfo.suffix();
 
-        // Use the pure C++ compressor
-        CompressionResult result = PureCppCompressor::compressFile(filePath.toStdString(), outputPath.toStdString());
+        // Use the pure C++ compressor; BZIP2 writes a standard name.ext.bz2
+        CompressionResult result = bzip2
+            ? PureCppCompressor::compressToBzip2(filePath.toStdString(),
+                                                 (m_outputDirectory + "/" + fileInfo.fileName()).toStdString())
+            : PureCppCompressor::compressFile(filePath.toStdString(), outputPath.toStdString());
 
         // Add result to table
         QMetaObject::invokeMethod(this, [this, result, fileInfo]() {
@@ -440,7 +444,7 @@ void MainWindow::addResultToTable(const CompressionResult &result, const QString
     m_resultsTable->setItem(row, 4, statusItem);
 }
 
-QString MainWindow::formatFileSize(size_t bytes)
+QString MainWindow::formatFileSize(uint64_t bytes)
 {
     const QStringList units = {"B", "KB", "MB", "GB"};
     double size = bytes;
@@ -0,0 +1,197 @@
+#include "input_source.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+InputSource::InputSource()
+    : m_fd(-1)
+    , m_map(nullptr)
+    , m_size(0)
+    , m_position(0)
+    , m_loaded(false)
+{
+}
+
+InputSource::~InputSource()
+{
+    close();
+}
+
+bool InputSource::open(const std::string &path)
+{
+    close();
+
+    m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) {
+        m_errorMessage = "No se pudo abrir el archivo de entrada";
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(m_fd, &info) != 0) {
+        m_errorMessage = "No se pudo leer la información del archivo";
+        close();
+        return false;
+    }
+
+    if (!S_ISREG(info.st_mode) || info.st_size <= 0) {
+        // Pipes, character devices and empty files use read()
+        return true;
+    }
+
+    m_size = static_cast<uint64_t>(info.st_size);
+    void *map = mmap(nullptr, static_cast<size_t>(m_size), PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (map != MAP_FAILED) {
+        m_map = map;
+        madvise(m_map, static_cast<size_t>(m_size), MADV_SEQUENTIAL);
+    }
+
+    return true;
+}
+
+void InputSource::close()
+{
+    if (m_map) {
+        munmap(m_map, static_cast<size_t>(m_size));
+        m_map = nullptr;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_size = 0;
+    m_position = 0;
+    m_loaded = false;
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+}
+
+const unsigned char *InputSource::data()
+{
+    if (m_map) {
+        return static_cast<const unsigned char *>(m_map);
+    }
+    if (!m_loaded) {
+        loadRemaining();
+    }
+    return m_buffer.data();
+}
+
+uint64_t InputSource::size()
+{
+    if (m_map) {
+        return m_size;
+    }
+    if (!m_loaded) {
+        loadRemaining();
+    }
+    return m_buffer.size();
+}
+
+long long InputSource::read(unsigned char *buffer, size_t size)
+{
+    if (m_fd < 0) {
+        m_errorMessage = "El archivo de entrada no está abierto";
+        return -1;
+    }
+
+    if (m_map || m_loaded) {
+        uint64_t available = (m_map ? m_size : m_buffer.size()) - m_position;
+        size_t count = static_cast<size_t>(std::min<uint64_t>(available, size));
+        const unsigned char *base = m_map ? static_cast<const unsigned char *>(m_map) : m_buffer.data();
+        if (count > 0) {
+            std::memcpy(buffer, base + m_position, count);
+        }
+        m_position += count;
+        return static_cast<long long>(count);
+    }
+
+    // Fill as much of the buffer as possible so callers see full blocks
+    size_t total = 0;
+    while (total < size) {
+        ssize_t got = ::read(m_fd, buffer + total, size - total);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            m_errorMessage = "Error al leer el archivo de entrada";
+            return -1;
+        }
+        if (got == 0) {
+            break;
+        }
+        total += static_cast<size_t>(got);
+    }
+    m_position += total;
+    return static_cast<long long>(total);
+}
+
+bool InputSource::rewind()
+{
+    if (m_fd < 0) {
+        return false;
+    }
+    if (m_map || m_loaded || m_position == 0) {
+        m_position = 0;
+        return true;
+    }
+    if (lseek(m_fd, 0, SEEK_SET) != 0) {
+        m_errorMessage = "No se puede volver al inicio de la entrada";
+        return false;
+    }
+    m_position = 0;
+    return true;
+}
+
+void InputSource::willNeed(uint64_t offset, uint64_t length)
+{
+    if (!m_map || offset >= m_size) {
+        return;
+    }
+
+    // madvise needs a page-aligned start
+    static const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t start = offset - (offset % pageSize);
+    uint64_t end = std::min(m_size, offset + length);
+    madvise(static_cast<unsigned char *>(m_map) + start, static_cast<size_t>(end - start), MADV_WILLNEED);
+}
+
+bool InputSource::loadRemaining()
+{
+    m_loaded = true;
+    if (m_fd < 0) {
+        return false;
+    }
+
+    if (m_size > 0) {
+        m_buffer.reserve(static_cast<size_t>(m_size));
+    }
+
+    size_t used = 0;
+    while (true) {
+        if (m_buffer.size() < used + ReadBlockSize) {
+            m_buffer.resize(used + ReadBlockSize);
+        }
+        ssize_t got = ::read(m_fd, m_buffer.data() + used, ReadBlockSize);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            m_errorMessage = "Error al leer el archivo de entrada";
+            m_buffer.resize(used);
+            return false;
+        }
+        if (got == 0) {
+            break;
+        }
+        used += static_cast<size_t>(got);
+    }
+
+    m_buffer.resize(used);
+    m_position = 0;
+    return true;
+}
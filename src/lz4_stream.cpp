@@ -0,0 +1,257 @@
+#include "lz4_stream.h"
+#include "cancellation_token.h"
+#include "input_source.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#include <lz4frame.h>
+#include <lz4hc.h>
+#endif
+
+namespace {
+
+const char *const UnavailableMessage = "Esta versión se compiló sin soporte para lz4";
+
+#ifdef HAVE_LZ4
+// Same frame layout as the lz4 command: 4 MiB independent blocks, checksummed
+LZ4F_preferences_t preferences(int level, uint64_t expectedSize)
+{
+    LZ4F_preferences_t preferences;
+    std::fill_n(reinterpret_cast<unsigned char *>(&preferences), sizeof(preferences), 0);
+    preferences.frameInfo.blockSizeID = LZ4F_max4MB;
+    preferences.frameInfo.blockMode = LZ4F_blockIndependent;
+    preferences.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+    preferences.frameInfo.contentSize = expectedSize;
+    preferences.compressionLevel = level;
+    return preferences;
+}
+#endif
+
+} // namespace
+
+bool Lz4Stream::available()
+{
+#ifdef HAVE_LZ4
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t Lz4Stream::memoryEstimate(const Options &options)
+{
+#ifdef HAVE_LZ4
+    int level = std::clamp(options.level, FastestLevel, MaxLevel);
+    LZ4F_preferences_t settings = preferences(level, 0);
+    // The frame buffers one block of input; HC keeps a much larger match state
+    uint64_t state = level >= HcMinLevel ? LZ4_sizeofStateHC() : LZ4_sizeofState();
+    return 4 * 1024 * 1024 + LZ4F_compressBound(DeflateStream::DefaultBufferSize, &settings) + state
+           + DeflateStream::DefaultBufferSize;
+#else
+    (void)options;
+    return 0;
+#endif
+}
+
+Lz4Stream::Lz4Stream()
+    : Lz4Stream(Options())
+{
+}
+
+Lz4Stream::Lz4Stream(const Options &options, size_t bufferSize)
+    : m_context(nullptr)
+    , m_options(options)
+    , m_started(false)
+    , m_finished(false)
+    , m_bufferSize(std::max<size_t>(bufferSize, 4096))
+    , m_expectedSize(0)
+    , m_totalIn(0)
+    , m_totalOut(0)
+    , m_cancel(nullptr)
+{
+    m_options.level = std::clamp(m_options.level, FastestLevel, MaxLevel);
+
+#ifdef HAVE_LZ4
+    if (LZ4F_isError(LZ4F_createCompressionContext(&m_context, LZ4F_VERSION))) {
+        m_context = nullptr;
+        m_errorMessage = "No se pudo inicializar lz4";
+    }
+#else
+    m_errorMessage = UnavailableMessage;
+#endif
+}
+
+Lz4Stream::~Lz4Stream()
+{
+#ifdef HAVE_LZ4
+    LZ4F_freeCompressionContext(m_context);
+#endif
+}
+
+void Lz4Stream::setExpectedSize(uint64_t size)
+{
+    if (!m_started) {
+        m_expectedSize = size;
+    }
+}
+
+bool Lz4Stream::write(const unsigned char *data, size_t size, const DeflateStream::Sink &sink)
+{
+    if (!m_context || m_finished) {
+        if (m_errorMessage.empty()) {
+            m_errorMessage = "El flujo de compresión ya fue cerrado";
+        }
+        return false;
+    }
+    if (!m_started && !begin(sink)) {
+        return false;
+    }
+
+#ifdef HAVE_LZ4
+    while (size > 0) {
+        if (CancellationToken::cancelled(m_cancel)) {
+            m_errorMessage = CancellationToken::CancelledMessage;
+            return false;
+        }
+        size_t slice = std::min(size, m_bufferSize);
+        size_t written = LZ4F_compressUpdate(m_context, m_outBuffer.data(), m_outBuffer.size(), data, slice, nullptr);
+        if (!emit(written, sink)) {
+            return false;
+        }
+        m_totalIn += slice;
+        data += slice;
+        size -= slice;
+    }
+    return true;
+#else
+    (void)data;
+    (void)size;
+    return false;
+#endif
+}
+
+bool Lz4Stream::finish(const DeflateStream::Sink &sink)
+{
+    if (!m_context || m_finished) {
+        if (m_errorMessage.empty()) {
+            m_errorMessage = "El flujo de compresión ya fue cerrado";
+        }
+        return false;
+    }
+    // An empty input still makes a complete frame
+    if (!m_started && !begin(sink)) {
+        return false;
+    }
+
+    m_finished = true;
+#ifdef HAVE_LZ4
+    return emit(LZ4F_compressEnd(m_context, m_outBuffer.data(), m_outBuffer.size(), nullptr), sink);
+#else
+    return false;
+#endif
+}
+
+bool Lz4Stream::begin(const DeflateStream::Sink &sink)
+{
+    m_started = true;
+#ifdef HAVE_LZ4
+    LZ4F_preferences_t settings = preferences(m_options.level, m_expectedSize);
+    // Room for one buffer of input plus the end of the frame
+    m_outBuffer.resize(std::max<size_t>(LZ4F_compressBound(m_bufferSize, &settings), LZ4F_HEADER_SIZE_MAX));
+    return emit(LZ4F_compressBegin(m_context, m_outBuffer.data(), m_outBuffer.size(), &settings), sink);
+#else
+    (void)sink;
+    m_errorMessage = UnavailableMessage;
+    return false;
+#endif
+}
+
+bool Lz4Stream::emit(size_t result, const DeflateStream::Sink &sink)
+{
+#ifdef HAVE_LZ4
+    if (LZ4F_isError(result)) {
+        m_errorMessage = std::string("Error en la compresión lz4: ") + LZ4F_getErrorName(result);
+        return false;
+    }
+    if (result > 0) {
+        if (!sink(m_outBuffer.data(), result)) {
+            if (m_errorMessage.empty()) {
+                m_errorMessage = "Error al escribir los datos comprimidos";
+            }
+            return false;
+        }
+        m_totalOut += result;
+    }
+    return true;
+#else
+    (void)result;
+    (void)sink;
+    return false;
+#endif
+}
+
+bool Lz4Stream::compressFile(const std::string &inputPath, const std::string &outputPath,
+                             const DeflateStream::ProgressCallback &progress)
+{
+    if (!m_context) {
+        return false;
+    }
+
+    InputSource inputFile;
+    if (!inputFile.open(inputPath)) {
+        m_errorMessage = inputFile.errorMessage();
+        return false;
+    }
+    uint64_t totalBytes = inputFile.knownSize();
+    setExpectedSize(totalBytes);
+
+    std::ofstream outputFile(outputPath, std::ios::binary | std::ios::trunc);
+    if (!outputFile.is_open()) {
+        m_errorMessage = "No se pudo crear el archivo de salida";
+        return false;
+    }
+
+    DeflateStream::Sink sink = [&outputFile](const unsigned char *data, size_t size) {
+        outputFile.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(outputFile);
+    };
+
+    auto abandon = [&](const std::string &message) {
+        if (!message.empty()) {
+            m_errorMessage = message;
+        }
+        outputFile.close();
+        std::remove(outputPath.c_str());
+        return false;
+    };
+
+    std::vector<unsigned char> inBuffer(InputSource::ReadBlockSize);
+    while (true) {
+        long long got = inputFile.read(inBuffer.data(), inBuffer.size());
+        if (got < 0) {
+            return abandon(inputFile.errorMessage());
+        }
+        if (got == 0) {
+            break;
+        }
+        if (!write(inBuffer.data(), static_cast<size_t>(got), sink)) {
+            return abandon(std::string());
+        }
+        if (progress) {
+            progress(m_totalIn, totalBytes);
+        }
+    }
+
+    if (!finish(sink)) {
+        return abandon(std::string());
+    }
+
+    outputFile.close();
+    if (!outputFile) {
+        return abandon("Error al escribir los datos comprimidos");
+    }
+    return true;
+}
@@ -1,9 +1,14 @@
 #include "mainwindow.h"
 #include "progressdialog.h"
+#include "cancellation_token.h"
+#include "xz_stream.h"
+#include "zstd_stream.h"
 #include <QApplication>
 #include <QStyle>
 #include <QScreen>
 #include <QTimer>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -27,6 +32,10 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    // Don't leave the batch running against a destroyed window
+    m_compressor->cancel();
+    m_compressionWatcher->waitForFinished();
+
     if (m_compressorThread->isRunning()) {
         m_compressorThread->quit();
         m_compressorThread->wait();
@@ -116,14 +125,27 @@ void MainWindow::createCompressionOptionsSection()
     m_compressionTypeGroup = new QButtonGroup(this);
     m_zipRadioButton = new QRadioButton("ZIP (Recomendado)", this);
     m_gzipRadioButton = new QRadioButton("GZIP", this);
+    m_zstdRadioButton = new QRadioButton("Zstandard (.zst)", this);
+    m_zstdRadioButton->setEnabled(ZstdStream::available());
+    m_xzRadioButton = new QRadioButton("xz (archivado)", this);
+    m_xzRadioButton->setEnabled(XzStream::available());
+    m_xzRadioButton->setToolTip(QString("Máxima compresión, lenta; unos %1 MB de memoria por archivo")
+                                    .arg(m_compressor->xzMemoryEstimate() / (1024 * 1024)));
+    m_storeRadioButton = new QRadioButton("Sin compresión (copia)", this);
 
     m_zipRadioButton->setChecked(true);
     m_compressionTypeGroup->addButton(m_zipRadioButton);
     m_compressionTypeGroup->addButton(m_gzipRadioButton);
+    m_compressionTypeGroup->addButton(m_zstdRadioButton);
+    m_compressionTypeGroup->addButton(m_xzRadioButton);
+    m_compressionTypeGroup->addButton(m_storeRadioButton);
 
     compressionLayout->addWidget(compressionLabel);
     compressionLayout->addWidget(m_zipRadioButton);
     compressionLayout->addWidget(m_gzipRadioButton);
+    compressionLayout->addWidget(m_zstdRadioButton);
+    compressionLayout->addWidget(m_xzRadioButton);
+    compressionLayout->addWidget(m_storeRadioButton);
     compressionLayout->addStretch();
     optionsLayout->addLayout(compressionLayout);
 
@@ -182,6 +204,10 @@ void MainWindow::createControlButtons()
         "QPushButton { font-weight: bold; font-size: 14px; }"
     );
 
+    m_cancelButton = new QPushButton("Cancelar", this);
+    m_cancelButton->setMinimumHeight(40);
+    m_cancelButton->setEnabled(false);
+
     m_exitButton = new QPushButton("Salir", this);
     m_exitButton->setMinimumHeight(40);
     m_exitButton->setStyleSheet(
@@ -190,12 +216,14 @@ void MainWindow::createControlButtons()
     );
 
     buttonsLayout->addWidget(m_compressButton);
+    buttonsLayout->addWidget(m_cancelButton);
     buttonsLayout->addStretch();
     buttonsLayout->addWidget(m_exitButton);
 
     m_mainLayout->addLayout(buttonsLayout);
 
-    // Connect exit button
+    // Connect cancel and exit buttons
+    connect(m_cancelButton, &QPushButton::clicked, this, &MainWindow::cancelCompression);
     connect(m_exitButton, &QPushButton::clicked, this, &QWidget::close);
 }
 
@@ -256,7 +284,16 @@ void MainWindow::startCompression()
     m_resultsTextEdit->clear();
 
     // Get compression type
-    QString compressionType = m_zipRadioButton->isChecked() ? "zip" : "gzip";
+    QString compressionType = "zip";
+    if (m_gzipRadioButton->isChecked()) {
+        compressionType = "gzip";
+    } else if (m_zstdRadioButton->isChecked()) {
+        compressionType = "zstd";
+    } else if (m_xzRadioButton->isChecked()) {
+        compressionType = "xz";
+    } else if (m_storeRadioButton->isChecked()) {
+        compressionType = "store";
+    }
 
     // Set progress callback
     m_compressor->setProgressCallback([this](const QString &message, int percentage) {
@@ -265,6 +302,10 @@ void MainWindow::startCompression()
         }, Qt::QueuedConnection);
     });
 
+    // Cleared here, not in the task: a Cancelar click before the task
+    // starts must still stop it
+    m_compressor->resetCancellation();
+
     // Start compression in background
     QFuture<QList<CompressionResult>> future = QtConcurrent::run([this, compressionType]() {
         return m_compressor->compressMultipleFiles(m_selectedFiles, m_outputDirectory, compressionType);
@@ -273,11 +314,27 @@ void MainWindow::startCompression()
     m_compressionWatcher->setFuture(future);
 }
 
+void MainWindow::cancelCompression()
+{
+    // Workers stop at their next block; the watcher reports the partial results
+    m_compressor->cancel();
+    m_cancelButton->setEnabled(false);
+    m_progressLabel->setText("Cancelando...");
+}
+
 void MainWindow::onCompressionFinished(const QList<CompressionResult> &results)
 {
     displayResults(results);
     enableControls(true);
 
+    bool cancelled = std::any_of(results.begin(), results.end(), [](const CompressionResult &result) {
+        return result.errorMessage == CancellationToken::CancelledMessage;
+    });
+    if (cancelled) {
+        QMessageBox::information(this, "Cancelado", "Compresión cancelada.");
+        return;
+    }
+
     QMessageBox::information(this, "Completado", "Compresión completada exitosamente!");
 }
 
@@ -333,6 +390,14 @@ void MainWindow::displayResults(const QList<CompressionResult> &results)
         m_resultsTextEdit->append(QString("Tamaño total original: %1 MB").arg(totalOriginalMB, 0, 'f', 2));
         m_resultsTextEdit->append(QString("Tamaño total comprimido: %1 MB").arg(totalCompressedMB, 0, 'f', 2));
         m_resultsTextEdit->append(QString("Compresión total: %1%").arg(totalCompression, 0, 'f', 1));
+
+        double peakMB = m_compressor->peakMemory() / (1024.0 * 1024.0);
+        if (m_compressor->memoryBudget() > 0) {
+            double budgetMB = m_compressor->memoryBudget() / (1024.0 * 1024.0);
+            m_resultsTextEdit->append(QString("Memoria máxima: %1 MB de %2 MB").arg(peakMB, 0, 'f', 1).arg(budgetMB, 0, 'f', 1));
+        } else {
+            m_resultsTextEdit->append(QString("Memoria máxima: %1 MB").arg(peakMB, 0, 'f', 1));
+        }
     }
 }
 
@@ -348,6 +413,10 @@ void MainWindow::enableControls(bool enable)
     m_clearFilesButton->setEnabled(enable);
     m_selectOutputButton->setEnabled(enable);
     m_compressButton->setEnabled(enable);
+    m_cancelButton->setEnabled(!enable);
     m_zipRadioButton->setEnabled(enable);
     m_gzipRadioButton->setEnabled(enable);
+    m_zstdRadioButton->setEnabled(enable && ZstdStream::available());
+    m_xzRadioButton->setEnabled(enable && XzStream::available());
+    m_storeRadioButton->setEnabled(enable);
 }
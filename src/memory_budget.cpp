@@ -0,0 +1,105 @@
+#include "memory_budget.h"
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+
+MemoryBudget::MemoryBudget(uint64_t limit)
+    : m_limit(limit)
+    , m_inUse(0)
+    , m_peak(0)
+{
+}
+
+bool MemoryBudget::tryAcquire(uint64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_limit > 0 && m_inUse > 0 && m_inUse + bytes > m_limit) {
+        return false;
+    }
+    m_inUse += bytes;
+    m_peak = std::max(m_peak, m_inUse);
+    return true;
+}
+
+void MemoryBudget::acquire(uint64_t bytes)
+{
+    if (tryAcquire(bytes)) {
+        return;
+    }
+
+    if (WorkStealingPool *pool = WorkStealingPool::current()) {
+        // The pool wakes its helpers whenever a task (and so its charge) ends
+        pool->helpUntil([this, bytes]() { return tryAcquire(bytes); });
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this, bytes]() {
+        return m_inUse == 0 || m_inUse + bytes <= m_limit;
+    });
+    m_inUse += bytes;
+    m_peak = std::max(m_peak, m_inUse);
+}
+
+void MemoryBudget::release(uint64_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_inUse -= std::min(m_inUse, bytes);
+    }
+    m_condition.notify_all();
+}
+
+uint64_t MemoryBudget::inUse() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_inUse;
+}
+
+uint64_t MemoryBudget::peak() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_peak;
+}
+
+bool MemoryBudget::parseSize(const std::string &text, uint64_t &bytes)
+{
+    const char *begin = text.c_str();
+    char *end = nullptr;
+    double value = std::strtod(begin, &end);
+    // strtod also takes "nan", "inf" and huge exponents
+    if (end == begin || !std::isfinite(value) || value < 0) {
+        return false;
+    }
+
+    std::string unit(end);
+    std::transform(unit.begin(), unit.end(), unit.begin(), ::tolower);
+    if (unit.size() > 1 && (unit.compare(unit.size() - 2, 2, "ib") == 0)) {
+        unit.erase(unit.size() - 2);
+    } else if (unit.size() > 1 && unit.back() == 'b') {
+        unit.pop_back();
+    }
+
+    double multiplier = 1;
+    if (unit == "k") {
+        multiplier = 1024.0;
+    } else if (unit == "m") {
+        multiplier = 1024.0 * 1024.0;
+    } else if (unit == "g") {
+        multiplier = 1024.0 * 1024.0 * 1024.0;
+    } else if (unit == "t") {
+        multiplier = 1024.0 * 1024.0 * 1024.0 * 1024.0;
+    } else if (!unit.empty() && unit != "b") {
+        return false;
+    }
+
+    // Anything from 2^64 up would overflow the conversion
+    double total = value * multiplier;
+    if (total >= 18446744073709551616.0) {
+        return false;
+    }
+    bytes = static_cast<uint64_t>(total);
+    return true;
+}
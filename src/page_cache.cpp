@@ -0,0 +1,64 @@
+#include "page_cache.h"
+#include <fcntl.h>
+
+void PageCache::adviseSequential(int fd)
+{
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#else
+    (void)fd;
+#endif
+}
+
+void PageCache::willNeed(int fd, uint64_t offset, uint64_t length)
+{
+    // A length of 0 would mean "to the end of the file"
+    if (length == 0) {
+        return;
+    }
+#ifdef POSIX_FADV_WILLNEED
+    posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_WILLNEED);
+#else
+    (void)fd;
+    (void)offset;
+#endif
+}
+
+void PageCache::dropInput(int fd, uint64_t offset, uint64_t length)
+{
+    if (length == 0) {
+        return;
+    }
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+#else
+    (void)fd;
+    (void)offset;
+#endif
+}
+
+void PageCache::startWriteback(int fd, uint64_t offset, uint64_t length)
+{
+    if (length == 0) {
+        return;
+    }
+#ifdef __linux__
+    sync_file_range(fd, static_cast<off_t>(offset), static_cast<off_t>(length), SYNC_FILE_RANGE_WRITE);
+#else
+    (void)fd;
+    (void)offset;
+#endif
+}
+
+void PageCache::dropOutput(int fd, uint64_t offset, uint64_t length)
+{
+    if (length == 0) {
+        return;
+    }
+#ifdef __linux__
+    // DONTNEED skips dirty pages, so the range has to reach the disk first
+    sync_file_range(fd, static_cast<off_t>(offset), static_cast<off_t>(length),
+                    SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#endif
+    dropInput(fd, offset, length);
+}
@@ -0,0 +1,29 @@
+#include "parallel_batch.h"
+#include "cpu_count.h"
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <numeric>
+
+ParallelBatch::ParallelBatch(unsigned workers, bool pinWorkers)
+    : m_workers(workers > 0 ? workers : CpuCount::available())
+    , m_pinWorkers(pinWorkers)
+{
+}
+
+void ParallelBatch::run(size_t taskCount, const Task &task, const std::vector<uint64_t> &sizes)
+{
+    std::vector<size_t> order(taskCount);
+    std::iota(order.begin(), order.end(), 0);
+    if (sizes.size() == taskCount) {
+        // Largest first: small files fill the gaps at the end of the batch
+        std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) {
+            return sizes[a] > sizes[b];
+        });
+    }
+
+    WorkStealingPool pool(m_workers, m_pinWorkers);
+    for (size_t index : order) {
+        pool.submit([&task, index](unsigned worker) { task(index, worker); });
+    }
+    pool.run();
+}
@@ -0,0 +1,511 @@
+#include "parallel_bzip2.h"
+#include "cancellation_token.h"
+#include "cpu_count.h"
+#include "input_source.h"
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef HAVE_BZIP2
+#include <bzlib.h>
+#endif
+
+namespace {
+
+const char *const UnavailableMessage = "Esta versión se compiló sin soporte para bzip2";
+
+constexpr uint64_t BlockMagic = 0x314159265359ull;
+constexpr uint64_t EndMagic = 0x177245385090ull;
+constexpr uint64_t HeaderBits = 32;     // "BZh" and the level digit
+constexpr uint64_t TrailerBits = 80;    // end magic and stream CRC
+
+// Long runs shrink to 5 bytes per 255 in the first stage; past this many
+// input bytes per block the extra block headers no longer matter
+constexpr size_t MaxInputFactor = 4;
+
+// Block capacity after the first run-length stage, as libbz2 computes it
+size_t blockCapacity(int level)
+{
+    return static_cast<size_t>(level) * 100000 - 19;
+}
+
+// bzip2 stores runs of 4-255 equal bytes as the 4 bytes and a count
+size_t runCost(unsigned length)
+{
+    return length < 4 ? length : 5;
+}
+
+// Follows libbz2's first stage to find how much input fills one block
+class BlockCutter
+{
+public:
+    explicit BlockCutter(size_t capacity)
+        : m_capacity(capacity)
+        , m_flushed(0)
+        , m_runByte(-1)
+        , m_runLength(0)
+    {
+    }
+
+    // Bytes of data that still fit; fewer than size means the block is full
+    size_t take(const unsigned char *data, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i) {
+            size_t flushed = m_flushed;
+            unsigned length = m_runLength + 1;
+            if (data[i] != m_runByte || m_runLength == 255) {
+                flushed += runCost(m_runLength);
+                length = 1;
+            }
+            if (flushed + runCost(length) > m_capacity) {
+                return i;
+            }
+            m_flushed = flushed;
+            m_runByte = data[i];
+            m_runLength = length;
+        }
+        return size;
+    }
+
+private:
+    size_t m_capacity;
+    size_t m_flushed;
+    int m_runByte;
+    unsigned m_runLength;
+};
+
+uint64_t readBits(const std::vector<unsigned char> &data, uint64_t position, unsigned count)
+{
+    uint64_t value = 0;
+    for (unsigned i = 0; i < count; ++i, ++position) {
+        value = (value << 1) | ((data[position / 8] >> (7 - position % 8)) & 1);
+    }
+    return value;
+}
+
+// MSB-first bit packer; whole bytes are taken out with takeBytes()
+class BitWriter
+{
+public:
+    BitWriter()
+        : m_accumulator(0)
+        , m_bits(0)
+    {
+    }
+
+    void put(uint64_t value, unsigned count)
+    {
+        // count <= 32 keeps the accumulator within 40 bits
+        m_accumulator = (m_accumulator << count) | (value & ((uint64_t(1) << count) - 1));
+        m_bits += count;
+        while (m_bits >= 8) {
+            m_bits -= 8;
+            m_bytes.push_back(static_cast<unsigned char>(m_accumulator >> m_bits));
+        }
+        m_accumulator &= (uint64_t(1) << m_bits) - 1;
+    }
+
+    // Copies bits [begin, end) of data
+    void append(const std::vector<unsigned char> &data, uint64_t begin, uint64_t end)
+    {
+        m_bytes.reserve(m_bytes.size() + static_cast<size_t>((end - begin) / 8) + 1);
+        unsigned shift = static_cast<unsigned>(begin % 8);
+        size_t index = static_cast<size_t>(begin / 8);
+        for (; begin + 8 <= end; begin += 8, ++index) {
+            unsigned window = data[index] << 8;
+            if (shift > 0) {
+                window |= data[index + 1];
+            }
+            put((window >> (8 - shift)) & 0xff, 8);
+        }
+        if (begin < end) {
+            unsigned count = static_cast<unsigned>(end - begin);
+            put(readBits(data, begin, count), count);
+        }
+    }
+
+    // Zero-fills the last partial byte
+    void pad()
+    {
+        if (m_bits > 0) {
+            put(0, 8 - m_bits);
+        }
+    }
+
+    std::vector<unsigned char> &bytes() { return m_bytes; }
+
+private:
+    uint64_t m_accumulator;
+    unsigned m_bits;
+    std::vector<unsigned char> m_bytes;
+};
+
+struct Block
+{
+    std::vector<unsigned char> input;
+    std::vector<unsigned char> output;     // a complete one-block .bz2 stream
+    uint64_t endBit = 0;                   // where the end-of-stream marker starts
+    uint32_t crc = 0;
+    std::atomic<bool> done{false};
+    bool ok = false;
+    std::string error;
+};
+
+void compressBlock(Block &block, const ParallelBzip2::Options &options)
+{
+    if (CancellationToken::cancelled(options.cancel)) {
+        // Queued blocks of a cancelled run are dropped without compressing
+        block.error = CancellationToken::CancelledMessage;
+        return;
+    }
+
+#ifdef HAVE_BZIP2
+    // Worst case documented by libbz2: 1% larger plus 600 bytes
+    unsigned int outputSize = static_cast<unsigned int>(block.input.size() + block.input.size() / 100 + 600);
+    block.output.resize(outputSize);
+    int ret = BZ2_bzBuffToBuffCompress(reinterpret_cast<char *>(block.output.data()), &outputSize,
+                                       reinterpret_cast<char *>(block.input.data()),
+                                       static_cast<unsigned int>(block.input.size()), options.level, 0, 0);
+    if (ret != BZ_OK) {
+        block.error = ret == BZ_MEM_ERROR ? "No hay memoria suficiente para la compresión bzip2"
+                                          : "Error en la compresión bzip2 (código " + std::to_string(ret) + ")";
+        return;
+    }
+    block.output.resize(outputSize);
+
+    // One block means the stream CRC equals the block CRC; that and the
+    // magic pin down the end marker behind the 0-7 padding bits
+    uint64_t totalBits = static_cast<uint64_t>(outputSize) * 8;
+    if (totalBits < HeaderBits + 80 + TrailerBits || readBits(block.output, HeaderBits, 48) != BlockMagic) {
+        block.error = "Salida de bzip2 inesperada";
+        return;
+    }
+    block.crc = static_cast<uint32_t>(readBits(block.output, HeaderBits + 48, 32));
+    for (unsigned padding = 0; padding < 8; ++padding) {
+        uint64_t end = totalBits - TrailerBits - padding;
+        if (readBits(block.output, end, 48) == EndMagic && readBits(block.output, end + 48, 32) == block.crc) {
+            block.endBit = end;
+            block.ok = true;
+            return;
+        }
+    }
+    block.error = "Salida de bzip2 inesperada";
+#else
+    (void)options;
+    block.error = UnavailableMessage;
+#endif
+}
+
+// Fixed set of compression threads fed through a single queue
+class BlockWorkers
+{
+public:
+    BlockWorkers(unsigned count, const ParallelBzip2::Options &options)
+        : m_options(options)
+        , m_stop(false)
+    {
+        for (unsigned i = 0; i < count; ++i) {
+            m_threads.emplace_back([this]() { run(); });
+        }
+    }
+
+    ~BlockWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_workCondition.notify_all();
+        for (std::thread &thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    void submit(const std::shared_ptr<Block> &block)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(block);
+        }
+        m_workCondition.notify_one();
+    }
+
+    void waitFor(const std::shared_ptr<Block> &block)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_doneCondition.wait(lock, [&block]() { return block->done.load(); });
+    }
+
+private:
+    void run()
+    {
+        while (true) {
+            std::shared_ptr<Block> block;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_workCondition.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+                if (m_stop) {
+                    return;
+                }
+                block = m_queue.front();
+                m_queue.pop_front();
+            }
+
+            compressBlock(*block, m_options);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                block->done = true;
+            }
+            m_doneCondition.notify_all();
+        }
+    }
+
+    ParallelBzip2::Options m_options;
+    bool m_stop;
+    std::mutex m_mutex;
+    std::condition_variable m_workCondition;
+    std::condition_variable m_doneCondition;
+    std::deque<std::shared_ptr<Block>> m_queue;
+    std::vector<std::thread> m_threads;
+};
+
+} // namespace
+
+bool ParallelBzip2::available()
+{
+#ifdef HAVE_BZIP2
+    return true;
+#else
+    return false;
+#endif
+}
+
+ParallelBzip2::ParallelBzip2()
+    : ParallelBzip2(Options())
+{
+}
+
+ParallelBzip2::ParallelBzip2(const Options &options)
+    : m_options(options)
+    , m_totalIn(0)
+    , m_totalOut(0)
+    , m_crc(0)
+    , m_blocks(0)
+{
+    m_options.level = std::clamp(m_options.level, MinLevel, MaxLevel);
+    if (!available()) {
+        m_errorMessage = UnavailableMessage;
+    }
+}
+
+unsigned ParallelBzip2::threadCount() const
+{
+    if (m_options.threads > 0) {
+        return m_options.threads;
+    }
+    if (WorkStealingPool *pool = WorkStealingPool::current()) {
+        return pool->workerCount();
+    }
+    return CpuCount::available();
+}
+
+bool ParallelBzip2::compress(InputSource &input, const DeflateStream::Sink &sink,
+                             const DeflateStream::ProgressCallback &progress)
+{
+    m_totalIn = 0;
+    m_totalOut = 0;
+    m_crc = 0;
+    m_blocks = 0;
+    if (!available()) {
+        m_errorMessage = UnavailableMessage;
+        return false;
+    }
+
+    uint64_t totalBytes = input.knownSize();
+    BitWriter writer;
+
+    // Hands the finished bytes to the sink; a partial byte stays in the writer
+    auto flush = [&]() {
+        std::vector<unsigned char> &bytes = writer.bytes();
+        if (!bytes.empty() && !sink(bytes.data(), bytes.size())) {
+            m_errorMessage = "Error al escribir los datos comprimidos";
+            return false;
+        }
+        m_totalOut += bytes.size();
+        bytes.clear();
+        return true;
+    };
+
+    writer.put('B', 8);
+    writer.put('Z', 8);
+    writer.put('h', 8);
+    writer.put('0' + m_options.level, 8);
+
+    // Inside a batch the blocks become tasks on the batch's pool, where idle
+    // workers steal them; otherwise this call owns its threads
+    WorkStealingPool *pool = WorkStealingPool::current();
+    unsigned threads = threadCount();
+    const size_t maxInFlight = static_cast<size_t>(threads) * 2;
+    std::unique_ptr<BlockWorkers> workers;
+    if (!pool) {
+        workers = std::make_unique<BlockWorkers>(threads, m_options);
+    }
+    const Options options = m_options;
+
+    auto submit = [&](const std::shared_ptr<Block> &block) {
+        if (!pool) {
+            workers->submit(block);
+            return;
+        }
+        pool->spawn([block, options](unsigned) {
+            compressBlock(*block, options);
+            block->done = true;
+        });
+    };
+
+    auto waitFor = [&](const std::shared_ptr<Block> &block) {
+        if (!pool) {
+            workers->waitFor(block);
+            return;
+        }
+        pool->helpUntil([&block]() { return block->done.load(); });
+    };
+
+    std::deque<std::shared_ptr<Block>> pending;
+
+    // Splices the oldest block into the stream once it is compressed, keeping output in order
+    auto writeFront = [&]() {
+        std::shared_ptr<Block> block = pending.front();
+        pending.pop_front();
+        waitFor(block);
+
+        if (!block->ok) {
+            m_errorMessage = block->error.empty() ? "Error en la compresión bzip2" : block->error;
+            return false;
+        }
+        writer.append(block->output, HeaderBits, block->endBit);
+        if (!flush()) {
+            return false;
+        }
+
+        m_crc = ((m_crc << 1) | (m_crc >> 31)) ^ block->crc;
+        m_totalIn += block->input.size();
+        ++m_blocks;
+        if (progress) {
+            progress(m_totalIn, totalBytes);
+        }
+        return true;
+    };
+
+    const size_t capacity = blockCapacity(m_options.level);
+    const size_t maxInput = capacity * MaxInputFactor;
+    std::vector<unsigned char> readBuffer(InputSource::ReadBlockSize);
+    size_t readPosition = 0;
+    size_t readEnd = 0;
+    bool eof = false;
+
+    while (!eof) {
+        if (CancellationToken::cancelled(m_options.cancel)) {
+            m_errorMessage = CancellationToken::CancelledMessage;
+            return false;
+        }
+
+        // Fills one block; what does not fit stays in readBuffer for the next
+        auto block = std::make_shared<Block>();
+        BlockCutter cutter(capacity);
+        while (block->input.size() < maxInput) {
+            if (readPosition == readEnd) {
+                long long got = input.read(readBuffer.data(), readBuffer.size());
+                if (got < 0) {
+                    m_errorMessage = input.errorMessage();
+                    return false;
+                }
+                readPosition = 0;
+                readEnd = static_cast<size_t>(got);
+                if (got == 0) {
+                    eof = true;
+                    break;
+                }
+            }
+            size_t offered = std::min(readEnd - readPosition, maxInput - block->input.size());
+            size_t taken = cutter.take(readBuffer.data() + readPosition, offered);
+            block->input.insert(block->input.end(), readBuffer.begin() + readPosition,
+                                readBuffer.begin() + readPosition + taken);
+            readPosition += taken;
+            if (taken < offered) {
+                break;
+            }
+        }
+
+        if (!block->input.empty()) {
+            submit(block);
+            pending.push_back(block);
+        }
+
+        while (!pending.empty() && (eof || pending.size() >= maxInFlight)) {
+            if (!writeFront()) {
+                return false;
+            }
+        }
+    }
+
+    writer.put(EndMagic >> 24, 24);
+    writer.put(EndMagic & 0xffffff, 24);
+    writer.put(m_crc, 32);
+    writer.pad();
+    return flush();
+}
+
+bool ParallelBzip2::compressFile(const std::string &inputPath, const std::string &outputPath,
+                                 const DeflateStream::ProgressCallback &progress)
+{
+    if (!available()) {
+        m_errorMessage = UnavailableMessage;
+        return false;
+    }
+
+    InputSource inputFile;
+    if (!inputFile.open(inputPath)) {
+        m_errorMessage = inputFile.errorMessage();
+        return false;
+    }
+
+    std::ofstream outputFile(outputPath, std::ios::binary | std::ios::trunc);
+    if (!outputFile.is_open()) {
+        m_errorMessage = "No se pudo crear el archivo de salida";
+        return false;
+    }
+
+    DeflateStream::Sink sink = [&outputFile](const unsigned char *data, size_t size) {
+        outputFile.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(outputFile);
+    };
+
+    auto abandon = [&](const std::string &message) {
+        if (!message.empty()) {
+            m_errorMessage = message;
+        }
+        outputFile.close();
+        std::remove(outputPath.c_str());
+        return false;
+    };
+
+    if (!compress(inputFile, sink, progress)) {
+        return abandon(std::string());
+    }
+
+    outputFile.close();
+    if (!outputFile) {
+        return abandon("Error al escribir los datos comprimidos");
+    }
+    return true;
+}
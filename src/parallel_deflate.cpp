@@ -0,0 +1,401 @@
+#include "parallel_deflate.h"
+#include "cancellation_token.h"
+#include "cpu_count.h"
+#include "input_source.h"
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t WindowSize = 32 * 1024;
+constexpr size_t MaxBlockSize = 64 * 1024 * 1024;
+constexpr size_t BlockBufferSize = 64 * 1024;
+
+void appendLE32(std::vector<unsigned char> &out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<unsigned char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+std::vector<unsigned char> gzipHeader(int level)
+{
+    // ID1 ID2 CM FLG MTIME(4) XFL OS
+    unsigned char xfl = level >= Z_BEST_COMPRESSION ? 2 : (level == Z_BEST_SPEED ? 4 : 0);
+    return {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, xfl, 3};
+}
+
+std::vector<unsigned char> zlibHeader(int level)
+{
+    // CMF (deflate, 32 KiB window) and FLG with the FLEVEL hint and FCHECK
+    unsigned flevel = level == Z_DEFAULT_COMPRESSION ? 2 : (level < 2 ? 0 : (level < 6 ? 1 : (level == 6 ? 2 : 3)));
+    unsigned cmf = 0x78;
+    unsigned flg = flevel << 6;
+    flg += 31 - ((cmf * 256 + flg) % 31);
+    return {static_cast<unsigned char>(cmf), static_cast<unsigned char>(flg)};
+}
+
+struct Block
+{
+    std::vector<unsigned char> input;
+    std::vector<unsigned char> dictionary;
+    std::vector<unsigned char> output;
+    uint32_t crc = 0;
+    uint32_t adler = 0;
+    bool last = false;
+    std::atomic<bool> done{false};
+    bool ok = false;
+    std::string error;
+};
+
+void compressBlock(Block &block, const ParallelDeflate::Options &options)
+{
+    if (CancellationToken::cancelled(options.cancel)) {
+        // Queued blocks of a cancelled run are dropped without compressing
+        block.error = CancellationToken::CancelledMessage;
+        return;
+    }
+
+    uInt size = static_cast<uInt>(block.input.size());
+    block.crc = crc32(crc32(0L, Z_NULL, 0), block.input.data(), size);
+    block.adler = adler32(adler32(0L, Z_NULL, 0), block.input.data(), size);
+
+    DeflateStream::Sink sink = [&block](const unsigned char *data, size_t size) {
+        block.output.insert(block.output.end(), data, data + size);
+        return true;
+    };
+
+    if (options.independentBlocks) {
+        DeflateStream stream(DeflateStream::Format::Gzip, options.level, BlockBufferSize);
+        stream.setCancellationToken(options.cancel);
+        block.ok = stream.write(block.input.data(), block.input.size(), sink) && stream.finish(sink);
+        if (!block.ok) {
+            block.error = stream.errorMessage();
+        }
+        return;
+    }
+
+    // Sync flush ends the block on a byte boundary so blocks can be concatenated;
+    // only the last block carries the final-block bit
+    DeflateStream stream(DeflateStream::Format::Raw, options.level, BlockBufferSize);
+    stream.setCancellationToken(options.cancel);
+    block.ok = stream.setDictionary(block.dictionary.data(), block.dictionary.size())
+            && stream.write(block.input.data(), block.input.size(), sink)
+            && (block.last ? stream.finish(sink) : stream.flush(sink));
+    if (!block.ok) {
+        block.error = stream.errorMessage();
+    }
+}
+
+// Fixed set of compression threads fed through a single queue
+class BlockWorkers
+{
+public:
+    BlockWorkers(unsigned count, const ParallelDeflate::Options &options)
+        : m_options(options)
+        , m_stop(false)
+    {
+        for (unsigned i = 0; i < count; ++i) {
+            m_threads.emplace_back([this]() { run(); });
+        }
+    }
+
+    ~BlockWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_workCondition.notify_all();
+        for (std::thread &thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    void submit(const std::shared_ptr<Block> &block)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(block);
+        }
+        m_workCondition.notify_one();
+    }
+
+    void waitFor(const std::shared_ptr<Block> &block)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_doneCondition.wait(lock, [&block]() { return block->done.load(); });
+    }
+
+private:
+    void run()
+    {
+        while (true) {
+            std::shared_ptr<Block> block;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_workCondition.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+                if (m_stop) {
+                    return;
+                }
+                block = m_queue.front();
+                m_queue.pop_front();
+            }
+
+            compressBlock(*block, m_options);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                block->done = true;
+            }
+            m_doneCondition.notify_all();
+        }
+    }
+
+    ParallelDeflate::Options m_options;
+    bool m_stop;
+    std::mutex m_mutex;
+    std::condition_variable m_workCondition;
+    std::condition_variable m_doneCondition;
+    std::deque<std::shared_ptr<Block>> m_queue;
+    std::vector<std::thread> m_threads;
+};
+
+} // namespace
+
+ParallelDeflate::ParallelDeflate()
+    : ParallelDeflate(Options())
+{
+}
+
+ParallelDeflate::ParallelDeflate(const Options &options)
+    : m_options(options)
+    , m_totalIn(0)
+    , m_totalOut(0)
+    , m_crc(0)
+    , m_adler(0)
+{
+    m_options.blockSize = std::min(std::max(m_options.blockSize, WindowSize), MaxBlockSize);
+    m_options.independentBlocks = m_options.independentBlocks && m_options.format == DeflateStream::Format::Gzip;
+}
+
+unsigned ParallelDeflate::threadCount() const
+{
+    if (m_options.threads > 0) {
+        return m_options.threads;
+    }
+    if (WorkStealingPool *pool = WorkStealingPool::current()) {
+        return pool->workerCount();
+    }
+    return CpuCount::available();
+}
+
+uint64_t ParallelDeflate::memoryEstimate() const
+{
+    // Compressed blocks are assumed no larger than their input
+    uint64_t threads = threadCount();
+    uint64_t perBlock = 2 * static_cast<uint64_t>(m_options.blockSize) + WindowSize;
+    return threads * 2 * perBlock + threads * DeflateStream::memoryEstimate(BlockBufferSize);
+}
+
+bool ParallelDeflate::compress(InputSource &input, const DeflateStream::Sink &sink,
+                               const DeflateStream::ProgressCallback &progress)
+{
+    m_totalIn = 0;
+    m_totalOut = 0;
+    m_crc = crc32(0L, Z_NULL, 0);
+    m_adler = adler32(0L, Z_NULL, 0);
+    m_members.clear();
+
+    uint64_t totalBytes = input.knownSize();
+    uint64_t bytesRead = input.position();
+    const bool primed = !m_options.independentBlocks;
+
+    auto emit = [&](const std::vector<unsigned char> &bytes) {
+        if (!sink(bytes.data(), bytes.size())) {
+            m_errorMessage = "Error al escribir los datos comprimidos";
+            return false;
+        }
+        m_totalOut += bytes.size();
+        return true;
+    };
+
+    if (m_options.format == DeflateStream::Format::Zlib && !emit(zlibHeader(m_options.level))) {
+        return false;
+    }
+    if (m_options.format == DeflateStream::Format::Gzip && primed && !emit(gzipHeader(m_options.level))) {
+        return false;
+    }
+
+    // Inside a batch the blocks become tasks on the batch's pool, where idle
+    // workers steal them; otherwise this call owns its threads
+    WorkStealingPool *pool = WorkStealingPool::current();
+    unsigned threads = threadCount();
+    const size_t maxInFlight = static_cast<size_t>(threads) * 2;
+    std::unique_ptr<BlockWorkers> workers;
+    if (!pool) {
+        workers = std::make_unique<BlockWorkers>(threads, m_options);
+    }
+    const Options options = m_options;
+
+    auto submit = [&](const std::shared_ptr<Block> &block) {
+        if (!pool) {
+            workers->submit(block);
+            return;
+        }
+        pool->spawn([block, options](unsigned) {
+            compressBlock(*block, options);
+            block->done = true;
+        });
+    };
+
+    auto waitFor = [&](const std::shared_ptr<Block> &block) {
+        if (!pool) {
+            workers->waitFor(block);
+            return;
+        }
+        pool->helpUntil([&block]() { return block->done.load(); });
+    };
+
+    std::deque<std::shared_ptr<Block>> pending;
+    std::vector<unsigned char> window;
+    bool eof = false;
+
+    // Hands the oldest block to the sink once it is compressed, keeping output in order
+    auto writeFront = [&]() {
+        std::shared_ptr<Block> block = pending.front();
+        pending.pop_front();
+        waitFor(block);
+
+        if (!block->ok) {
+            m_errorMessage = block->error.empty() ? "Error en la compresión zlib" : block->error;
+            return false;
+        }
+        if (!block->output.empty() && !sink(block->output.data(), block->output.size())) {
+            m_errorMessage = "Error al escribir los datos comprimidos";
+            return false;
+        }
+
+        z_off_t length = static_cast<z_off_t>(block->input.size());
+        m_crc = crc32_combine(m_crc, block->crc, length);
+        m_adler = adler32_combine(m_adler, block->adler, length);
+        m_totalIn += block->input.size();
+        m_totalOut += block->output.size();
+        if (m_options.independentBlocks) {
+            m_members.push_back({block->output.size(), block->input.size()});
+        }
+        if (progress) {
+            progress(m_totalIn, totalBytes);
+        }
+        return true;
+    };
+
+    while (!eof) {
+        if (CancellationToken::cancelled(m_options.cancel)) {
+            m_errorMessage = CancellationToken::CancelledMessage;
+            return false;
+        }
+
+        auto block = std::make_shared<Block>();
+        block->input.resize(m_options.blockSize);
+        long long got = input.read(block->input.data(), block->input.size());
+        if (got < 0) {
+            m_errorMessage = input.errorMessage();
+            return false;
+        }
+        block->input.resize(static_cast<size_t>(got));
+
+        bytesRead += block->input.size();
+
+        // A short block marks the end. Pipes whose length is an exact multiple
+        // of the block size end with an empty final block instead.
+        eof = block->input.size() < m_options.blockSize || (totalBytes > 0 && bytesRead >= totalBytes);
+        block->last = eof;
+
+        if (primed) {
+            block->dictionary = window;
+            window.insert(window.end(), block->input.begin(), block->input.end());
+            if (window.size() > WindowSize) {
+                window.erase(window.begin(), window.end() - WindowSize);
+            }
+        }
+
+        submit(block);
+        pending.push_back(block);
+
+        while (!pending.empty() && (eof || pending.size() >= maxInFlight)) {
+            if (!writeFront()) {
+                return false;
+            }
+        }
+    }
+
+    std::vector<unsigned char> trailer;
+    if (m_options.format == DeflateStream::Format::Zlib) {
+        // Adler-32, big-endian
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            trailer.push_back(static_cast<unsigned char>((m_adler >> shift) & 0xff));
+        }
+    } else if (m_options.format == DeflateStream::Format::Gzip && primed) {
+        appendLE32(trailer, m_crc);
+        appendLE32(trailer, static_cast<uint32_t>(m_totalIn & 0xffffffffu));
+    }
+    return trailer.empty() || emit(trailer);
+}
+
+bool ParallelDeflate::compressFile(const std::string &inputPath, const std::string &outputPath,
+                                   const DeflateStream::ProgressCallback &progress,
+                                   const std::vector<unsigned char> &header)
+{
+    InputSource inputFile;
+    if (!inputFile.open(inputPath)) {
+        m_errorMessage = inputFile.errorMessage();
+        return false;
+    }
+
+    std::ofstream outputFile(outputPath, std::ios::binary | std::ios::trunc);
+    if (!outputFile.is_open()) {
+        m_errorMessage = "No se pudo crear el archivo de salida";
+        return false;
+    }
+
+    DeflateStream::Sink sink = [&outputFile](const unsigned char *data, size_t size) {
+        outputFile.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(outputFile);
+    };
+
+    // A failed or cancelled run leaves no partial output behind
+    auto abandon = [&](const std::string &message) {
+        if (!message.empty()) {
+            m_errorMessage = message;
+        }
+        outputFile.close();
+        std::remove(outputPath.c_str());
+        return false;
+    };
+
+    if (!header.empty() && !sink(header.data(), header.size())) {
+        return abandon("Error al escribir los datos comprimidos");
+    }
+
+    if (!compress(inputFile, sink, progress)) {
+        return abandon(std::string());
+    }
+    m_totalOut += header.size();
+
+    outputFile.close();
+    if (!outputFile) {
+        return abandon("Error al escribir los datos comprimidos");
+    }
+
+    return true;
+}
@@ -0,0 +1,43 @@
+#include "parallel_gzip.h"
+#include "parallel_deflate.h"
+
+ParallelGzipWriter::ParallelGzipWriter()
+    : ParallelGzipWriter(Options())
+{
+}
+
+ParallelGzipWriter::ParallelGzipWriter(const Options &options)
+    : m_options(options)
+    , m_totalIn(0)
+    , m_totalOut(0)
+    , m_crc(0)
+{
+}
+
+unsigned ParallelGzipWriter::threadCount() const
+{
+    ParallelDeflate::Options options;
+    options.threads = m_options.threads;
+    return ParallelDeflate(options).threadCount();
+}
+
+bool ParallelGzipWriter::compressFile(const std::string &inputPath, const std::string &outputPath,
+                                      const DeflateStream::ProgressCallback &progress)
+{
+    ParallelDeflate::Options options;
+    options.level = m_options.level;
+    options.blockSize = m_options.blockSize;
+    options.threads = m_options.threads;
+    options.format = DeflateStream::Format::Gzip;
+    options.independentBlocks = m_options.mode == Mode::IndependentMembers;
+    options.cancel = m_options.cancel;
+
+    ParallelDeflate deflater(options);
+    bool ok = deflater.compressFile(inputPath, outputPath, progress);
+
+    m_totalIn = deflater.totalIn();
+    m_totalOut = deflater.totalOut();
+    m_crc = deflater.crc();
+    m_errorMessage = deflater.errorMessage();
+    return ok;
+}
@@ -5,16 +5,101 @@
 #include <filesystem>
 #include <zlib.h>
 #include <iomanip>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "batch_pipeline.h"
+#include "brotli_stream.h"
+#include "cpu_count.h"
+#include "input_source.h"
+#include "lz4_stream.h"
+#include "memory_budget.h"
+#include "page_cache.h"
+#include "parallel_batch.h"
+#include "parallel_deflate.h"
+#include "seekable_gzip.h"
+#include "shard_queue.h"
+#include "staged_deflate.h"
+#include "zip_archive_builder.h"
+#include "zip_writer.h"
+#include "zstd_stream.h"
 
 namespace fs = std::filesystem;
 
+// Batch-wide figures for the summary
+struct BatchSummary
+{
+    std::string backendName;
+    std::string topology;       // CpuCount::summary()
+    unsigned workers = 0;
+    bool pinned = false;
+    uint64_t memoryLimit = 0;
+    uint64_t peakMemory = 0;
+};
+
+// Text, source code and web assets (the compressTextFile branch)
+bool isTextFile(const std::string &path)
+{
+    std::string extension = fs::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == ".txt" || extension == ".log" || extension == ".csv" ||
+           extension == ".json" || extension == ".xml" || extension == ".html" ||
+           extension == ".css" || extension == ".js" || extension == ".cpp" ||
+           extension == ".h" || extension == ".py" || extension == ".java" ||
+           extension == ".svg" || extension == ".mjs";
+}
+
+// Codec for a run: a zlib stream at level 9 unless zstd is chosen. brotli
+// takes over the text files (see isTextFile) for CDN-ready .br assets. lz4
+// replaces any of them for every file, or only for the extensions listed in
+// lz4Extensions (lower case, with the dot), e.g. for the artifacts compressed
+// on a latency-sensitive path. seekable writes .gz files with a block index
+// instead, for logs that are later read by byte range (--range).
+struct CodecOptions
+{
+    bool zstd = false;                  // .zst files and method 93 ZIP entries
+    ZstdStream::Options zstdOptions;
+    bool lz4 = false;                   // .lz4 frames; no ZIP method
+    Lz4Stream::Options lz4Options;
+    std::vector<std::string> lz4Extensions;
+    bool brotli = false;                // .br files for text; no ZIP method
+    BrotliStream::Options brotliOptions;
+    bool seekable = false;              // indexed .gz files; no other codec
+    SeekableGzipWriter::Options seekableOptions;
+
+    bool usesLz4(const std::string &path) const
+    {
+        if (!lz4 || lz4Extensions.empty()) {
+            return lz4;
+        }
+        std::string extension = fs::path(path).extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        return std::find(lz4Extensions.begin(), lz4Extensions.end(), extension) != lz4Extensions.end();
+    }
+
+    bool usesBrotli(const std::string &path) const
+    {
+        return brotli && !usesLz4(path) && isTextFile(path);
+    }
+};
+
 struct CompressionResult
 {
     bool success = false;
     std::string filename;
     std::string outputPath;
-    size_t originalSize = 0;
-    size_t compressedSize = 0;
+    uint64_t originalSize = 0;
+    uint64_t compressedSize = 0;
     double compressionRatio = 0.0;
     std::string errorMessage;
 };
@@ -22,21 +107,26 @@ struct CompressionResult
 class PureCppCompressor
 {
 public:
-    static CompressionResult compressFile(const std::string &inputPath, const std::string &outputPath)
+    static CompressionResult compressFile(const std::string &inputPath, const std::string &outputPath,
+                                          const CodecOptions &codec = CodecOptions())
     {
         CompressionResult result;
 
-        try {
-            fs::path inputFile(inputPath);
-            std::string extension = inputFile.extension().string();
-
-            // Convert to lowercase
-            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (codec.usesLz4(inputPath)) {
+            return compressLz4(inputPath, outputPath, codec.lz4Options);
+        }
+        if (codec.usesBrotli(inputPath)) {
+            return compressBrotli(inputPath, outputPath, codec.brotliOptions);
+        }
+        if (codec.zstd) {
+            return compressZstd(inputPath, outputPath, codec.zstdOptions);
+        }
+        if (codec.seekable) {
+            return compressSeekable(inputPath, outputPath, codec.seekableOptions);
+        }
 
-            if (extension == ".txt" || extension == ".log" || extension == ".csv" ||
-                extension == ".json" || extension == ".xml" || extension == ".html" ||
-                extension == ".css" || extension == ".js" || extension == ".cpp" ||
-                extension == ".h" || extension == ".py" || extension == ".java") {
+        try {
+            if (isTextFile(inputPath)) {
                 return compressTextFile(inputPath, outputPath);
             } else {
                 return compressBinaryFile(inputPath, outputPath);
@@ -48,52 +138,302 @@ public:
         }
     }
 
-private:
-    static CompressionResult compressTextFile(const std::string &inputPath, const std::string &outputPath)
+    // Batch mode: files run on a work-stealing pool, largest first. Small
+    // files go through a per-worker BatchPipeline in groups (reads, deflate
+    // and writes overlap, also from one file to the next); large ones are split into deflate blocks that idle workers
+    // steal. Output uses the same zlib format as compressFile. Each file is
+    // charged its estimated memory against maxMemory (0 = no limit) before
+    // it starts. The pool is sized from the CPUs the process may use
+    // (affinity, cgroup quota); pinWorkers binds each worker to one of them.
+    // With codec.zstd every file becomes a .zst stream on its worker instead,
+    // files picked by codec.usesLz4() an .lz4 frame and, with codec.brotli,
+    // text files a .br stream, so a directory of web assets is compressed
+    // one asset per CPU. codec.seekable spreads the blocks of each indexed
+    // .gz file over the idle workers like the large zlib files.
+    static std::vector<CompressionResult> compressFiles(const std::vector<std::string> &inputPaths,
+                                                        const std::string &outputDir,
+                                                        bool dropCache = false,
+                                                        uint64_t maxMemory = 0,
+                                                        bool pinWorkers = false,
+                                                        const CodecOptions &codec = CodecOptions(),
+                                                        BatchSummary *summary = nullptr)
+    {
+        std::vector<BatchPipeline::Job> jobs;
+        std::vector<uint64_t> sizes;
+        for (const std::string &inputPath : inputPaths) {
+            fs::path input(inputPath);
+            BatchPipeline::Job job;
+            job.inputPath = inputPath;
+            job.outputPath = outputPathFor(inputPath, outputDir, codec);
+            job.format = DeflateStream::Format::Zlib;
+            jobs.push_back(job);
+
+            std::error_code error;
+            uint64_t size = fs::file_size(input, error);
+            sizes.push_back(error ? 0 : size);
+        }
+
+        BatchPipeline::Options options;
+        options.dropCache = dropCache;
+
+        ParallelBatch batch(0, pinWorkers);
+        MemoryBudget budget(maxMemory);
+
+        // One pipeline (and I/O backend) per worker, created on first use
+        std::vector<std::unique_ptr<BatchPipeline>> pipelines(batch.workerCount());
+        pipelines[0] = std::make_unique<BatchPipeline>(options);
+
+        ParallelDeflate::Options deflateOptions;
+        deflateOptions.format = DeflateStream::Format::Zlib;
+
+        std::vector<CompressionResult> results(jobs.size());
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            results[i].filename = fs::path(jobs[i].inputPath).filename().string();
+            results[i].outputPath = jobs[i].outputPath;
+        }
+
+        auto pipelined = [&](size_t index) {
+            return !codec.usesLz4(jobs[index].inputPath) && !codec.usesBrotli(jobs[index].inputPath)
+                && !codec.zstd && !codec.seekable && (sizes[index] < ParallelBatch::SplitThreshold || dropCache);
+        };
+
+        // Pipelined files are handed out in groups, one group per run() of
+        // the worker's pipeline, so reads of the next file are in flight
+        // while the current one is compressed. Dealing them out largest
+        // first keeps the groups about the same size; every other file is
+        // a work item of its own.
+        std::vector<std::vector<size_t>> items;
+        std::vector<size_t> pipelineFiles;
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            if (pipelined(i)) {
+                pipelineFiles.push_back(i);
+            } else {
+                items.push_back({i});
+            }
+        }
+        if (!pipelineFiles.empty()) {
+            std::stable_sort(pipelineFiles.begin(), pipelineFiles.end(),
+                             [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+            size_t groupCount = std::min<size_t>(pipelineFiles.size(), 2 * static_cast<size_t>(batch.workerCount()));
+            std::vector<std::vector<size_t>> groups(groupCount);
+            for (size_t i = 0; i < pipelineFiles.size(); ++i) {
+                groups[i % groupCount].push_back(pipelineFiles[i]);
+            }
+            for (std::vector<size_t> &group : groups) {
+                // Input order within a group, as the files were named
+                std::sort(group.begin(), group.end());
+                items.push_back(std::move(group));
+            }
+        }
+        std::vector<uint64_t> itemSizes;
+        for (const std::vector<size_t> &item : items) {
+            uint64_t size = 0;
+            for (size_t index : item) {
+                size += sizes[index];
+            }
+            itemSizes.push_back(size);
+        }
+
+        batch.run(items.size(), [&](size_t item, unsigned worker) {
+            const std::vector<size_t> &files = items[item];
+            if (pipelined(files.front())) {
+                std::vector<BatchPipeline::Job> group;
+                for (size_t index : files) {
+                    group.push_back(jobs[index]);
+                }
+                MemoryBudget::Reservation reservation(budget, BatchPipeline::memoryEstimate(options));
+                if (!pipelines[worker]) {
+                    pipelines[worker] = std::make_unique<BatchPipeline>(options);
+                }
+                pipelines[worker]->run(group, [&](size_t position, const BatchPipeline::JobResult &jobResult) {
+                    CompressionResult &result = results[files[position]];
+                    result.success = jobResult.success;
+                    result.originalSize = jobResult.bytesIn;
+                    result.compressedSize = jobResult.bytesOut;
+                    result.errorMessage = jobResult.errorMessage;
+                    result.compressionRatio = compressionRatio(result.originalSize, result.compressedSize);
+                });
+                return;
+            }
+
+            size_t index = files.front();
+            const BatchPipeline::Job &job = jobs[index];
+            CompressionResult &result = results[index];
+
+            // --drop-cache keeps every zlib file on the pipeline, which drops
+            // each chunk; the other codecs drop their files once written
+            if (codec.usesLz4(job.inputPath)) {
+                MemoryBudget::Reservation reservation(budget, Lz4Stream::memoryEstimate(codec.lz4Options));
+                Lz4Stream stream(codec.lz4Options);
+                result.success = stream.compressFile(job.inputPath, job.outputPath);
+                result.originalSize = stream.totalIn();
+                result.compressedSize = stream.totalOut();
+                result.errorMessage = stream.errorMessage();
+            } else if (codec.usesBrotli(job.inputPath)) {
+                MemoryBudget::Reservation reservation(budget, BrotliStream::memoryEstimate(codec.brotliOptions));
+                BrotliStream stream(codec.brotliOptions);
+                result.success = stream.compressFile(job.inputPath, job.outputPath);
+                result.originalSize = stream.totalIn();
+                result.compressedSize = stream.totalOut();
+                result.errorMessage = stream.errorMessage();
+            } else if (codec.zstd) {
+                MemoryBudget::Reservation reservation(budget, ZstdStream::memoryEstimate(codec.zstdOptions));
+                ZstdStream stream(codec.zstdOptions);
+                result.success = stream.compressFile(job.inputPath, job.outputPath);
+                result.originalSize = stream.totalIn();
+                result.compressedSize = stream.totalOut();
+                result.errorMessage = stream.errorMessage();
+            } else if (codec.seekable) {
+                SeekableGzipWriter writer(codec.seekableOptions);
+                MemoryBudget::Reservation reservation(budget, writer.memoryEstimate());
+                result.success = writer.compressFile(job.inputPath, job.outputPath);
+                result.originalSize = writer.totalIn();
+                result.compressedSize = writer.totalOut();
+                result.errorMessage = writer.errorMessage();
+            } else {
+                ParallelDeflate deflater(deflateOptions);
+                MemoryBudget::Reservation reservation(budget, deflater.memoryEstimate());
+                result.success = deflater.compressFile(job.inputPath, job.outputPath);
+                result.originalSize = deflater.totalIn();
+                result.compressedSize = deflater.totalOut();
+                result.errorMessage = deflater.errorMessage();
+            }
+            if (dropCache) {
+                dropFileCache(job.inputPath, job.outputPath);
+            }
+            result.compressionRatio = compressionRatio(result.originalSize, result.compressedSize);
+        }, itemSizes);
+
+        if (summary) {
+            summary->backendName = pipelines[0]->backendName();
+            summary->topology = CpuCount::summary();
+            summary->workers = batch.workerCount();
+            summary->pinned = pinWorkers;
+            summary->memoryLimit = budget.limit();
+            summary->peakMemory = budget.peak();
+        }
+
+        return results;
+    }
+
+    // One ZIP archive for every input, built by ZipArchiveBuilder. Directories
+    // are added recursively with paths relative to their parent. Entries that
+    // cannot be read are left out and listed in failures.
+    static CompressionResult compressToArchive(const std::vector<std::string> &inputPaths,
+                                               const std::string &outputPath,
+                                               std::vector<CompressionResult> *failures = nullptr,
+                                               const CodecOptions &codec = CodecOptions())
     {
         CompressionResult result;
+        result.filename = fs::path(outputPath).filename().string();
+        result.outputPath = outputPath;
 
         try {
-            std::ifstream inputFile(inputPath, std::ios::binary);
-            if (!inputFile.is_open()) {
-                result.success = false;
-                result.errorMessage = "No se pudo abrir el archivo de entrada";
+            std::vector<ZipArchiveBuilder::Entry> entries = ZipArchiveBuilder::collectEntries(inputPaths, outputPath);
+
+            ZipArchiveBuilder::Options options;
+            options.zstd = codec.zstd;
+            options.zstdOptions = codec.zstdOptions;
+            ZipArchiveBuilder builder(options);
+            if (!builder.build(outputPath, entries)) {
+                result.errorMessage = builder.errorMessage();
                 return result;
             }
 
-            // Read file content
-            std::string content((std::istreambuf_iterator<char>(inputFile)),
-                               std::istreambuf_iterator<char>());
-            inputFile.close();
+            for (size_t i = 0; i < entries.size() && failures; ++i) {
+                const ZipArchiveBuilder::EntryResult &entryResult = builder.results()[i];
+                if (!entryResult.success) {
+                    CompressionResult failure;
+                    failure.filename = entries[i].name;
+                    failure.errorMessage = entryResult.errorMessage;
+                    failures->push_back(failure);
+                }
+            }
 
-            // Compress using zlib
-            std::vector<unsigned char> compressed;
-            uLong compressedSize = compressBound(content.size());
-            compressed.resize(compressedSize);
+            result.success = true;
+            result.originalSize = builder.totalIn();
+            result.compressedSize = builder.archiveSize();
+            result.compressionRatio = compressionRatio(result.originalSize, result.compressedSize);
+        } catch (const std::exception &e) {
+            result.success = false;
+            result.errorMessage = std::string("Error: ") + e.what();
+        }
+
+        return result;
+    }
+
+    // Single-entry ZIP archive; ZIP64 headers are used for inputs near or
+    // above 4 GiB. codec.zstd stores a Zstandard frame (method 93).
+    static CompressionResult compressToZip(const std::string &inputPath, const std::string &outputPath,
+                                           const CodecOptions &codec = CodecOptions())
+    {
+        CompressionResult result;
 
-            if (compress2(compressed.data(), &compressedSize,
-                         reinterpret_cast<const unsigned char*>(content.data()),
-                         content.size(), Z_BEST_COMPRESSION) != Z_OK) {
+        try {
+            ZipWriter zip;
+            if (!zip.open(outputPath)) {
                 result.success = false;
-                result.errorMessage = "Error en la compresión zlib";
+                result.errorMessage = zip.errorMessage();
                 return result;
             }
 
-            // Write compressed data
-            std::ofstream outputFile(outputPath, std::ios::binary);
-            if (!outputFile.is_open()) {
+            InputSource content;
+            if (!content.open(inputPath)) {
+                zip.discard();
                 result.success = false;
-                result.errorMessage = "No se pudo crear el archivo de salida";
+                result.errorMessage = content.errorMessage();
                 return result;
             }
 
-            outputFile.write(reinterpret_cast<const char*>(compressed.data()), compressedSize);
-            outputFile.close();
+            time_t modificationTime = 0;
+            struct stat info;
+            if (fstat(content.fileDescriptor(), &info) == 0) {
+                modificationTime = info.st_mtime;
+            }
+
+            DeflateStream::Sink sink = [&zip](const unsigned char *data, size_t size) {
+                return zip.writeEntryData(data, size);
+            };
+            uint16_t method = codec.zstd ? ZipWriter::MethodZstd : ZipWriter::MethodDeflate;
+            bool ok = zip.beginEntry(fs::path(inputPath).filename().string(), method, modificationTime,
+                                     content.knownSize());
+
+            uint64_t totalIn = 0;
+            std::string codecError;
+            if (ok && codec.zstd) {
+                ZstdStream stream(codec.zstdOptions);
+                stream.setExpectedSize(content.knownSize());
+                std::vector<unsigned char> buffer(InputSource::ReadBlockSize);
+                long long got = 0;
+                while (ok && (got = content.read(buffer.data(), buffer.size())) > 0) {
+                    ok = stream.write(buffer.data(), static_cast<size_t>(got), sink);
+                }
+                ok = ok && got == 0 && stream.finish(sink) && zip.endEntry(stream.crc(), stream.totalIn());
+                totalIn = stream.totalIn();
+                codecError = stream.errorMessage();
+            } else if (ok) {
+                // Blocks are deflated on every core and joined into one raw stream
+                ParallelDeflate deflater;
+                ok = deflater.compress(content, sink) && zip.endEntry(deflater.crc(), deflater.totalIn());
+                totalIn = deflater.totalIn();
+                codecError = deflater.errorMessage();
+            }
+            ok = ok && zip.close();
+
+            if (!ok) {
+                std::string message = !zip.errorMessage().empty() ? zip.errorMessage()
+                                    : !codecError.empty() ? codecError
+                                    : content.errorMessage();
+                zip.discard();
+                result.success = false;
+                result.errorMessage = message.empty() ? "Error en la compresión" : message;
+                return result;
+            }
 
             result.success = true;
-            result.originalSize = content.size();
-            result.compressedSize = compressedSize;
-            result.compressionRatio = ((double)(result.originalSize - result.compressedSize) / result.originalSize) * 100.0;
+            result.originalSize = totalIn;
+            result.compressedSize = zip.bytesWritten();
+            result.compressionRatio = compressionRatio(result.originalSize, result.compressedSize);
             result.outputPath = outputPath;
 
         } catch (const std::exception &e) {
@@ -104,50 +444,80 @@ private:
         return result;
     }
 
-    static CompressionResult compressBinaryFile(const std::string &inputPath, const std::string &outputPath)
+    // name_compressed.ext for the zlib stream, name.ext.zst for zstd,
+    // name.ext.lz4 for lz4, name.ext.br for brotli and name.ext.gz for the
+    // seekable gzip
+    static std::string outputPathFor(const std::string &inputPath, const std::string &outputDir,
+                                     const CodecOptions &codec)
     {
-        CompressionResult result;
+        fs::path input(inputPath);
+        std::string name = codec.usesLz4(inputPath) ? input.filename().string() + ".lz4"
+                         : codec.usesBrotli(inputPath) ? input.filename().string() + ".br"
+                         : codec.zstd ? input.filename().string() + ".zst"
+                         : codec.seekable ? input.filename().string() + ".gz"
+                         : input.stem().string() + "_compressed" + input.extension().string();
+        return (fs::path(outputDir) / name).string();
+    }
 
-        try {
-            std::ifstream inputFile(inputPath, std::ios::binary);
-            if (!inputFile.is_open()) {
-                result.success = false;
-                result.errorMessage = "No se pudo abrir el archivo de entrada";
-                return result;
+private:
+    // Evicts a finished job's input and output from the page cache, for the
+    // codecs that do not run on BatchPipeline
+    static void dropFileCache(const std::string &inputPath, const std::string &outputPath)
+    {
+        struct stat info;
+        int inputFd = ::open(inputPath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (inputFd >= 0) {
+            if (fstat(inputFd, &info) == 0 && S_ISREG(info.st_mode)) {
+                PageCache::dropInput(inputFd, 0, static_cast<uint64_t>(info.st_size));
+            }
+            ::close(inputFd);
+        }
+        int outputFd = ::open(outputPath.c_str(), O_WRONLY | O_CLOEXEC);
+        if (outputFd >= 0) {
+            if (fstat(outputFd, &info) == 0) {
+                PageCache::dropOutput(outputFd, 0, static_cast<uint64_t>(info.st_size));
             }
+            ::close(outputFd);
+        }
+    }
 
-            // Read file content
-            std::vector<unsigned char> content((std::istreambuf_iterator<char>(inputFile)),
-                                              std::istreambuf_iterator<char>());
-            inputFile.close();
+    // Space saved in percent; negative when the output grew, 0 for empty inputs
+    static double compressionRatio(uint64_t originalSize, uint64_t compressedSize)
+    {
+        if (originalSize == 0) {
+            return 0.0;
+        }
+        return (static_cast<double>(originalSize) - static_cast<double>(compressedSize)) / originalSize * 100.0;
+    }
 
-            // Compress using zlib
-            std::vector<unsigned char> compressed;
-            uLong compressedSize = compressBound(content.size());
-            compressed.resize(compressedSize);
+    static CompressionResult compressTextFile(const std::string &inputPath, const std::string &outputPath)
+    {
+        return compressStream(inputPath, outputPath);
+    }
 
-            if (compress2(compressed.data(), &compressedSize,
-                         content.data(), content.size(), Z_BEST_COMPRESSION) != Z_OK) {
-                result.success = false;
-                result.errorMessage = "Error en la compresión zlib";
-                return result;
-            }
+    static CompressionResult compressBinaryFile(const std::string &inputPath, const std::string &outputPath)
+    {
+        return compressStream(inputPath, outputPath);
+    }
+
+    // Chunked zlib stream, so inputs of any size run in constant memory. Reads
+    // and writes run on their own threads, overlapped with deflate.
+    static CompressionResult compressStream(const std::string &inputPath, const std::string &outputPath)
+    {
+        CompressionResult result;
 
-            // Write compressed data
-            std::ofstream outputFile(outputPath, std::ios::binary);
-            if (!outputFile.is_open()) {
+        try {
+            StagedDeflate stream;
+            if (!stream.compressFile(inputPath, outputPath)) {
                 result.success = false;
-                result.errorMessage = "No se pudo crear el archivo de salida";
+                result.errorMessage = stream.errorMessage();
                 return result;
             }
 
-            outputFile.write(reinterpret_cast<const char*>(compressed.data()), compressedSize);
-            outputFile.close();
-
             result.success = true;
-            result.originalSize = content.size();
-            result.compressedSize = compressedSize;
-            result.compressionRatio = ((double)(result.originalSize - result.compressedSize) / result.originalSize) * 100.0;
+            result.originalSize = stream.totalIn();
+            result.compressedSize = stream.totalOut();
+            result.compressionRatio = compressionRatio(result.originalSize, result.compressedSize);
             result.outputPath = outputPath;
 
         } catch (const std::exception &e) {
@@ -157,28 +527,282 @@ private:
 
         return result;
     }
+
+    static CompressionResult compressZstd(const std::string &inputPath, const std::string &outputPath,
+                                          const ZstdStream::Options &options)
+    {
+        CompressionResult result;
+
+        ZstdStream stream(options);
+        if (!stream.compressFile(inputPath, outputPath)) {
+            result.success = false;
+            result.errorMessage = stream.errorMessage();
+            return result;
+        }
+
+        result.success = true;
+        result.originalSize = stream.totalIn();
+        result.compressedSize = stream.totalOut();
+        result.compressionRatio = compressionRatio(result.originalSize, result.compressedSize);
+        result.outputPath = outputPath;
+        return result;
+    }
+
+    static CompressionResult compressSeekable(const std::string &inputPath, const std::string &outputPath,
+                                              const SeekableGzipWriter::Options &options)
+    {
+        CompressionResult result;
+
+        SeekableGzipWriter writer(options);
+        if (!writer.compressFile(inputPath, outputPath)) {
+            result.success = false;
+            result.errorMessage = writer.errorMessage();
+            return result;
+        }
+
+        result.success = true;
+        result.originalSize = writer.totalIn();
+        result.compressedSize = writer.totalOut();
+        result.compressionRatio = compressionRatio(result.originalSize, result.compressedSize);
+        result.outputPath = outputPath;
+        return result;
+    }
+
+    static CompressionResult compressBrotli(const std::string &inputPath, const std::string &outputPath,
+                                            const BrotliStream::Options &options)
+    {
+        CompressionResult result;
+
+        BrotliStream stream(options);
+        if (!stream.compressFile(inputPath, outputPath)) {
+            result.success = false;
+            result.errorMessage = stream.errorMessage();
+            return result;
+        }
+
+        result.success = true;
+        result.originalSize = stream.totalIn();
+        result.compressedSize = stream.totalOut();
+        result.compressionRatio = compressionRatio(result.originalSize, result.compressedSize);
+        result.outputPath = outputPath;
+        return result;
+    }
+
+    static CompressionResult compressLz4(const std::string &inputPath, const std::string &outputPath,
+                                         const Lz4Stream::Options &options)
+    {
+        CompressionResult result;
+
+        Lz4Stream stream(options);
+        if (!stream.compressFile(inputPath, outputPath)) {
+            result.success = false;
+            result.errorMessage = stream.errorMessage();
+            return result;
+        }
+
+        result.success = true;
+        result.originalSize = stream.totalIn();
+        result.compressedSize = stream.totalOut();
+        result.compressionRatio = compressionRatio(result.originalSize, result.compressedSize);
+        result.outputPath = outputPath;
+        return result;
+    }
 };
 
 void printUsage(const char* programName)
 {
     std::cout << "🚀 Compresor de Archivos - Versión C++ Pura" << std::endl;
     std::cout << "=============================================" << std::endl;
-    std::cout << "Uso: " << programName << " <archivo_a_comprimir>" << std::endl;
+    std::cout << "Uso: " << programName << " [--drop-cache] [--max-memory <tamaño>] [--pin] [--zstd [--zstd-level <1-22>] [--zstd-threads <n>] [--long]] [--lz4 | --lz4hc [--lz4-level <n>] [--lz4-types <ext,...>]] [--brotli [--brotli-quality <0-11>] [--brotli-window <10-24>]] [--seekable [--seekable-block <tamaño>]] [--zip | --archive <nombre.zip>] <archivo_a_comprimir> [más archivos...]" << std::endl;
+    std::cout << "     " << programName << " --coordinate <carpeta> [--shard-size <n>] [--lease <segundos>] [--manifest <lista>] [archivos...]" << std::endl;
+    std::cout << "     " << programName << " --worker <carpeta> [--lease <segundos>] [--zstd ... | --lz4 ... | --brotli ...]" << std::endl;
+    std::cout << "     " << programName << " --range <inicio>:<longitud> <archivo.gz>" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Opciones:" << std::endl;
+    std::cout << "  --drop-cache   No dejar los archivos leídos ni escritos en la caché de páginas" << std::endl;
+    std::cout << "  --max-memory   Memoria máxima para los archivos en curso (p. ej. 4G, 512M)" << std::endl;
+    std::cout << "  --pin          Fijar cada hilo a una CPU (agrupadas por nodo NUMA)" << std::endl;
+    std::cout << "  --zstd         Comprimir con Zstandard (.zst; entradas ZIP con método 93)" << std::endl;
+    std::cout << "  --zstd-level   Nivel de zstd, de 1 a 22 (por defecto " << ZstdStream::DefaultLevel << ")" << std::endl;
+    std::cout << "  --zstd-threads Hilos de zstd para cada archivo (por defecto ninguno aparte)" << std::endl;
+    std::cout << "  --long         Búsqueda de coincidencias lejanas (ventana de 128 MiB, para logs grandes)" << std::endl;
+    std::cout << "  --lz4          Comprimir con LZ4 (.lz4), mucho más rápido que zlib con menos compresión" << std::endl;
+    std::cout << "  --lz4hc        Comprimir con LZ4-HC (nivel " << Lz4Stream::HcDefaultLevel << "), más lento que --lz4 y más compacto" << std::endl;
+    std::cout << "  --lz4-level    Nivel de lz4: " << Lz4Stream::FastLevel << " rápido, negativo aún más rápido, "
+              << Lz4Stream::HcMinLevel << "-" << Lz4Stream::MaxLevel << " LZ4-HC" << std::endl;
+    std::cout << "  --lz4-types    Usar lz4 solo con estas extensiones (p. ej. log,json); el resto usa zlib o zstd" << std::endl;
+    std::cout << "  --brotli       Comprimir texto y recursos web (.html, .css, .js, .json, .svg...) con Brotli (.br)" << std::endl;
+    std::cout << "  --brotli-quality Calidad de brotli, de 0 a 11 (por defecto " << BrotliStream::Options().quality << ")" << std::endl;
+    std::cout << "  --brotli-window  Ventana de brotli en bits, de 10 a 24 (por defecto " << BrotliStream::Options().windowBits << ")" << std::endl;
+    std::cout << "  --seekable     Crear .gz con bloques independientes e índice, para leer rangos sin descomprimir todo" << std::endl;
+    std::cout << "  --seekable-block Tamaño de bloque de --seekable (por defecto 1M; menor = lecturas más baratas)" << std::endl;
+    std::cout << "  --range        Escribir en la salida estándar ese rango (p. ej. 2G:1M) de un .gz creado con --seekable" << std::endl;
+    std::cout << "  --zip          Crear un archivo .zip por entrada (ZIP64 para más de 4 GiB)" << std::endl;
+    std::cout << "  --archive      Guardar todas las entradas (y carpetas) en un solo archivo .zip" << std::endl;
+    std::cout << "  --coordinate   Repartir los archivos en fragmentos dentro de una carpeta compartida y esperar a los trabajadores" << std::endl;
+    std::cout << "  --worker       Tomar fragmentos de esa carpeta y comprimirlos (varios procesos o equipos a la vez)" << std::endl;
+    std::cout << "  --manifest     Lista de archivos a comprimir, uno por línea" << std::endl;
+    std::cout << "  --shard-size   Archivos por fragmento (por defecto 1000)" << std::endl;
+    std::cout << "  --lease        Segundos sin señal tras los que un fragmento se reasigna (por defecto 300)" << std::endl;
     std::cout << std::endl;
     std::cout << "Ejemplos:" << std::endl;
     std::cout << "  " << programName << " test.txt" << std::endl;
     std::cout << "  " << programName << " document.pdf" << std::endl;
     std::cout << "  " << programName << " image.jpg" << std::endl;
+    std::cout << "  " << programName << " logs/*.log    (modo por lotes)" << std::endl;
+    std::cout << "  " << programName << " --drop-cache /var/log/archive/*.log" << std::endl;
+    std::cout << "  " << programName << " --max-memory 4G datos/*" << std::endl;
+    std::cout << "  " << programName << " --pin logs/*.log" << std::endl;
+    std::cout << "  " << programName << " --zstd --zstd-level 19 --zstd-threads 8 --long registro.log" << std::endl;
+    std::cout << "  " << programName << " --lz4 --lz4-types bin,dat artefactos/*" << std::endl;
+    std::cout << "  " << programName << " --brotli sitio/*.html sitio/*.css sitio/*.js" << std::endl;
+    std::cout << "  " << programName << " --seekable registro.log" << std::endl;
+    std::cout << "  " << programName << " --range 1G:64K output/registro.log.gz > trozo.log" << std::endl;
+    std::cout << "  " << programName << " --archive proyecto.zip src/ docs/" << std::endl;
+    std::cout << "  " << programName << " --coordinate /mnt/nfs/trabajo --manifest archivos.txt" << std::endl;
+    std::cout << "  " << programName << " --worker /mnt/nfs/trabajo    (en cada proceso o equipo)" << std::endl;
 }
 
-int main(int argc, char *argv[])
+// "zlib nivel 9", e.g. "zstd nivel 19, 4 hilos, ventana larga", or with lz4
+// and brotli e.g. "lz4 rápido (.bin); resto: brotli calidad 11, ventana de
+// 22 bits (texto) y zlib nivel 9"
+std::string codecSummary(const CodecOptions &codec)
 {
-    if (argc < 2) {
-        printUsage(argv[0]);
+    if (codec.lz4) {
+        int level = std::clamp(codec.lz4Options.level, Lz4Stream::FastestLevel, Lz4Stream::MaxLevel);
+        std::string summary = level >= Lz4Stream::HcMinLevel ? "lz4-hc nivel " + std::to_string(level)
+                            : level < Lz4Stream::FastLevel ? "lz4 aceleración " + std::to_string(-level)
+                            : "lz4 rápido";
+        if (codec.lz4Extensions.empty()) {
+            return summary;
+        }
+        for (size_t i = 0; i < codec.lz4Extensions.size(); ++i) {
+            summary += (i == 0 ? " (" : ", ") + codec.lz4Extensions[i];
+        }
+        CodecOptions rest = codec;
+        rest.lz4 = false;
+        return summary + "); resto: " + codecSummary(rest);
+    }
+    if (codec.brotli) {
+        CodecOptions rest = codec;
+        rest.brotli = false;
+        return "brotli calidad "
+               + std::to_string(std::clamp(codec.brotliOptions.quality, BrotliStream::MinQuality,
+                                           BrotliStream::MaxQuality))
+               + ", ventana de "
+               + std::to_string(std::clamp(codec.brotliOptions.windowBits, BrotliStream::MinWindowBits,
+                                           BrotliStream::MaxWindowBits))
+               + " bits (texto) y " + codecSummary(rest);
+    }
+    if (codec.seekable) {
+        return "gzip con índice, bloques de " + std::to_string(codec.seekableOptions.blockSize / 1024) + " KiB";
+    }
+    if (!codec.zstd) {
+        return "zlib nivel 9";
+    }
+    std::string summary = "zstd nivel " + std::to_string(std::clamp(codec.zstdOptions.level, ZstdStream::MinLevel,
+                                                                    ZstdStream::MaxLevel));
+    if (codec.zstdOptions.workers > 0) {
+        summary += ", " + std::to_string(codec.zstdOptions.workers) + " hilos";
+    }
+    if (codec.zstdOptions.longDistance) {
+        summary += ", ventana larga";
+    }
+    return summary;
+}
+
+int runBatch(const std::vector<std::string> &inputFiles, const fs::path &outputDir, bool dropCache, uint64_t maxMemory,
+             bool pinWorkers, const CodecOptions &codec)
+{
+    std::vector<std::string> existing;
+    for (const std::string &inputFile : inputFiles) {
+        if (fs::exists(inputFile)) {
+            existing.push_back(inputFile);
+        } else {
+            std::cout << "⚠️  El archivo no existe, se omitirá: " << inputFile << std::endl;
+        }
+    }
+
+    BatchSummary summary;
+    std::cout << "🔨 Comprimiendo " << existing.size() << " archivos..." << std::endl;
+    std::vector<CompressionResult> results = PureCppCompressor::compressFiles(existing, outputDir.string(), dropCache,
+                                                                              maxMemory, pinWorkers, codec, &summary);
+
+    size_t successful = 0;
+    uint64_t totalOriginal = 0;
+    uint64_t totalCompressed = 0;
+    for (const CompressionResult &result : results) {
+        if (result.success) {
+            ++successful;
+            totalOriginal += result.originalSize;
+            totalCompressed += result.compressedSize;
+            std::cout << "✅ " << result.filename << ": " << result.originalSize << " -> " << result.compressedSize
+                      << " bytes (" << std::fixed << std::setprecision(2) << result.compressionRatio << "%)" << std::endl;
+        } else {
+            std::cout << "❌ " << result.filename << ": " << result.errorMessage << std::endl;
+        }
+    }
+
+    std::cout << "📊 Archivos comprimidos: " << successful << "/" << results.size() << std::endl;
+    std::cout << "📊 Total: " << totalOriginal << " -> " << totalCompressed << " bytes" << std::endl;
+    std::cout << "⚙️  Códec: " << codecSummary(codec) << std::endl;
+    std::cout << "⚙️  E/S asíncrona: " << summary.backendName << std::endl;
+    std::cout << "⚙️  CPU: " << summary.topology << std::endl;
+    std::cout << "⚙️  Hilos: " << summary.workers << (summary.pinned ? " (fijados a CPUs)" : "") << std::endl;
+    std::cout << "🧠 Memoria máxima: " << std::fixed << std::setprecision(1) << summary.peakMemory / (1024.0 * 1024.0) << " MB";
+    if (summary.memoryLimit > 0) {
+        std::cout << " de " << summary.memoryLimit / (1024.0 * 1024.0) << " MB";
+    } else {
+        std::cout << " (sin límite)";
+    }
+    std::cout << std::endl;
+    if (dropCache) {
+        // zstd, lz4, brotli and indexed gzip drop the cache per file, not per chunk
+        bool perFile = codec.zstd || codec.lz4 || codec.brotli || codec.seekable;
+        std::cout << "⚙️  Caché de páginas: liberada tras cada " << (perFile ? "archivo" : "bloque") << std::endl;
+    }
+    std::cout << "📁 Archivos guardados en: " << outputDir.string() << std::endl;
+
+    return successful == results.size() ? 0 : 1;
+}
+
+int runArchive(const std::vector<std::string> &inputFiles, const fs::path &outputDir, const std::string &archiveName,
+               const CodecOptions &codec)
+{
+    std::vector<std::string> existing;
+    for (const std::string &inputFile : inputFiles) {
+        if (fs::exists(inputFile)) {
+            existing.push_back(inputFile);
+        } else {
+            std::cout << "⚠️  El archivo no existe, se omitirá: " << inputFile << std::endl;
+        }
+    }
+
+    std::string outputFile = (outputDir / fs::path(archiveName).filename()).string();
+    std::cout << "📁 Archivo de salida: " << outputFile << std::endl;
+    std::cout << "🔨 Comprimiendo en un solo archivo ZIP..." << std::endl;
+
+    std::vector<CompressionResult> failures;
+    CompressionResult result = PureCppCompressor::compressToArchive(existing, outputFile, &failures, codec);
+    if (!result.success) {
+        std::cout << "❌ Error en la compresión: " << result.errorMessage << std::endl;
         return 1;
     }
 
-    std::string inputFile = argv[1];
+    for (const CompressionResult &failure : failures) {
+        std::cout << "❌ " << failure.filename << ": " << failure.errorMessage << std::endl;
+    }
+    std::cout << "✅ Compresión exitosa!" << std::endl;
+    std::cout << "📊 Tamaño original: " << result.originalSize << " bytes" << std::endl;
+    std::cout << "📊 Tamaño del archivo ZIP: " << result.compressedSize << " bytes" << std::endl;
+    std::cout << "📈 Ratio de compresión: " << std::fixed << std::setprecision(2) << result.compressionRatio << "%" << std::endl;
+    std::cout << "📁 Archivo guardado en: " << result.outputPath << std::endl;
+
+    return failures.empty() ? 0 : 1;
+}
+
+int runSingle(const std::string &inputFile, const fs::path &outputDir, bool zip, const CodecOptions &codec)
+{
     fs::path inputPath(inputFile);
 
     if (!fs::exists(inputPath)) {
@@ -186,19 +810,18 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    // Create output directory
-    fs::path outputDir("output");
-    if (!fs::exists(outputDir)) {
-        fs::create_directories(outputDir);
-    }
-
-    std::string outputFile = (outputDir / (inputPath.stem().string() + "_compressed" + inputPath.extension().string())).string();
+    // log.txt.zip, like the .zst/.lz4/.gz names, so log.txt and log.csv do not
+    // share an output
+    std::string outputFile = zip
+        ? (outputDir / (inputPath.filename().string() + ".zip")).string()
+        : PureCppCompressor::outputPathFor(inputFile, outputDir.string(), codec);
 
     std::cout << "📁 Archivo de entrada: " << inputFile << std::endl;
     std::cout << "📁 Archivo de salida: " << outputFile << std::endl;
     std::cout << "🔨 Comprimiendo..." << std::endl;
 
-    CompressionResult result = PureCppCompressor::compressFile(inputFile, outputFile);
+    CompressionResult result = zip ? PureCppCompressor::compressToZip(inputFile, outputFile, codec)
+                                   : PureCppCompressor::compressFile(inputFile, outputFile, codec);
 
     if (result.success) {
         std::cout << "✅ Compresión exitosa!" << std::endl;
@@ -213,3 +836,461 @@ int main(int argc, char *argv[])
 
     return 0;
 }
+
+// Copies bytes [offset, offset + length) of a --seekable file to stdout,
+// inflating only the blocks that hold them
+int runRange(const std::string &inputFile, uint64_t offset, uint64_t length)
+{
+    SeekableGzipReader reader;
+    if (!reader.open(inputFile)) {
+        std::cerr << "❌ Error: " << reader.errorMessage() << ": " << inputFile << std::endl;
+        return 1;
+    }
+
+    std::vector<unsigned char> buffer(InputSource::ReadBlockSize);
+    while (length > 0) {
+        long long got = reader.read(offset, buffer.data(), static_cast<size_t>(std::min<uint64_t>(length, buffer.size())));
+        if (got < 0) {
+            std::cerr << "❌ Error: " << reader.errorMessage() << std::endl;
+            return 1;
+        }
+        if (got == 0) {
+            break;
+        }
+        std::cout.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(got));
+        offset += static_cast<uint64_t>(got);
+        length -= static_cast<uint64_t>(got);
+    }
+    std::cout.flush();
+    return std::cout ? 0 : 1;
+}
+
+// Splits the inputs into shards (unless the queue already exists), then waits
+// for the workers, breaking the leases of crashed ones, and sums up their
+// reports
+int runCoordinator(const std::string &queueDirectory, const std::vector<std::string> &inputFiles, size_t shardSize,
+                   unsigned leaseSeconds)
+{
+    ShardQueue::Options options;
+    options.leaseSeconds = leaseSeconds;
+    ShardQueue queue(queueDirectory, options);
+
+    if (!inputFiles.empty()) {
+        // Workers may run elsewhere: give them paths that do not depend on our cwd
+        std::vector<std::string> files;
+        files.reserve(inputFiles.size());
+        for (const std::string &inputFile : inputFiles) {
+            files.push_back(fs::absolute(inputFile).string());
+        }
+        if (!queue.create(files, shardSize)) {
+            std::cout << "❌ Error: " << queue.errorMessage() << std::endl;
+            return 1;
+        }
+        std::cout << "🗂️  " << files.size() << " archivos repartidos en fragmentos de " << shardSize
+                  << " en " << queueDirectory << std::endl;
+    }
+
+    ShardQueue::Status status = queue.status();
+    if (status.shards == 0) {
+        std::cout << "❌ Error: La carpeta no contiene fragmentos: " << queueDirectory << std::endl;
+        return 1;
+    }
+    std::cout << "⏳ Esperando a los trabajadores (--worker " << queueDirectory << ")..." << std::endl;
+
+    size_t reported = status.shards + 1;
+    while (true) {
+        size_t reclaimed = queue.reclaimExpired();
+        if (reclaimed > 0) {
+            std::cout << "♻️  Concesiones vencidas recuperadas: " << reclaimed << std::endl;
+        }
+        status = queue.status();
+        if (status.done != reported) {
+            std::cout << "📦 Fragmentos terminados: " << status.done << "/" << status.shards
+                      << " (" << status.leased << " en curso)" << std::endl;
+            reported = status.done;
+        }
+        if (status.done >= status.shards) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+    }
+
+    // One line per file: "ok\t<original>\t<compressed>\t<path>" or "error\t<path>\t<message>"
+    size_t files = 0;
+    size_t successful = 0;
+    uint64_t totalOriginal = 0;
+    uint64_t totalCompressed = 0;
+    for (const std::string &report : queue.reports()) {
+        std::istringstream lines(report);
+        std::string line;
+        while (std::getline(lines, line)) {
+            std::vector<std::string> fields;
+            std::istringstream columns(line);
+            std::string field;
+            while (std::getline(columns, field, '\t')) {
+                fields.push_back(field);
+            }
+            if (fields.empty()) {
+                continue;
+            }
+            ++files;
+            if (fields[0] == "ok" && fields.size() >= 4) {
+                ++successful;
+                totalOriginal += std::strtoull(fields[1].c_str(), nullptr, 10);
+                totalCompressed += std::strtoull(fields[2].c_str(), nullptr, 10);
+            } else if (fields.size() >= 3) {
+                std::cout << "❌ " << fields[1] << ": " << fields[2] << std::endl;
+            }
+        }
+    }
+
+    std::cout << "📊 Archivos comprimidos: " << successful << "/" << files << std::endl;
+    std::cout << "📊 Total: " << totalOriginal << " -> " << totalCompressed << " bytes" << std::endl;
+    return successful == files ? 0 : 1;
+}
+
+// Claims shards until none is left and compresses their files one by one
+// with PureCppCompressor::compressFile. A heartbeat thread renews the lease;
+// if it is lost (the shard was reassigned) the shard is dropped after the
+// current file and not acknowledged. Outputs go under outputDir in a copy
+// of each input's absolute directory (/var/log/a/app.log becomes
+// output/var/log/a/app.log...), so inputs that share a name do not collide.
+int runWorker(const std::string &queueDirectory, const fs::path &outputDir, unsigned leaseSeconds,
+              const CodecOptions &codec)
+{
+    ShardQueue::Options options;
+    options.leaseSeconds = leaseSeconds;
+    ShardQueue queue(queueDirectory, options);
+
+    std::cout << "👷 Trabajador " << queue.owner() << " en " << queueDirectory << std::endl;
+
+    size_t shardsDone = 0;
+    while (true) {
+        ShardQueue::Lease lease;
+        if (!queue.claim(lease)) {
+            if (!queue.errorMessage().empty()) {
+                std::cout << "❌ Error: " << queue.errorMessage() << std::endl;
+                return 1;
+            }
+            ShardQueue::Status status = queue.status();
+            if (status.done >= status.shards) {
+                break;
+            }
+            // The rest is leased: wait for it to be acknowledged or to expire
+            std::this_thread::sleep_for(std::chrono::seconds(2));
+            continue;
+        }
+
+        std::atomic<bool> lost(false);
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool finished = false;
+        std::thread heartbeat([&]() {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto interval = std::chrono::seconds(std::max(1u, leaseSeconds / 3));
+            while (!condition.wait_for(lock, interval, [&finished]() { return finished; })) {
+                if (!queue.renew(lease)) {
+                    lost = true;
+                    return;
+                }
+            }
+        });
+
+        std::ostringstream report;
+        size_t successful = 0;
+        for (const std::string &inputFile : lease.files) {
+            if (lost) {
+                break;
+            }
+            std::error_code directoryError;
+            fs::path source = fs::absolute(inputFile, directoryError).lexically_normal();
+            fs::path directory = outputDir / source.parent_path().relative_path();
+            fs::create_directories(directory, directoryError);
+            std::string outputFile = PureCppCompressor::outputPathFor(inputFile, directory.string(), codec);
+
+            // Renamed into place, so a shard compressed twice never leaves a torn file
+            std::string partialFile = outputFile + ".part-" + std::to_string(getpid());
+            CompressionResult result = PureCppCompressor::compressFile(inputFile, partialFile, codec);
+            if (result.success) {
+                std::error_code error;
+                fs::rename(partialFile, outputFile, error);
+                if (error) {
+                    fs::remove(partialFile, error);
+                    result.success = false;
+                    result.errorMessage = "No se pudo guardar el archivo de salida";
+                }
+            }
+
+            if (result.success) {
+                ++successful;
+                report << "ok\t" << result.originalSize << "\t" << result.compressedSize << "\t" << inputFile << "\n";
+            } else {
+                report << "error\t" << inputFile << "\t" << result.errorMessage << "\n";
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = true;
+        }
+        condition.notify_all();
+        heartbeat.join();
+
+        if (lost) {
+            std::cout << "⚠️  Fragmento " << lease.shard << " reasignado a otro trabajador, se abandona" << std::endl;
+            continue;
+        }
+        if (!queue.acknowledge(lease, report.str())) {
+            std::cout << "❌ Error: " << queue.errorMessage() << std::endl;
+            queue.release(lease);
+            return 1;
+        }
+        ++shardsDone;
+        std::cout << "✅ Fragmento " << lease.shard << ": " << successful << "/" << lease.files.size()
+                  << " archivos" << std::endl;
+    }
+
+    std::cout << "📊 Fragmentos procesados por este trabajador: " << shardsDone << std::endl;
+    std::cout << "📁 Archivos guardados en: " << outputDir.string() << std::endl;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> inputFiles;
+    bool dropCache = false;
+    bool zip = false;
+    uint64_t maxMemory = 0;
+    bool pinWorkers = false;
+    std::string archiveName;
+    std::string coordinateDirectory;
+    std::string workerDirectory;
+    std::string manifestPath;
+    unsigned long shardSize = 1000;
+    unsigned long leaseSeconds = 300;
+    bool range = false;
+    uint64_t rangeOffset = 0;
+    uint64_t rangeLength = 0;
+    CodecOptions codec;
+    bool lz4LevelSet = false;           // --lz4-level wins over the --lz4/--lz4hc default
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--drop-cache") {
+            dropCache = true;
+        } else if (argument == "--archive") {
+            if (i + 1 >= argc) {
+                std::cout << "❌ Error: Falta el nombre del archivo para --archive" << std::endl;
+                return 1;
+            }
+            archiveName = argv[++i];
+        } else if (argument == "--max-memory") {
+            if (i + 1 >= argc || !MemoryBudget::parseSize(argv[i + 1], maxMemory)) {
+                std::cout << "❌ Error: Tamaño de memoria no válido para --max-memory" << std::endl;
+                return 1;
+            }
+            ++i;
+        } else if (argument == "--coordinate" || argument == "--worker" || argument == "--manifest") {
+            if (i + 1 >= argc) {
+                std::cout << "❌ Error: Falta la ruta para " << argument << std::endl;
+                return 1;
+            }
+            std::string &path = argument == "--coordinate" ? coordinateDirectory
+                              : argument == "--worker" ? workerDirectory : manifestPath;
+            path = argv[++i];
+        } else if (argument == "--shard-size" || argument == "--lease") {
+            unsigned long &value = argument == "--shard-size" ? shardSize : leaseSeconds;
+            char *end = nullptr;
+            if (i + 1 >= argc || (value = std::strtoul(argv[i + 1], &end, 10)) == 0 || *end != '\0') {
+                std::cout << "❌ Error: Número no válido para " << argument << std::endl;
+                return 1;
+            }
+            ++i;
+        } else if (argument == "--zstd") {
+            codec.zstd = true;
+        } else if (argument == "--zstd-level" || argument == "--zstd-threads") {
+            char *end = nullptr;
+            unsigned long value = 0;
+            if (i + 1 >= argc || (value = std::strtoul(argv[i + 1], &end, 10)) == 0 || *end != '\0'
+                || (argument == "--zstd-level" && value > static_cast<unsigned long>(ZstdStream::MaxLevel))) {
+                std::cout << "❌ Error: Número no válido para " << argument << std::endl;
+                return 1;
+            }
+            if (argument == "--zstd-level") {
+                codec.zstdOptions.level = static_cast<int>(value);
+            } else {
+                codec.zstdOptions.workers = static_cast<unsigned>(value);
+            }
+            codec.zstd = true;
+            ++i;
+        } else if (argument == "--long") {
+            codec.zstdOptions.longDistance = true;
+            codec.zstd = true;
+        } else if (argument == "--lz4" || argument == "--lz4hc") {
+            if (!lz4LevelSet) {
+                codec.lz4Options.level = argument == "--lz4" ? Lz4Stream::FastLevel : Lz4Stream::HcDefaultLevel;
+            }
+            codec.lz4 = true;
+        } else if (argument == "--lz4-level") {
+            char *end = nullptr;
+            long value = i + 1 < argc ? std::strtol(argv[i + 1], &end, 10) : 0;
+            if (i + 1 >= argc || end == argv[i + 1] || *end != '\0'
+                || value < Lz4Stream::FastestLevel || value > Lz4Stream::MaxLevel) {
+                std::cout << "❌ Error: Número no válido para " << argument << std::endl;
+                return 1;
+            }
+            codec.lz4Options.level = static_cast<int>(value);
+            lz4LevelSet = true;
+            codec.lz4 = true;
+            ++i;
+        } else if (argument == "--lz4-types") {
+            if (i + 1 >= argc) {
+                std::cout << "❌ Error: Faltan las extensiones para --lz4-types" << std::endl;
+                return 1;
+            }
+            std::istringstream types(argv[++i]);
+            std::string type;
+            size_t count = codec.lz4Extensions.size();
+            while (std::getline(types, type, ',')) {
+                if (type.empty() || type == ".") {
+                    continue;
+                }
+                std::transform(type.begin(), type.end(), type.begin(), ::tolower);
+                codec.lz4Extensions.push_back(type[0] == '.' ? type : "." + type);
+            }
+            // An empty list would mean every file
+            if (codec.lz4Extensions.size() == count) {
+                std::cout << "❌ Error: Faltan las extensiones para --lz4-types" << std::endl;
+                return 1;
+            }
+            codec.lz4 = true;
+        } else if (argument == "--brotli") {
+            codec.brotli = true;
+        } else if (argument == "--brotli-quality" || argument == "--brotli-window") {
+            bool quality = argument == "--brotli-quality";
+            long lowest = quality ? BrotliStream::MinQuality : BrotliStream::MinWindowBits;
+            long highest = quality ? BrotliStream::MaxQuality : BrotliStream::MaxWindowBits;
+            char *end = nullptr;
+            long value = i + 1 < argc ? std::strtol(argv[i + 1], &end, 10) : 0;
+            if (i + 1 >= argc || end == argv[i + 1] || *end != '\0' || value < lowest || value > highest) {
+                std::cout << "❌ Error: Número no válido para " << argument << std::endl;
+                return 1;
+            }
+            (quality ? codec.brotliOptions.quality : codec.brotliOptions.windowBits) = static_cast<int>(value);
+            codec.brotli = true;
+            ++i;
+        } else if (argument == "--seekable") {
+            codec.seekable = true;
+        } else if (argument == "--seekable-block") {
+            uint64_t blockSize = 0;
+            if (i + 1 >= argc || !MemoryBudget::parseSize(argv[i + 1], blockSize)
+                || blockSize < 32 * 1024 || blockSize > 64 * 1024 * 1024) {
+                std::cout << "❌ Error: Tamaño no válido para --seekable-block (de 32K a 64M)" << std::endl;
+                return 1;
+            }
+            codec.seekableOptions.blockSize = static_cast<size_t>(blockSize);
+            codec.seekable = true;
+            ++i;
+        } else if (argument == "--range") {
+            std::string text = i + 1 < argc ? argv[i + 1] : "";
+            size_t colon = text.find(':');
+            if (colon == std::string::npos || !MemoryBudget::parseSize(text.substr(0, colon), rangeOffset)
+                || !MemoryBudget::parseSize(text.substr(colon + 1), rangeLength)) {
+                std::cout << "❌ Error: Rango no válido para --range (use inicio:longitud)" << std::endl;
+                return 1;
+            }
+            range = true;
+            ++i;
+        } else if (argument == "--pin") {
+            pinWorkers = true;
+        } else if (argument == "--zip") {
+            zip = true;
+        } else {
+            inputFiles.push_back(argument);
+        }
+    }
+
+    if (!manifestPath.empty()) {
+        std::ifstream manifest(manifestPath);
+        if (!manifest.is_open()) {
+            std::cout << "❌ Error: No se pudo abrir la lista de archivos: " << manifestPath << std::endl;
+            return 1;
+        }
+        std::string line;
+        while (std::getline(manifest, line)) {
+            if (!line.empty()) {
+                inputFiles.push_back(line);
+            }
+        }
+    }
+
+    if (codec.zstd && !ZstdStream::available()) {
+        std::cout << "❌ Error: Esta versión se compiló sin soporte para zstd" << std::endl;
+        return 1;
+    }
+    if (codec.lz4 && !Lz4Stream::available()) {
+        std::cout << "❌ Error: Esta versión se compiló sin soporte para lz4" << std::endl;
+        return 1;
+    }
+    if (codec.brotli && !BrotliStream::available()) {
+        std::cout << "❌ Error: Esta versión se compiló sin soporte para brotli" << std::endl;
+        return 1;
+    }
+    // ZIP has no LZ4 or Brotli method that unzip tools understand
+    if ((codec.lz4 || codec.brotli) && (zip || !archiveName.empty())) {
+        std::cout << "❌ Error: " << (codec.lz4 ? "--lz4" : "--brotli")
+                  << " no se puede combinar con --zip ni --archive" << std::endl;
+        return 1;
+    }
+
+    // The index is what makes the output seekable; other codecs have none
+    if (codec.seekable && (codec.zstd || codec.lz4 || codec.brotli || zip || !archiveName.empty())) {
+        std::cout << "❌ Error: --seekable no se puede combinar con otros códecs ni con --zip o --archive" << std::endl;
+        return 1;
+    }
+
+    if (range) {
+        if (inputFiles.size() != 1) {
+            std::cout << "❌ Error: --range necesita exactamente un archivo .gz" << std::endl;
+            return 1;
+        }
+        return runRange(inputFiles.front(), rangeOffset, rangeLength);
+    }
+
+    if (!coordinateDirectory.empty()) {
+        return runCoordinator(coordinateDirectory, inputFiles, shardSize, static_cast<unsigned>(leaseSeconds));
+    }
+
+    if (inputFiles.empty() && workerDirectory.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Create output directory
+    fs::path outputDir("output");
+    if (!fs::exists(outputDir)) {
+        fs::create_directories(outputDir);
+    }
+
+    if (!workerDirectory.empty()) {
+        return runWorker(workerDirectory, outputDir, static_cast<unsigned>(leaseSeconds), codec);
+    }
+
+    if (!archiveName.empty()) {
+        return runArchive(inputFiles, outputDir, archiveName, codec);
+    }
+
+    if (zip) {
+        int status = 0;
+        for (const std::string &inputFile : inputFiles) {
+            status |= runSingle(inputFile, outputDir, true, codec);
+        }
+        return status;
+    }
+
+    // Only the batch path manages the page cache, the memory budget and pinning
+    if (inputFiles.size() > 1 || dropCache || maxMemory > 0 || pinWorkers) {
+        return runBatch(inputFiles, outputDir, dropCache, maxMemory, pinWorkers, codec);
+    }
+
+    return runSingle(inputFiles.front(), outputDir, false, codec);
+}
@@ -0,0 +1,373 @@
+#include "seekable_gzip.h"
+#include "input_source.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+constexpr unsigned char IndexTag = 'I';
+constexpr unsigned char FooterTag = 'F';
+constexpr unsigned char FormatVersion = 1;
+constexpr size_t EntriesPerMember = 8000;       // 64000 bytes, under the 65535-byte FEXTRA limit
+constexpr size_t FooterPayloadSize = 2 + 3 * 8;
+constexpr size_t FooterSize = 10 + 2 + 4 + FooterPayloadSize + 2 + 8;
+
+// Final fixed-Huffman block with no data, then CRC-32 and ISIZE of nothing
+const unsigned char EmptyDeflate[] = {0x03, 0x00};
+
+void appendLE(std::vector<unsigned char> &out, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<unsigned char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+uint64_t readLE(const unsigned char *data, int bytes)
+{
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; --i) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+// An empty gzip member whose FEXTRA holds one "SX" subfield
+std::vector<unsigned char> emptyMember(const std::vector<unsigned char> &payload)
+{
+    // ID1 ID2 CM FLG(FEXTRA) MTIME(4) XFL OS
+    std::vector<unsigned char> member = {0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 3};
+    appendLE(member, payload.size() + 4, 2);
+    member.push_back('S');
+    member.push_back('X');
+    appendLE(member, payload.size(), 2);
+    member.insert(member.end(), payload.begin(), payload.end());
+    member.insert(member.end(), std::begin(EmptyDeflate), std::end(EmptyDeflate));
+    appendLE(member, 0, 8);
+    return member;
+}
+
+// Size of the empty member at data and its "SX" payload; false if it is not one
+bool parseEmptyMember(const unsigned char *data, size_t size, size_t &memberSize, std::vector<unsigned char> &payload)
+{
+    if (size < 12 || data[0] != 0x1f || data[1] != 0x8b || data[2] != 8 || data[3] != 4) {
+        return false;
+    }
+    size_t extraSize = static_cast<size_t>(readLE(data + 10, 2));
+    memberSize = 12 + extraSize + sizeof(EmptyDeflate) + 8;
+    if (size < memberSize) {
+        return false;
+    }
+
+    const unsigned char *tail = data + 12 + extraSize;
+    if (!std::equal(std::begin(EmptyDeflate), std::end(EmptyDeflate), tail)
+        || readLE(tail + sizeof(EmptyDeflate), 8) != 0) {
+        return false;
+    }
+
+    const unsigned char *field = data + 12;
+    const unsigned char *end = field + extraSize;
+    while (end - field >= 4) {
+        size_t length = static_cast<size_t>(readLE(field + 2, 2));
+        if (static_cast<size_t>(end - field - 4) < length) {
+            return false;
+        }
+        if (field[0] == 'S' && field[1] == 'X') {
+            payload.assign(field + 4, field + 4 + length);
+            return !payload.empty();
+        }
+        field += 4 + length;
+    }
+    return false;
+}
+
+} // namespace
+
+SeekableGzipWriter::SeekableGzipWriter()
+    : SeekableGzipWriter(Options())
+{
+}
+
+SeekableGzipWriter::SeekableGzipWriter(const Options &options)
+    : m_options(options)
+    , m_totalIn(0)
+    , m_totalOut(0)
+    , m_blocks(0)
+{
+}
+
+ParallelDeflate::Options SeekableGzipWriter::deflateOptions() const
+{
+    ParallelDeflate::Options options;
+    options.level = m_options.level;
+    options.blockSize = m_options.blockSize;
+    options.threads = m_options.threads;
+    options.format = DeflateStream::Format::Gzip;
+    options.independentBlocks = true;
+    options.cancel = m_options.cancel;
+    return options;
+}
+
+uint64_t SeekableGzipWriter::memoryEstimate() const
+{
+    return ParallelDeflate(deflateOptions()).memoryEstimate();
+}
+
+bool SeekableGzipWriter::compress(InputSource &input, const DeflateStream::Sink &sink,
+                                  const DeflateStream::ProgressCallback &progress)
+{
+    ParallelDeflate deflater(deflateOptions());
+    bool ok = deflater.compress(input, sink, progress);
+    m_totalIn = deflater.totalIn();
+    m_totalOut = deflater.totalOut();
+    m_blocks = 0;
+    if (!ok) {
+        m_errorMessage = deflater.errorMessage();
+        return false;
+    }
+
+    // Index members, then the fixed-size footer pointing back at them
+    const std::vector<ParallelDeflate::Member> &members = deflater.members();
+    std::vector<unsigned char> index;
+    for (size_t first = 0; first < members.size(); first += EntriesPerMember) {
+        size_t last = std::min(members.size(), first + EntriesPerMember);
+        std::vector<unsigned char> payload = {IndexTag};
+        for (size_t i = first; i < last; ++i) {
+            appendLE(payload, members[i].compressedSize, 4);
+            appendLE(payload, members[i].uncompressedSize, 4);
+        }
+        std::vector<unsigned char> member = emptyMember(payload);
+        index.insert(index.end(), member.begin(), member.end());
+    }
+
+    std::vector<unsigned char> footer = {FooterTag, FormatVersion};
+    appendLE(footer, members.size(), 8);
+    appendLE(footer, m_totalIn, 8);
+    appendLE(footer, index.size(), 8);
+    std::vector<unsigned char> trailer = emptyMember(footer);
+    index.insert(index.end(), trailer.begin(), trailer.end());
+
+    if (!sink(index.data(), index.size())) {
+        m_errorMessage = "Error al escribir los datos comprimidos";
+        return false;
+    }
+    m_totalOut += index.size();
+    m_blocks = members.size();
+    return true;
+}
+
+bool SeekableGzipWriter::compressFile(const std::string &inputPath, const std::string &outputPath,
+                                      const DeflateStream::ProgressCallback &progress)
+{
+    InputSource inputFile;
+    if (!inputFile.open(inputPath)) {
+        m_errorMessage = inputFile.errorMessage();
+        return false;
+    }
+
+    std::ofstream outputFile(outputPath, std::ios::binary | std::ios::trunc);
+    if (!outputFile.is_open()) {
+        m_errorMessage = "No se pudo crear el archivo de salida";
+        return false;
+    }
+
+    DeflateStream::Sink sink = [&outputFile](const unsigned char *data, size_t size) {
+        outputFile.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(outputFile);
+    };
+
+    auto abandon = [&](const std::string &message) {
+        if (!message.empty()) {
+            m_errorMessage = message;
+        }
+        outputFile.close();
+        std::remove(outputPath.c_str());
+        return false;
+    };
+
+    if (!compress(inputFile, sink, progress)) {
+        return abandon(std::string());
+    }
+
+    outputFile.close();
+    if (!outputFile) {
+        return abandon("Error al escribir los datos comprimidos");
+    }
+    return true;
+}
+
+SeekableGzipReader::SeekableGzipReader()
+    : m_cachedBlock(SIZE_MAX)
+    , m_blocksInflated(0)
+{
+}
+
+bool SeekableGzipReader::open(const std::string &path)
+{
+    close();
+    m_file.open(path, std::ios::binary | std::ios::ate);
+    if (!m_file.is_open()) {
+        m_errorMessage = "No se pudo abrir el archivo de entrada";
+        return false;
+    }
+    uint64_t fileSize = static_cast<uint64_t>(m_file.tellg());
+    if (!readIndex(fileSize)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SeekableGzipReader::close()
+{
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+    m_file.clear();
+    m_sizes.clear();
+    m_offsets.clear();
+    m_starts.clear();
+    m_cachedBlock = SIZE_MAX;
+    m_cache.clear();
+    m_blocksInflated = 0;
+}
+
+bool SeekableGzipReader::readIndex(uint64_t fileSize)
+{
+    const std::string notIndexed = "El archivo no tiene índice de acceso aleatorio";
+    if (fileSize < FooterSize) {
+        m_errorMessage = notIndexed;
+        return false;
+    }
+
+    std::vector<unsigned char> footer(FooterSize);
+    m_file.seekg(static_cast<std::streamoff>(fileSize - FooterSize));
+    m_file.read(reinterpret_cast<char *>(footer.data()), static_cast<std::streamsize>(footer.size()));
+    size_t memberSize = 0;
+    std::vector<unsigned char> payload;
+    if (!m_file || !parseEmptyMember(footer.data(), footer.size(), memberSize, payload)
+        || memberSize != FooterSize || payload.size() != FooterPayloadSize || payload[0] != FooterTag) {
+        m_errorMessage = notIndexed;
+        return false;
+    }
+    if (payload[1] != FormatVersion) {
+        m_errorMessage = "Versión de índice no compatible";
+        return false;
+    }
+    uint64_t blocks = readLE(payload.data() + 2, 8);
+    uint64_t totalIn = readLE(payload.data() + 10, 8);
+    uint64_t indexSize = readLE(payload.data() + 18, 8);
+
+    const std::string corrupt = "El índice del archivo está dañado";
+    if (indexSize > fileSize - FooterSize) {
+        m_errorMessage = corrupt;
+        return false;
+    }
+    uint64_t dataSize = fileSize - FooterSize - indexSize;
+
+    std::vector<unsigned char> index(static_cast<size_t>(indexSize));
+    m_file.seekg(static_cast<std::streamoff>(dataSize));
+    m_file.read(reinterpret_cast<char *>(index.data()), static_cast<std::streamsize>(index.size()));
+    if (!m_file) {
+        m_errorMessage = "Error al leer el índice";
+        return false;
+    }
+
+    for (size_t position = 0; position < index.size(); position += memberSize) {
+        if (!parseEmptyMember(index.data() + position, index.size() - position, memberSize, payload)
+            || payload[0] != IndexTag || (payload.size() - 1) % 8 != 0) {
+            m_errorMessage = corrupt;
+            return false;
+        }
+        for (size_t entry = 1; entry < payload.size(); entry += 8) {
+            m_sizes.push_back({static_cast<uint32_t>(readLE(payload.data() + entry, 4)),
+                               static_cast<uint32_t>(readLE(payload.data() + entry + 4, 4))});
+        }
+    }
+
+    uint64_t offset = 0;
+    uint64_t start = 0;
+    for (const BlockSize &block : m_sizes) {
+        m_offsets.push_back(offset);
+        m_starts.push_back(start);
+        offset += block.compressed;
+        start += block.uncompressed;
+    }
+    m_starts.push_back(start);
+
+    if (m_sizes.size() != blocks || offset != dataSize || start != totalIn) {
+        m_errorMessage = corrupt;
+        return false;
+    }
+    return true;
+}
+
+bool SeekableGzipReader::inflateBlock(size_t index)
+{
+    if (m_cachedBlock == index) {
+        return true;
+    }
+    m_cachedBlock = SIZE_MAX;
+
+    const BlockSize &block = m_sizes[index];
+    m_compressed.resize(block.compressed);
+    m_file.clear();
+    m_file.seekg(static_cast<std::streamoff>(m_offsets[index]));
+    m_file.read(reinterpret_cast<char *>(m_compressed.data()), static_cast<std::streamsize>(m_compressed.size()));
+    if (!m_file) {
+        m_errorMessage = "Error al leer el archivo comprimido";
+        return false;
+    }
+
+    // One member: gzip header, deflate data and a trailer zlib checks for us
+    z_stream stream = {};
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+        m_errorMessage = "No se pudo inicializar zlib";
+        return false;
+    }
+    m_cache.resize(block.uncompressed);
+    stream.next_in = m_compressed.data();
+    stream.avail_in = static_cast<uInt>(m_compressed.size());
+    stream.next_out = m_cache.data();
+    stream.avail_out = static_cast<uInt>(m_cache.size());
+    // A zero-length output buffer is fine: an empty member needs none
+    unsigned char spare = 0;
+    if (m_cache.empty()) {
+        stream.next_out = &spare;
+        stream.avail_out = 1;
+    }
+    int ret = inflate(&stream, Z_FINISH);
+    bool complete = ret == Z_STREAM_END && stream.total_out == block.uncompressed && stream.avail_in == 0;
+    inflateEnd(&stream);
+    if (!complete) {
+        m_errorMessage = "Bloque comprimido dañado";
+        return false;
+    }
+
+    m_cachedBlock = index;
+    ++m_blocksInflated;
+    return true;
+}
+
+long long SeekableGzipReader::read(uint64_t offset, unsigned char *data, size_t size)
+{
+    if (m_starts.empty()) {
+        m_errorMessage = "No hay ningún archivo abierto";
+        return -1;
+    }
+
+    size_t copied = 0;
+    while (copied < size && offset < this->size()) {
+        // Last member starting at or before offset; empty members are skipped
+        size_t index = static_cast<size_t>(std::upper_bound(m_starts.begin(), m_starts.end(), offset)
+                                           - m_starts.begin()) - 1;
+        if (!inflateBlock(index)) {
+            return -1;
+        }
+        size_t within = static_cast<size_t>(offset - m_starts[index]);
+        size_t count = std::min(size - copied, m_cache.size() - within);
+        std::copy_n(m_cache.begin() + within, count, data + copied);
+        copied += count;
+        offset += count;
+    }
+    return static_cast<long long>(copied);
+}
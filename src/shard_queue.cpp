@@ -0,0 +1,355 @@
+#include "shard_queue.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+bool readFile(const std::string &path, std::string &contents)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return static_cast<bool>(file) || file.eof();
+}
+
+// Readers never see a half-written file: it appears under its name complete
+bool writeFileAtomically(const std::string &path, const std::string &temporaryPath, const std::string &contents)
+{
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file << contents;
+        file.close();
+        if (!file) {
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string hostName()
+{
+    char name[256] = {};
+    if (gethostname(name, sizeof(name) - 1) != 0 || name[0] == '\0') {
+        return "localhost";
+    }
+    return name;
+}
+
+} // namespace
+
+ShardQueue::ShardQueue(const std::string &directory)
+    : ShardQueue(directory, Options())
+{
+}
+
+ShardQueue::ShardQueue(const std::string &directory, const Options &options)
+    : m_directory(directory)
+    , m_options(options)
+{
+    std::string host = hostName();
+    std::string pid = std::to_string(getpid());
+    m_owner = host + ":" + pid + ":" + std::to_string(time(nullptr));
+    m_clockPath = (fs::path(m_directory) / "leases" / (".clock-" + host + "-" + pid)).string();
+}
+
+ShardQueue::~ShardQueue()
+{
+    ::unlink(m_clockPath.c_str());
+}
+
+bool ShardQueue::create(const std::vector<std::string> &files, size_t filesPerShard)
+{
+    m_errorMessage.clear();
+    filesPerShard = std::max<size_t>(filesPerShard, 1);
+
+    std::error_code error;
+    for (const char *subdirectory : { "shards", "leases", "done" }) {
+        fs::create_directories(fs::path(m_directory) / subdirectory, error);
+        if (error) {
+            m_errorMessage = "No se pudo crear la carpeta de fragmentos";
+            return false;
+        }
+    }
+    if (!listShards("shards", ".list").empty()) {
+        m_errorMessage = "La carpeta ya contiene una cola de fragmentos";
+        return false;
+    }
+
+    for (size_t first = 0, index = 0; first < files.size(); first += filesPerShard, ++index) {
+        char shard[16];
+        std::snprintf(shard, sizeof(shard), "%08zu", index);
+
+        std::string contents;
+        size_t last = std::min(files.size(), first + filesPerShard);
+        for (size_t i = first; i < last; ++i) {
+            contents += files[i];
+            contents += '\n';
+        }
+
+        std::string temporaryPath = (fs::path(m_directory) / "shards" / (std::string(".tmp-") + shard)).string();
+        if (!writeFileAtomically(shardPath(shard), temporaryPath, contents)) {
+            m_errorMessage = "No se pudo escribir el fragmento " + std::string(shard);
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t ShardQueue::reclaimExpired()
+{
+    int64_t now = 0;
+    if (!serverNow(now)) {
+        return 0;
+    }
+
+    size_t reclaimed = 0;
+    for (const std::string &shard : listShards("leases", ".lease")) {
+        if (isExpired(shard, now) && breakLease(shard)) {
+            ++reclaimed;
+        }
+    }
+    return reclaimed;
+}
+
+ShardQueue::Status ShardQueue::status()
+{
+    Status status;
+    std::vector<std::string> done = listShards("done", ".done");
+    std::unordered_set<std::string> finished(done.begin(), done.end());
+    status.shards = listShards("shards", ".list").size();
+    status.done = finished.size();
+
+    int64_t now = 0;
+    bool haveNow = serverNow(now);
+    for (const std::string &shard : listShards("leases", ".lease")) {
+        if (finished.count(shard)) {
+            continue;
+        }
+        ++status.leased;
+        if (haveNow && isExpired(shard, now)) {
+            ++status.expired;
+        }
+    }
+    return status;
+}
+
+std::vector<std::string> ShardQueue::reports()
+{
+    std::vector<std::string> reports;
+    for (const std::string &shard : listShards("done", ".done")) {
+        std::string report;
+        if (readFile(donePath(shard), report)) {
+            reports.push_back(report);
+        }
+    }
+    return reports;
+}
+
+bool ShardQueue::claim(Lease &lease)
+{
+    m_errorMessage.clear();
+
+    std::vector<std::string> done = listShards("done", ".done");
+    std::vector<std::string> leased = listShards("leases", ".lease");
+    std::unordered_set<std::string> finished(done.begin(), done.end());
+    std::unordered_set<std::string> held(leased.begin(), leased.end());
+
+    int64_t now = 0;
+    bool haveNow = false;
+    for (const std::string &shard : listShards("shards", ".list")) {
+        if (finished.count(shard)) {
+            continue;
+        }
+        if (held.count(shard)) {
+            if (!haveNow) {
+                if (!serverNow(now)) {
+                    return false;
+                }
+                haveNow = true;
+            }
+            if (!isExpired(shard, now) || !breakLease(shard)) {
+                continue;
+            }
+        }
+
+        std::string path = leasePath(shard);
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            if (errno == EEXIST) {
+                continue;       // another worker was faster
+            }
+            m_errorMessage = "No se pudo crear la concesión del fragmento " + shard;
+            return false;
+        }
+        bool written = ::write(fd, m_owner.data(), m_owner.size()) == static_cast<ssize_t>(m_owner.size());
+        if (::close(fd) != 0 || !written) {
+            ::unlink(path.c_str());
+            m_errorMessage = "No se pudo crear la concesión del fragmento " + shard;
+            return false;
+        }
+
+        // Acknowledged between the listing and the claim
+        if (::access(donePath(shard).c_str(), F_OK) == 0) {
+            ::unlink(path.c_str());
+            continue;
+        }
+
+        std::string contents;
+        if (!readFile(shardPath(shard), contents)) {
+            ::unlink(path.c_str());
+            m_errorMessage = "No se pudo leer el fragmento " + shard;
+            return false;
+        }
+
+        lease.shard = shard;
+        lease.files.clear();
+        std::istringstream lines(contents);
+        std::string line;
+        while (std::getline(lines, line)) {
+            if (!line.empty()) {
+                lease.files.push_back(line);
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+bool ShardQueue::renew(const Lease &lease)
+{
+    if (!ownsLease(lease.shard)) {
+        return false;
+    }
+    // NULL times: NFS stamps the server's clock, which isExpired() compares with
+    return ::utimensat(AT_FDCWD, leasePath(lease.shard).c_str(), nullptr, 0) == 0;
+}
+
+bool ShardQueue::acknowledge(const Lease &lease, const std::string &report)
+{
+    m_errorMessage.clear();
+    std::string temporaryPath = (fs::path(m_directory) / "done"
+                                 / (".tmp-" + lease.shard + "-" + std::to_string(getpid()))).string();
+    if (!writeFileAtomically(donePath(lease.shard), temporaryPath, report)) {
+        m_errorMessage = "No se pudo registrar el fragmento " + lease.shard;
+        return false;
+    }
+    release(lease);
+    return true;
+}
+
+void ShardQueue::release(const Lease &lease)
+{
+    if (ownsLease(lease.shard)) {
+        ::unlink(leasePath(lease.shard).c_str());
+    }
+}
+
+std::string ShardQueue::shardPath(const std::string &shard) const
+{
+    return (fs::path(m_directory) / "shards" / (shard + ".list")).string();
+}
+
+std::string ShardQueue::leasePath(const std::string &shard) const
+{
+    return (fs::path(m_directory) / "leases" / (shard + ".lease")).string();
+}
+
+std::string ShardQueue::donePath(const std::string &shard) const
+{
+    return (fs::path(m_directory) / "done" / (shard + ".done")).string();
+}
+
+std::vector<std::string> ShardQueue::listShards(const std::string &directory, const std::string &suffix) const
+{
+    std::vector<std::string> shards;
+    std::error_code error;
+    for (fs::directory_iterator it(fs::path(m_directory) / directory, error), end; !error && it != end;
+         it.increment(error)) {
+        std::string name = it->path().filename().string();
+        if (name.size() > suffix.size() && name[0] != '.'
+            && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            shards.push_back(name.substr(0, name.size() - suffix.size()));
+        }
+    }
+    std::sort(shards.begin(), shards.end());
+    return shards;
+}
+
+bool ShardQueue::serverNow(int64_t &now)
+{
+    // Touch a file of our own and read back the time the file system gave it
+    int fd = ::open(m_clockPath.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        m_errorMessage = "No se pudo acceder a la carpeta de fragmentos";
+        return false;
+    }
+    ::close(fd);
+
+    struct stat info;
+    if (::utimensat(AT_FDCWD, m_clockPath.c_str(), nullptr, 0) != 0 || ::stat(m_clockPath.c_str(), &info) != 0) {
+        m_errorMessage = "No se pudo acceder a la carpeta de fragmentos";
+        return false;
+    }
+    now = info.st_mtime;
+    return true;
+}
+
+bool ShardQueue::isExpired(const std::string &shard, int64_t now)
+{
+    struct stat info;
+    if (::stat(leasePath(shard).c_str(), &info) != 0) {
+        return false;   // already released
+    }
+    return now - static_cast<int64_t>(info.st_mtime) > static_cast<int64_t>(m_options.leaseSeconds);
+}
+
+bool ShardQueue::breakLease(const std::string &shard)
+{
+    // rename() is atomic, so of several workers breaking the same lease only
+    // one moves it; the others find it gone
+    std::string path = leasePath(shard);
+    std::string stalePath = path + ".stale-" + std::to_string(getpid());
+    if (std::rename(path.c_str(), stalePath.c_str()) != 0) {
+        return false;
+    }
+
+    // What we moved may be a lease another worker created just after the
+    // expired one was broken: put it back
+    int64_t now = 0;
+    struct stat info;
+    if (serverNow(now) && ::stat(stalePath.c_str(), &info) == 0
+        && now - static_cast<int64_t>(info.st_mtime) <= static_cast<int64_t>(m_options.leaseSeconds)) {
+        ::link(stalePath.c_str(), path.c_str());
+        ::unlink(stalePath.c_str());
+        return false;
+    }
+
+    ::unlink(stalePath.c_str());
+    return true;
+}
+
+bool ShardQueue::ownsLease(const std::string &shard) const
+{
+    std::string contents;
+    return readFile(leasePath(shard), contents) && contents == m_owner;
+}
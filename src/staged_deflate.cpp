@@ -0,0 +1,245 @@
+#include "staged_deflate.h"
+#include "cancellation_token.h"
+#include "input_source.h"
+#include "spsc_ring.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+struct Chunk
+{
+    std::vector<unsigned char> data;
+    size_t size = 0;
+    bool last = false;      // end of the stream; an input chunk marked last is empty
+};
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+bool writeAll(int fd, const unsigned char *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t count = ::write(fd, data, size);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+} // namespace
+
+StagedDeflate::StagedDeflate()
+    : StagedDeflate(Options())
+{
+}
+
+StagedDeflate::StagedDeflate(const Options &options)
+    : m_options(options)
+    , m_totalIn(0)
+    , m_totalOut(0)
+{
+    m_options.chunkSize = std::max<size_t>(m_options.chunkSize, 64 * 1024);
+    m_options.chunks = std::max(m_options.chunks, 2u);
+}
+
+bool StagedDeflate::compressFile(const std::string &inputPath, const std::string &outputPath,
+                                 const DeflateStream::ProgressCallback &progress,
+                                 const std::vector<unsigned char> &header)
+{
+    m_totalIn = 0;
+    m_totalOut = 0;
+    m_times = StageTimes();
+    m_errorMessage.clear();
+    Clock::time_point started = Clock::now();
+
+    InputSource input;
+    if (!input.open(inputPath)) {
+        m_errorMessage = input.errorMessage();
+        return false;
+    }
+    uint64_t totalBytes = input.knownSize();
+
+    int outputFd = ::open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (outputFd < 0) {
+        m_errorMessage = "No se pudo crear el archivo de salida";
+        return false;
+    }
+
+    // Each ring holds every chunk of its kind, so handing one back never waits
+    std::vector<Chunk> inputChunks(m_options.chunks);
+    std::vector<Chunk> outputChunks(m_options.chunks);
+    SpscRing<Chunk *> freeInput(m_options.chunks);      // deflate -> reader
+    SpscRing<Chunk *> fullInput(m_options.chunks);      // reader -> deflate
+    SpscRing<Chunk *> fullOutput(m_options.chunks);     // deflate -> writer
+    SpscRing<Chunk *> freeOutput(m_options.chunks);     // writer -> deflate
+    for (Chunk &chunk : inputChunks) {
+        chunk.data.resize(m_options.chunkSize);
+        freeInput.tryPush(&chunk);
+    }
+    for (Chunk &chunk : outputChunks) {
+        chunk.data.resize(m_options.chunkSize);
+        freeOutput.tryPush(&chunk);
+    }
+
+    // Set by whichever stage fails first; the others stop waiting on it.
+    // Each error string is written by its own stage only and read after join.
+    std::atomic<bool> abort(false);
+    std::string readError;
+    std::string writeError;
+
+    std::thread reader([&]() {
+        Chunk *chunk = nullptr;
+        while (freeInput.pop(chunk, abort)) {
+            if (CancellationToken::cancelled(m_options.cancel)) {
+                readError = CancellationToken::CancelledMessage;
+                abort = true;
+                return;
+            }
+
+            Clock::time_point start = Clock::now();
+            long long got = input.read(chunk->data.data(), chunk->data.size());
+            m_times.read += secondsSince(start);
+            if (got < 0) {
+                readError = input.errorMessage();
+                abort = true;
+                return;
+            }
+
+            bool last = got == 0;
+            chunk->size = static_cast<size_t>(got);
+            chunk->last = last;
+            if (!fullInput.push(chunk, abort) || last) {
+                return;
+            }
+        }
+    });
+
+    std::thread writer([&]() {
+        Chunk *chunk = nullptr;
+        while (fullOutput.pop(chunk, abort)) {
+            Clock::time_point start = Clock::now();
+            bool written = writeAll(outputFd, chunk->data.data(), chunk->size);
+            m_times.write += secondsSince(start);
+            if (!written) {
+                writeError = "Error al escribir los datos comprimidos";
+                abort = true;
+                return;
+            }
+
+            bool last = chunk->last;
+            if (!freeOutput.push(chunk, abort) || last) {
+                return;
+            }
+        }
+    });
+
+    // Deflate on this thread, packing its output into chunks for the writer
+    DeflateStream stream(m_options.format, m_options.level, m_options.chunkSize);
+    stream.setCancellationToken(m_options.cancel);
+    Chunk *output = nullptr;
+    DeflateStream::Sink sink = [&](const unsigned char *data, size_t size) {
+        while (size > 0) {
+            if (!output) {
+                if (!freeOutput.pop(output, abort)) {
+                    return false;
+                }
+                output->size = 0;
+                output->last = false;
+            }
+
+            size_t count = std::min(size, output->data.size() - output->size);
+            std::memcpy(output->data.data() + output->size, data, count);
+            output->size += count;
+            data += count;
+            size -= count;
+
+            if (output->size == output->data.size()) {
+                if (!fullOutput.push(output, abort)) {
+                    return false;
+                }
+                output = nullptr;
+            }
+        }
+        return true;
+    };
+
+    bool ok = header.empty() || sink(header.data(), header.size());
+    while (ok) {
+        Chunk *chunk = nullptr;
+        if (!fullInput.pop(chunk, abort)) {
+            ok = false;
+            break;
+        }
+
+        Clock::time_point start = Clock::now();
+        if (chunk->last) {
+            ok = stream.finish(sink);
+            m_times.compress += secondsSince(start);
+            break;
+        }
+        ok = stream.write(chunk->data.data(), chunk->size, sink);
+        m_times.compress += secondsSince(start);
+        freeInput.tryPush(chunk);
+
+        if (ok && progress) {
+            progress(stream.totalIn(), totalBytes);
+        }
+    }
+
+    // The last output chunk goes out even when empty: it tells the writer to stop
+    if (ok && !output) {
+        ok = freeOutput.pop(output, abort);
+        if (ok) {
+            output->size = 0;
+        }
+    }
+    if (ok) {
+        output->last = true;
+        ok = fullOutput.push(output, abort);
+    }
+    if (!ok) {
+        abort = true;
+    }
+
+    reader.join();
+    writer.join();
+
+    if (::close(outputFd) != 0 && ok) {
+        writeError = "Error al escribir los datos comprimidos";
+        ok = false;
+    }
+
+    if (!ok) {
+        if (!readError.empty()) {
+            m_errorMessage = readError;
+        } else if (!writeError.empty()) {
+            m_errorMessage = writeError;
+        } else {
+            m_errorMessage = stream.errorMessage();
+        }
+        ::unlink(outputPath.c_str());
+        return false;
+    }
+
+    m_totalIn = stream.totalIn();
+    m_totalOut = stream.totalOut();
+    m_times.wall = secondsSince(started);
+    return true;
+}
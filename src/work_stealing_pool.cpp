@@ -0,0 +1,155 @@
+#include "work_stealing_pool.h"
+#include "cpu_count.h"
+#include <memory>
+#include <thread>
+
+namespace {
+
+thread_local WorkStealingPool *currentPool = nullptr;
+thread_local unsigned currentWorker = 0;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(unsigned workers, bool pinWorkers)
+    : m_workers(workers > 0 ? workers : CpuCount::available())
+    , m_pinWorkers(pinWorkers)
+    , m_local(m_workers)
+    , m_running(0)
+{
+}
+
+WorkStealingPool *WorkStealingPool::current()
+{
+    return currentPool;
+}
+
+void WorkStealingPool::submit(Task task)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_topLevel.push_back(std::move(task));
+}
+
+void WorkStealingPool::spawn(Task task)
+{
+    if (currentPool != this) {
+        // Not one of our workers: run it in place rather than lose it
+        task(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_local[currentWorker].push_back(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+void WorkStealingPool::run()
+{
+    size_t topLevel = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        topLevel = m_topLevel.size();
+    }
+
+    // Files can spawn blocks for every worker, so start them all unless
+    // there is nothing to do
+    unsigned threads = topLevel == 0 ? 1 : m_workers;
+    std::vector<std::thread> pool;
+    for (unsigned worker = 1; worker < threads; ++worker) {
+        pool.emplace_back([this, worker]() { work(worker); });
+    }
+    work(0);
+    for (std::thread &thread : pool) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::work(unsigned worker)
+{
+    WorkStealingPool *previousPool = currentPool;
+    unsigned previousWorker = currentWorker;
+    currentPool = this;
+    currentWorker = worker;
+
+    // Worker 0 is the caller's thread: its own mask comes back when the pin goes
+    std::unique_ptr<CpuCount::ThreadPin> pin;
+    if (m_pinWorkers) {
+        pin = std::make_unique<CpuCount::ThreadPin>(worker);
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        Task task;
+        if (takeLocked(worker, true, task)) {
+            runTask(task, worker, lock);
+            continue;
+        }
+        // Nothing queued and nothing running that could spawn more
+        if (m_running == 0) {
+            break;
+        }
+        m_condition.wait(lock);
+    }
+    lock.unlock();
+    m_condition.notify_all();
+
+    currentPool = previousPool;
+    currentWorker = previousWorker;
+}
+
+void WorkStealingPool::helpUntil(const std::function<bool()> &done)
+{
+    if (currentPool != this) {
+        return;
+    }
+
+    unsigned worker = currentWorker;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!done()) {
+        Task task;
+        if (takeLocked(worker, false, task)) {
+            runTask(task, worker, lock);
+            continue;
+        }
+        // Whatever we wait for is running on another worker
+        m_condition.wait(lock);
+    }
+}
+
+bool WorkStealingPool::takeLocked(unsigned worker, bool topLevel, Task &task)
+{
+    // Own subtasks first, then steal. Owners and thieves both take the oldest
+    // task: blocks are written in order, so the oldest is the one awaited.
+    for (unsigned i = 0; i < m_workers; ++i) {
+        std::deque<Task> &queue = m_local[(worker + i) % m_workers];
+        if (!queue.empty()) {
+            task = std::move(queue.front());
+            queue.pop_front();
+            return true;
+        }
+    }
+
+    if (topLevel && !m_topLevel.empty()) {
+        task = std::move(m_topLevel.front());
+        m_topLevel.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::runTask(Task &task, unsigned worker, std::unique_lock<std::mutex> &lock)
+{
+    ++m_running;
+    lock.unlock();
+
+    task(worker);
+    task = nullptr;
+
+    lock.lock();
+    --m_running;
+
+    // Wakes helpers whose block may just have finished, and idle workers
+    // once the batch is complete
+    m_condition.notify_all();
+}
@@ -0,0 +1,283 @@
+#include "xz_stream.h"
+#include "cancellation_token.h"
+#include "input_source.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+
+namespace {
+
+const char *const UnavailableMessage = "Esta versión se compiló sin soporte para xz";
+
+#ifdef HAVE_LZMA
+uint32_t presetFor(const XzStream::Options &options)
+{
+    uint32_t preset = static_cast<uint32_t>(std::clamp(options.level, XzStream::MinLevel, XzStream::MaxLevel));
+    return options.extreme ? preset | LZMA_PRESET_EXTREME : preset;
+}
+
+lzma_mt multithreadedOptions(const XzStream::Options &options)
+{
+    lzma_mt mt;
+    std::fill_n(reinterpret_cast<unsigned char *>(&mt), sizeof(mt), 0);
+    mt.threads = options.threads;
+    mt.block_size = options.blockSize;
+    mt.preset = presetFor(options);
+    mt.check = LZMA_CHECK_CRC64;
+    return mt;
+}
+
+std::string describe(lzma_ret ret)
+{
+    switch (ret) {
+    case LZMA_MEM_ERROR:
+    case LZMA_MEMLIMIT_ERROR:
+        return "No hay memoria suficiente para la compresión xz";
+    case LZMA_OPTIONS_ERROR:
+        return "Opciones de xz no válidas";
+    default:
+        return "Error en la compresión xz (código " + std::to_string(static_cast<int>(ret)) + ")";
+    }
+}
+#endif
+
+} // namespace
+
+struct XzStream::State
+{
+#ifdef HAVE_LZMA
+    lzma_stream stream = LZMA_STREAM_INIT;
+#endif
+    bool ready = false;
+};
+
+bool XzStream::available()
+{
+#ifdef HAVE_LZMA
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t XzStream::memoryEstimate(const Options &options)
+{
+#ifdef HAVE_LZMA
+    uint64_t usage = UINT64_MAX;
+    if (options.threads > 1) {
+        lzma_mt mt = multithreadedOptions(options);
+        usage = lzma_stream_encoder_mt_memusage(&mt);
+    }
+    if (usage == UINT64_MAX) {
+        usage = lzma_easy_encoder_memusage(presetFor(options));
+    }
+    return usage == UINT64_MAX ? 0 : usage + DeflateStream::DefaultBufferSize;
+#else
+    (void)options;
+    return 0;
+#endif
+}
+
+XzStream::XzStream()
+    : XzStream(Options())
+{
+}
+
+XzStream::XzStream(const Options &options, size_t bufferSize)
+    : m_state(std::make_unique<State>())
+    , m_options(options)
+    , m_threads(1)
+    , m_finished(false)
+    , m_bufferSize(std::max<size_t>(bufferSize, 4096))
+    , m_totalIn(0)
+    , m_totalOut(0)
+    , m_memoryUsage(0)
+    , m_cancel(nullptr)
+{
+    m_options.level = std::clamp(m_options.level, MinLevel, MaxLevel);
+    m_outBuffer.resize(m_bufferSize);
+
+#ifdef HAVE_LZMA
+    lzma_ret ret = LZMA_OPTIONS_ERROR;
+    if (m_options.threads > 1) {
+        lzma_mt mt = multithreadedOptions(m_options);
+        ret = lzma_stream_encoder_mt(&m_state->stream, &mt);
+        if (ret == LZMA_OK) {
+            m_threads = m_options.threads;
+        }
+    }
+    // liblzma built without threads rejects the multithreaded encoder
+    if (ret != LZMA_OK && ret != LZMA_MEM_ERROR) {
+        ret = lzma_easy_encoder(&m_state->stream, presetFor(m_options), LZMA_CHECK_CRC64);
+    }
+    if (ret != LZMA_OK) {
+        m_errorMessage = describe(ret);
+        return;
+    }
+    m_state->ready = true;
+
+    // Encoders do not answer lzma_memusage(); use what liblzma allocates for them
+    Options used = m_options;
+    used.threads = m_threads;
+    m_memoryUsage = memoryEstimate(used);
+#else
+    m_errorMessage = UnavailableMessage;
+#endif
+}
+
+XzStream::~XzStream()
+{
+#ifdef HAVE_LZMA
+    lzma_end(&m_state->stream);
+#endif
+}
+
+bool XzStream::write(const unsigned char *data, size_t size, const DeflateStream::Sink &sink)
+{
+    if (!m_state->ready || m_finished) {
+        if (m_errorMessage.empty()) {
+            m_errorMessage = "El flujo de compresión ya fue cerrado";
+        }
+        return false;
+    }
+
+    while (size > 0) {
+        if (CancellationToken::cancelled(m_cancel)) {
+            m_errorMessage = CancellationToken::CancelledMessage;
+            return false;
+        }
+        size_t slice = std::min(size, m_bufferSize);
+        if (!code(data, slice, false, sink)) {
+            return false;
+        }
+        data += slice;
+        size -= slice;
+    }
+    return true;
+}
+
+bool XzStream::finish(const DeflateStream::Sink &sink)
+{
+    if (!m_state->ready || m_finished) {
+        if (m_errorMessage.empty()) {
+            m_errorMessage = "El flujo de compresión ya fue cerrado";
+        }
+        return false;
+    }
+
+    bool ok = code(nullptr, 0, true, sink);
+    m_finished = true;
+    return ok;
+}
+
+bool XzStream::code(const unsigned char *data, size_t size, bool end, const DeflateStream::Sink &sink)
+{
+#ifdef HAVE_LZMA
+    lzma_stream &stream = m_state->stream;
+    stream.next_in = data;
+    stream.avail_in = size;
+    lzma_action action = end ? LZMA_FINISH : LZMA_RUN;
+
+    // run: until the input is taken; finish: until the stream is complete
+    while (true) {
+        stream.next_out = m_outBuffer.data();
+        stream.avail_out = m_outBuffer.size();
+        lzma_ret ret = lzma_code(&stream, action);
+        if (ret != LZMA_OK && ret != LZMA_STREAM_END) {
+            m_errorMessage = describe(ret);
+            return false;
+        }
+
+        size_t produced = m_outBuffer.size() - stream.avail_out;
+        if (produced > 0) {
+            if (!sink(m_outBuffer.data(), produced)) {
+                if (m_errorMessage.empty()) {
+                    m_errorMessage = "Error al escribir los datos comprimidos";
+                }
+                return false;
+            }
+            m_totalOut += produced;
+        }
+
+        if (ret == LZMA_STREAM_END || (!end && stream.avail_in == 0 && stream.avail_out > 0)) {
+            break;
+        }
+    }
+
+    m_totalIn += size;
+    return true;
+#else
+    (void)data;
+    (void)size;
+    (void)end;
+    (void)sink;
+    m_errorMessage = UnavailableMessage;
+    return false;
+#endif
+}
+
+bool XzStream::compressFile(const std::string &inputPath, const std::string &outputPath,
+                            const DeflateStream::ProgressCallback &progress)
+{
+    if (!m_state->ready) {
+        return false;
+    }
+
+    InputSource inputFile;
+    if (!inputFile.open(inputPath)) {
+        m_errorMessage = inputFile.errorMessage();
+        return false;
+    }
+    uint64_t totalBytes = inputFile.knownSize();
+
+    std::ofstream outputFile(outputPath, std::ios::binary | std::ios::trunc);
+    if (!outputFile.is_open()) {
+        m_errorMessage = "No se pudo crear el archivo de salida";
+        return false;
+    }
+
+    DeflateStream::Sink sink = [&outputFile](const unsigned char *data, size_t size) {
+        outputFile.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(outputFile);
+    };
+
+    auto abandon = [&](const std::string &message) {
+        if (!message.empty()) {
+            m_errorMessage = message;
+        }
+        outputFile.close();
+        std::remove(outputPath.c_str());
+        return false;
+    };
+
+    std::vector<unsigned char> inBuffer(InputSource::ReadBlockSize);
+    while (true) {
+        long long got = inputFile.read(inBuffer.data(), inBuffer.size());
+        if (got < 0) {
+            return abandon(inputFile.errorMessage());
+        }
+        if (got == 0) {
+            break;
+        }
+        if (!write(inBuffer.data(), static_cast<size_t>(got), sink)) {
+            return abandon(std::string());
+        }
+        if (progress) {
+            progress(m_totalIn, totalBytes);
+        }
+    }
+
+    if (!finish(sink)) {
+        return abandon(std::string());
+    }
+
+    outputFile.close();
+    if (!outputFile) {
+        return abandon("Error al escribir los datos comprimidos");
+    }
+    return true;
+}
@@ -0,0 +1,327 @@
+#include "zip_archive_builder.h"
+#include "cancellation_token.h"
+#include "deflate_stream.h"
+#include "input_source.h"
+#include "parallel_batch.h"
+#include "parallel_deflate.h"
+#include "zip_writer.h"
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <sys/stat.h>
+
+namespace {
+
+// One entry on its way from a worker to the writer
+struct Slot
+{
+    bool ready = false;
+    bool streamed = false;      // too large to buffer; the writer compresses it
+    uint16_t method = ZipWriter::MethodDeflate;
+    uint32_t crc = 0;
+    uint64_t size = 0;
+    time_t modificationTime = 0;
+    std::vector<unsigned char> data;
+};
+
+time_t modificationTimeOf(int fd)
+{
+    struct stat info;
+    return fstat(fd, &info) == 0 ? info.st_mtime : 0;
+}
+
+void compressEntry(const std::string &inputPath, const ZipArchiveBuilder::Options &options, Slot &slot,
+                   ZipArchiveBuilder::EntryResult &result)
+{
+    InputSource input;
+    if (!input.open(inputPath)) {
+        result.errorMessage = input.errorMessage();
+        return;
+    }
+    slot.modificationTime = modificationTimeOf(input.fileDescriptor());
+
+    const unsigned char *data = input.data();
+    uint64_t size = input.size();
+
+    DeflateStream::Sink sink = [&slot](const unsigned char *bytes, size_t count) {
+        slot.data.insert(slot.data.end(), bytes, bytes + count);
+        return true;
+    };
+    if (options.zstd) {
+        ZstdStream stream(options.zstdOptions);
+        stream.setCancellationToken(options.cancel);
+        stream.setExpectedSize(size);
+        if (!stream.write(data, static_cast<size_t>(size), sink) || !stream.finish(sink)) {
+            result.errorMessage = stream.errorMessage();
+            slot.data.clear();
+            return;
+        }
+        slot.method = ZipWriter::MethodZstd;
+        slot.crc = stream.crc();
+    } else {
+        DeflateStream stream(DeflateStream::Format::Raw, options.level);
+        stream.setCancellationToken(options.cancel);
+        if (!stream.write(data, static_cast<size_t>(size), sink) || !stream.finish(sink)) {
+            result.errorMessage = stream.errorMessage();
+            slot.data.clear();
+            return;
+        }
+        slot.crc = stream.crc();
+    }
+
+    slot.size = size;
+    if (slot.data.size() >= size) {
+        // Deflate did not help (already compressed data): store it as is
+        slot.method = ZipWriter::MethodStore;
+        slot.data.assign(data, data + size);
+    }
+
+    result.success = true;
+    result.originalSize = size;
+    result.compressedSize = slot.data.size();
+}
+
+// Streams an entry too large to buffer through a single zstd frame
+bool compressInput(InputSource &input, ZstdStream &stream, const DeflateStream::Sink &sink)
+{
+    std::vector<unsigned char> buffer(InputSource::ReadBlockSize);
+    while (true) {
+        long long got = input.read(buffer.data(), buffer.size());
+        if (got < 0) {
+            return false;
+        }
+        if (got == 0) {
+            return stream.finish(sink);
+        }
+        if (!stream.write(buffer.data(), static_cast<size_t>(got), sink)) {
+            return false;
+        }
+    }
+}
+
+} // namespace
+
+ZipArchiveBuilder::ZipArchiveBuilder()
+    : ZipArchiveBuilder(Options())
+{
+}
+
+std::vector<ZipArchiveBuilder::Entry> ZipArchiveBuilder::collectEntries(const std::vector<std::string> &inputPaths,
+                                                                       const std::string &outputPath)
+{
+    namespace fs = std::filesystem;
+
+    std::error_code error;
+    const fs::path output = fs::absolute(outputPath, error).lexically_normal();
+    const std::string partialPrefix = output.string() + ".part";
+    auto isOutput = [&](const fs::path &file) {
+        std::error_code ignored;
+        if (fs::equivalent(file, output, ignored)) {
+            return true;
+        }
+        std::string absolute = fs::absolute(file, ignored).lexically_normal().string();
+        return absolute.compare(0, partialPrefix.size(), partialPrefix) == 0;
+    };
+
+    std::vector<Entry> entries;
+    for (const std::string &inputPath : inputPaths) {
+        fs::path input(inputPath);
+        if (!fs::is_directory(input)) {
+            if (!isOutput(input)) {
+                entries.push_back({inputPath, input.filename().string()});
+            }
+            continue;
+        }
+
+        // Sorted so the archive layout does not depend on directory order
+        fs::path base = input.lexically_normal().parent_path();
+        std::vector<fs::path> files;
+        for (const fs::directory_entry &item : fs::recursive_directory_iterator(input)) {
+            if (item.is_regular_file() && !isOutput(item.path())) {
+                files.push_back(item.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        for (const fs::path &file : files) {
+            entries.push_back({file.string(), file.lexically_normal().lexically_relative(base).generic_string()});
+        }
+    }
+    return entries;
+}
+
+ZipArchiveBuilder::ZipArchiveBuilder(const Options &options)
+    : m_options(options)
+    , m_totalIn(0)
+    , m_archiveSize(0)
+{
+}
+
+bool ZipArchiveBuilder::build(const std::string &outputPath, const std::vector<Entry> &entries,
+                              const ProgressCallback &progress)
+{
+    m_results.assign(entries.size(), EntryResult());
+    m_totalIn = 0;
+    m_archiveSize = 0;
+    m_errorMessage.clear();
+
+    ZipWriter zip;
+    if (!zip.open(outputPath)) {
+        m_errorMessage = zip.errorMessage();
+        return false;
+    }
+
+    ParallelBatch batch(m_options.workers);
+    const size_t window = static_cast<size_t>(batch.workerCount()) * 4;
+
+    std::vector<Slot> slots(entries.size());
+    std::mutex mutex;
+    std::condition_variable condition;
+    size_t written = 0;
+    uint64_t buffered = 0;
+    bool failed = false;
+
+    // Streams a large entry straight into the archive
+    auto streamEntry = [&](const Entry &entry, EntryResult &result) {
+        InputSource input;
+        if (!input.open(entry.inputPath)) {
+            result.errorMessage = input.errorMessage();
+            return true;
+        }
+
+        DeflateStream::Sink sink = [&zip](const unsigned char *data, size_t size) {
+            return zip.writeEntryData(data, size);
+        };
+        uint16_t method = m_options.zstd ? ZipWriter::MethodZstd : ZipWriter::MethodDeflate;
+        if (!zip.beginEntry(entry.name, method, modificationTimeOf(input.fileDescriptor()), input.knownSize())) {
+            return false;
+        }
+
+        bool compressed = false;
+        uint32_t crc = 0;
+        std::string errorMessage;
+        if (m_options.zstd) {
+            ZstdStream stream(m_options.zstdOptions);
+            stream.setCancellationToken(m_options.cancel);
+            stream.setExpectedSize(input.knownSize());
+            compressed = compressInput(input, stream, sink);
+            errorMessage = !stream.errorMessage().empty() ? stream.errorMessage() : input.errorMessage();
+            crc = stream.crc();
+            result.originalSize = stream.totalIn();
+            result.compressedSize = stream.totalOut();
+        } else {
+            ParallelDeflate::Options options;
+            options.level = m_options.level;
+            options.format = DeflateStream::Format::Raw;
+            options.cancel = m_options.cancel;
+            ParallelDeflate deflater(options);
+            compressed = deflater.compress(input, sink);
+            errorMessage = deflater.errorMessage();
+            crc = deflater.crc();
+            result.originalSize = deflater.totalIn();
+            result.compressedSize = deflater.totalOut();
+        }
+
+        if (!compressed) {
+            if (!zip.errorMessage().empty() || CancellationToken::cancelled(m_options.cancel)) {
+                return false;
+            }
+            // The input failed, not the archive: drop the half-written entry
+            result.errorMessage = errorMessage;
+            return zip.abortEntry();
+        }
+        if (!zip.endEntry(crc, result.originalSize)) {
+            return false;
+        }
+
+        result.success = true;
+        return true;
+    };
+
+    std::thread writer([&]() {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            Slot &slot = slots[i];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&slot]() { return slot.ready; });
+            }
+
+            EntryResult &result = m_results[i];
+            bool ok = true;
+            if (CancellationToken::cancelled(m_options.cancel)) {
+                ok = false;
+            } else if (slot.streamed) {
+                ok = streamEntry(entries[i], result);
+            } else if (result.success) {
+                ok = zip.addPrecompressed(entries[i].name, slot.data.data(), slot.data.size(),
+                                          slot.crc, slot.size, slot.method, slot.modificationTime);
+            }
+            if (result.success) {
+                m_totalIn += result.originalSize;
+            }
+
+            uint64_t released = slot.data.size();
+            std::vector<unsigned char>().swap(slot.data);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                buffered -= released;
+                written = i + 1;
+                failed = !ok;
+            }
+            condition.notify_all();
+
+            if (!ok) {
+                return;
+            }
+            if (progress) {
+                progress(i + 1, entries.size());
+            }
+        }
+    });
+
+    batch.run(entries.size(), [&](size_t index, unsigned) {
+        Slot &slot = slots[index];
+        {
+            // Stay within the window; the next entry to write always proceeds
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&]() {
+                return failed || (index < written + window && (buffered < m_options.maxBufferedBytes || index == written));
+            });
+        }
+
+        bool skip = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            skip = failed || CancellationToken::cancelled(m_options.cancel);
+        }
+        if (!skip) {
+            struct stat info;
+            if (stat(entries[index].inputPath.c_str(), &info) == 0 && S_ISREG(info.st_mode)
+                && static_cast<uint64_t>(info.st_size) >= m_options.streamThreshold) {
+                slot.streamed = true;
+            } else {
+                compressEntry(entries[index].inputPath, m_options, slot, m_results[index]);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slot.ready = true;
+            buffered += slot.data.size();
+        }
+        condition.notify_all();
+    });
+
+    writer.join();
+
+    if (failed || !zip.close()) {
+        m_errorMessage = CancellationToken::cancelled(m_options.cancel) ? CancellationToken::CancelledMessage
+                                                                         : zip.errorMessage();
+        zip.discard();
+        return false;
+    }
+
+    m_archiveSize = zip.bytesWritten();
+    return true;
+}
@@ -0,0 +1,123 @@
+#include "zip_stream_source.h"
+#include "cancellation_token.h"
+#include "input_source.h"
+#include <ctime>
+#include <sys/stat.h>
+
+namespace {
+
+// Read-ahead window requested from the kernel while libzip compresses
+constexpr uint64_t PrefetchSize = 4 * InputSource::ReadBlockSize;
+
+struct StreamState
+{
+    InputSource input;
+    uint64_t *bytesRead = nullptr;
+    const CancellationToken *cancel = nullptr;
+    time_t modificationTime = 0;
+    zip_error_t error;
+};
+
+zip_int64_t streamCallback(void *userdata, void *data, zip_uint64_t length, zip_source_cmd_t command)
+{
+    StreamState *state = static_cast<StreamState *>(userdata);
+
+    switch (command) {
+        case ZIP_SOURCE_OPEN:
+            if (!state->input.rewind()) {
+                zip_error_set(&state->error, ZIP_ER_READ, 0);
+                return -1;
+            }
+            if (state->bytesRead) {
+                *state->bytesRead = 0;
+            }
+            state->input.willNeed(0, PrefetchSize);
+            return 0;
+
+        case ZIP_SOURCE_READ: {
+            if (CancellationToken::cancelled(state->cancel)) {
+                zip_error_set(&state->error, ZIP_ER_READ, 0);
+                return -1;
+            }
+            long long got = state->input.read(static_cast<unsigned char *>(data), static_cast<size_t>(length));
+            if (got < 0) {
+                zip_error_set(&state->error, ZIP_ER_READ, 0);
+                return -1;
+            }
+            if (state->bytesRead) {
+                *state->bytesRead += static_cast<uint64_t>(got);
+            }
+            // Keep the kernel one window ahead of libzip's deflate
+            state->input.willNeed(state->input.position(), PrefetchSize);
+            return got;
+        }
+
+        case ZIP_SOURCE_CLOSE:
+            return 0;
+
+        case ZIP_SOURCE_STAT: {
+            if (length < sizeof(zip_stat_t)) {
+                zip_error_set(&state->error, ZIP_ER_INVAL, 0);
+                return -1;
+            }
+            zip_stat_t *stat = static_cast<zip_stat_t *>(data);
+            zip_stat_init(stat);
+            stat->mtime = state->modificationTime;
+            stat->valid |= ZIP_STAT_MTIME;
+            if (state->input.knownSize() > 0) {
+                stat->size = state->input.knownSize();
+                stat->valid |= ZIP_STAT_SIZE;
+            }
+            return sizeof(zip_stat_t);
+        }
+
+        case ZIP_SOURCE_ERROR:
+            return zip_error_to_data(&state->error, data, length);
+
+        case ZIP_SOURCE_FREE:
+            zip_error_fini(&state->error);
+            delete state;
+            return 0;
+
+        case ZIP_SOURCE_SUPPORTS:
+            return zip_source_make_command_bitmap(ZIP_SOURCE_OPEN, ZIP_SOURCE_READ, ZIP_SOURCE_CLOSE,
+                                                  ZIP_SOURCE_STAT, ZIP_SOURCE_ERROR, ZIP_SOURCE_FREE, -1);
+
+        default:
+            zip_error_set(&state->error, ZIP_ER_OPNOTSUPP, 0);
+            return -1;
+    }
+}
+
+} // namespace
+
+zip_source_t *ZipStreamSource::create(zip_t *zip, const std::string &inputPath, uint64_t *bytesRead,
+                                      const CancellationToken *cancel)
+{
+    StreamState *state = new StreamState;
+    zip_error_init(&state->error);
+    state->bytesRead = bytesRead;
+    state->cancel = cancel;
+
+    if (!state->input.open(inputPath)) {
+        zip_error_fini(&state->error);
+        delete state;
+        return nullptr;
+    }
+
+    struct stat info;
+    if (fstat(state->input.fileDescriptor(), &info) == 0) {
+        state->modificationTime = info.st_mtime;
+    } else {
+        state->modificationTime = time(nullptr);
+    }
+
+    zip_source_t *source = zip_source_function(zip, streamCallback, state);
+    if (!source) {
+        zip_error_fini(&state->error);
+        delete state;
+        return nullptr;
+    }
+
+    return source;
+}
@@ -0,0 +1,408 @@
+#include "zip_writer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t LocalHeaderSignature = 0x04034b50;
+constexpr uint32_t CentralHeaderSignature = 0x02014b50;
+constexpr uint32_t EndOfCentralDirectorySignature = 0x06054b50;
+constexpr uint32_t Zip64EndOfCentralDirectorySignature = 0x06064b50;
+constexpr uint32_t Zip64LocatorSignature = 0x07064b50;
+constexpr uint16_t Zip64ExtraId = 0x0001;
+constexpr uint16_t VersionNeeded = 20;
+constexpr uint16_t VersionNeededZip64 = 45;
+constexpr uint16_t VersionNeededZstd = 63;
+constexpr uint16_t VersionMadeBy = (3 << 8) | 45;   // Unix, spec 4.5
+constexpr uint16_t FlagUtf8 = 0x0800;
+constexpr uint32_t MaxClassicValue = 0xffffffffu;
+constexpr uint16_t MaxClassicCount = 0xffff;
+constexpr size_t CoalesceLimit = 64 * 1024;
+
+void put16(std::vector<unsigned char> &out, uint16_t value)
+{
+    out.push_back(static_cast<unsigned char>(value & 0xff));
+    out.push_back(static_cast<unsigned char>((value >> 8) & 0xff));
+}
+
+void put32(std::vector<unsigned char> &out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<unsigned char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+void put64(std::vector<unsigned char> &out, uint64_t value)
+{
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<unsigned char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+// Incompressible data grows slightly under deflate, so inputs this close to
+// the limit reserve ZIP64 sizes up front
+bool mayNeedZip64(uint64_t size)
+{
+    return size >= MaxClassicValue - (MaxClassicValue >> 8);
+}
+
+uint16_t versionNeeded(uint16_t method, bool zip64)
+{
+    if (method == ZipWriter::MethodZstd) {
+        return VersionNeededZstd;
+    }
+    return zip64 ? VersionNeededZip64 : VersionNeeded;
+}
+
+void toDosDateTime(time_t timestamp, uint16_t &dosTime, uint16_t &dosDate)
+{
+    if (timestamp == 0) {
+        timestamp = time(nullptr);
+    }
+
+    struct tm local;
+    localtime_r(&timestamp, &local);
+    if (local.tm_year < 80) {
+        // DOS dates start in 1980
+        dosTime = 0;
+        dosDate = (1 << 5) | 1;
+        return;
+    }
+
+    dosTime = static_cast<uint16_t>((local.tm_hour << 11) | (local.tm_min << 5) | (local.tm_sec / 2));
+    dosDate = static_cast<uint16_t>(((local.tm_year - 80) << 9) | ((local.tm_mon + 1) << 5) | local.tm_mday);
+}
+
+} // namespace
+
+ZipWriter::ZipWriter()
+    : m_fd(-1)
+    , m_offset(0)
+    , m_entryOpen(false)
+{
+}
+
+ZipWriter::~ZipWriter()
+{
+    if (m_fd >= 0) {
+        discard();
+    }
+}
+
+bool ZipWriter::open(const std::string &path)
+{
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        m_errorMessage = "No se pudo crear el archivo ZIP";
+        return false;
+    }
+
+    m_path = path;
+    m_offset = 0;
+    m_entryOpen = false;
+    m_entries.clear();
+    return true;
+}
+
+bool ZipWriter::addPrecompressed(const std::string &name, const unsigned char *data, size_t size,
+                                 uint32_t crc, uint64_t uncompressedSize,
+                                 uint16_t method, time_t modificationTime)
+{
+    if (m_fd < 0 || m_entryOpen) {
+        return fail("El archivo ZIP no está listo para una nueva entrada");
+    }
+    if (name.size() > 0xffff) {
+        return fail("El nombre de la entrada ZIP es demasiado largo");
+    }
+
+    Entry entry;
+    entry.name = name;
+    entry.method = method;
+    entry.crc = crc;
+    entry.compressedSize = size;
+    entry.uncompressedSize = uncompressedSize;
+    entry.localHeaderOffset = m_offset;
+    entry.zip64 = mayNeedZip64(std::max<uint64_t>(size, uncompressedSize));
+    toDosDateTime(modificationTime, entry.dosTime, entry.dosDate);
+
+    // Sizes are known, so the header goes out complete and is never patched.
+    // Small entries share one write() with their header.
+    std::vector<unsigned char> header = localHeader(entry);
+    if (size <= CoalesceLimit) {
+        header.insert(header.end(), data, data + size);
+        if (!writeBytes(header.data(), header.size())) {
+            return false;
+        }
+    } else if (!writeBytes(header.data(), header.size()) || !writeBytes(data, size)) {
+        return false;
+    }
+
+    m_entries.push_back(entry);
+    return true;
+}
+
+bool ZipWriter::beginEntry(const std::string &name, uint16_t method, time_t modificationTime,
+                           uint64_t expectedSize)
+{
+    if (m_fd < 0 || m_entryOpen) {
+        return fail("El archivo ZIP no está listo para una nueva entrada");
+    }
+    if (name.size() > 0xffff) {
+        return fail("El nombre de la entrada ZIP es demasiado largo");
+    }
+
+    m_current = Entry();
+    m_current.name = name;
+    m_current.method = method;
+    m_current.localHeaderOffset = m_offset;
+    m_current.zip64 = mayNeedZip64(expectedSize);
+    toDosDateTime(modificationTime, m_current.dosTime, m_current.dosDate);
+
+    std::vector<unsigned char> header = localHeader(m_current);
+    if (!writeBytes(header.data(), header.size())) {
+        return false;
+    }
+
+    m_entryOpen = true;
+    return true;
+}
+
+bool ZipWriter::writeEntryData(const unsigned char *data, size_t size)
+{
+    if (!m_entryOpen) {
+        return fail("No hay una entrada ZIP abierta");
+    }
+    if (!writeBytes(data, size)) {
+        return false;
+    }
+    m_current.compressedSize += size;
+    return true;
+}
+
+bool ZipWriter::endEntry(uint32_t crc, uint64_t uncompressedSize)
+{
+    if (!m_entryOpen) {
+        return fail("No hay una entrada ZIP abierta");
+    }
+
+    m_current.crc = crc;
+    m_current.uncompressedSize = uncompressedSize;
+    if (!m_current.zip64 && (m_current.compressedSize >= MaxClassicValue || uncompressedSize >= MaxClassicValue)) {
+        // The classic local header has no room left for 64-bit sizes
+        return fail("El archivo supera el límite de 4 GiB del formato ZIP");
+    }
+
+    if (!writeAt(m_current.localHeaderOffset, localHeader(m_current))) {
+        return false;
+    }
+
+    m_entries.push_back(m_current);
+    m_entryOpen = false;
+    return true;
+}
+
+bool ZipWriter::abortEntry()
+{
+    if (!m_entryOpen) {
+        return fail("No hay una entrada ZIP abierta");
+    }
+
+    m_entryOpen = false;
+    m_offset = m_current.localHeaderOffset;
+    if (ftruncate(m_fd, static_cast<off_t>(m_offset)) != 0
+        || lseek(m_fd, static_cast<off_t>(m_offset), SEEK_SET) < 0) {
+        return fail("Error al escribir el archivo ZIP");
+    }
+    return true;
+}
+
+bool ZipWriter::close()
+{
+    if (m_fd < 0) {
+        return fail("El archivo ZIP no está abierto");
+    }
+    if (m_entryOpen) {
+        return fail("La última entrada ZIP no fue cerrada");
+    }
+
+    uint64_t directoryOffset = m_offset;
+    std::vector<unsigned char> directory;
+    for (const Entry &entry : m_entries) {
+        std::vector<unsigned char> header = centralHeader(entry);
+        directory.insert(directory.end(), header.begin(), header.end());
+    }
+
+    uint64_t directorySize = directory.size();
+    uint64_t entryCount = m_entries.size();
+    bool zip64 = entryCount >= MaxClassicCount || directoryOffset >= MaxClassicValue
+              || directorySize >= MaxClassicValue;
+
+    if (zip64) {
+        uint64_t recordOffset = directoryOffset + directorySize;
+
+        put32(directory, Zip64EndOfCentralDirectorySignature);
+        put64(directory, 44);                       // size of the rest of the record
+        put16(directory, VersionMadeBy);
+        put16(directory, VersionNeededZip64);
+        put32(directory, 0);                        // this disk
+        put32(directory, 0);                        // disk with central directory
+        put64(directory, entryCount);
+        put64(directory, entryCount);
+        put64(directory, directorySize);
+        put64(directory, directoryOffset);
+
+        put32(directory, Zip64LocatorSignature);
+        put32(directory, 0);                        // disk with the ZIP64 record
+        put64(directory, recordOffset);
+        put32(directory, 1);                        // total disks
+    }
+
+    // Values that do not fit are saturated; readers take them from the ZIP64 record
+    uint16_t classicCount = static_cast<uint16_t>(std::min<uint64_t>(entryCount, MaxClassicCount));
+    put32(directory, EndOfCentralDirectorySignature);
+    put16(directory, 0);                            // this disk
+    put16(directory, 0);                            // disk with central directory
+    put16(directory, classicCount);
+    put16(directory, classicCount);
+    put32(directory, static_cast<uint32_t>(std::min<uint64_t>(directorySize, MaxClassicValue)));
+    put32(directory, static_cast<uint32_t>(std::min<uint64_t>(directoryOffset, MaxClassicValue)));
+    put16(directory, 0);                            // comment length
+
+    if (!writeBytes(directory.data(), directory.size())) {
+        return false;
+    }
+
+    if (::close(m_fd) != 0) {
+        m_fd = -1;
+        return fail("Error al escribir el archivo ZIP");
+    }
+    m_fd = -1;
+    return true;
+}
+
+void ZipWriter::discard()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    if (!m_path.empty()) {
+        ::unlink(m_path.c_str());
+    }
+    m_entryOpen = false;
+    m_entries.clear();
+}
+
+std::vector<unsigned char> ZipWriter::localHeader(const Entry &entry) const
+{
+    std::vector<unsigned char> header;
+    put32(header, LocalHeaderSignature);
+    put16(header, versionNeeded(entry.method, entry.zip64));
+    put16(header, FlagUtf8);
+    put16(header, entry.method);
+    put16(header, entry.dosTime);
+    put16(header, entry.dosDate);
+    put32(header, entry.crc);
+    put32(header, entry.zip64 ? MaxClassicValue : static_cast<uint32_t>(entry.compressedSize));
+    put32(header, entry.zip64 ? MaxClassicValue : static_cast<uint32_t>(entry.uncompressedSize));
+    put16(header, static_cast<uint16_t>(entry.name.size()));
+    put16(header, entry.zip64 ? 20 : 0);            // extra field length
+    header.insert(header.end(), entry.name.begin(), entry.name.end());
+
+    // Fixed size, so endEntry() can patch it in place
+    if (entry.zip64) {
+        put16(header, Zip64ExtraId);
+        put16(header, 16);
+        put64(header, entry.uncompressedSize);
+        put64(header, entry.compressedSize);
+    }
+    return header;
+}
+
+std::vector<unsigned char> ZipWriter::centralHeader(const Entry &entry) const
+{
+    // Only the fields that overflow go into the ZIP64 extra, in this order
+    std::vector<unsigned char> extra;
+    bool bigUncompressed = entry.uncompressedSize >= MaxClassicValue;
+    bool bigCompressed = entry.compressedSize >= MaxClassicValue;
+    bool bigOffset = entry.localHeaderOffset >= MaxClassicValue;
+    if (bigUncompressed) {
+        put64(extra, entry.uncompressedSize);
+    }
+    if (bigCompressed) {
+        put64(extra, entry.compressedSize);
+    }
+    if (bigOffset) {
+        put64(extra, entry.localHeaderOffset);
+    }
+    bool zip64 = !extra.empty();
+
+    std::vector<unsigned char> header;
+    put32(header, CentralHeaderSignature);
+    put16(header, VersionMadeBy);
+    put16(header, versionNeeded(entry.method, zip64 || entry.zip64));
+    put16(header, FlagUtf8);
+    put16(header, entry.method);
+    put16(header, entry.dosTime);
+    put16(header, entry.dosDate);
+    put32(header, entry.crc);
+    put32(header, bigCompressed ? MaxClassicValue : static_cast<uint32_t>(entry.compressedSize));
+    put32(header, bigUncompressed ? MaxClassicValue : static_cast<uint32_t>(entry.uncompressedSize));
+    put16(header, static_cast<uint16_t>(entry.name.size()));
+    put16(header, zip64 ? static_cast<uint16_t>(extra.size() + 4) : 0);   // extra field length
+    put16(header, 0);                               // comment length
+    put16(header, 0);                               // disk number start
+    put16(header, 0);                               // internal attributes
+    put32(header, 0100644u << 16);                  // external attributes (rw-r--r--)
+    put32(header, bigOffset ? MaxClassicValue : static_cast<uint32_t>(entry.localHeaderOffset));
+    header.insert(header.end(), entry.name.begin(), entry.name.end());
+
+    if (zip64) {
+        put16(header, Zip64ExtraId);
+        put16(header, static_cast<uint16_t>(extra.size()));
+        header.insert(header.end(), extra.begin(), extra.end());
+    }
+    return header;
+}
+
+bool ZipWriter::writeBytes(const unsigned char *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t written = ::write(m_fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return fail("Error al escribir el archivo ZIP");
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        m_offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+bool ZipWriter::writeAt(uint64_t offset, const std::vector<unsigned char> &bytes)
+{
+    size_t done = 0;
+    while (done < bytes.size()) {
+        ssize_t written = ::pwrite(m_fd, bytes.data() + done, bytes.size() - done, static_cast<off_t>(offset + done));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return fail("Error al escribir el archivo ZIP");
+        }
+        done += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool ZipWriter::fail(const std::string &message)
+{
+    m_errorMessage = message;
+    return false;
+}
@@ -0,0 +1,251 @@
+#include "zstd_stream.h"
+#include "cancellation_token.h"
+#include "input_source.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+// ZSTD_getCParams and the size estimates live in the static-linking section
+#define ZSTD_STATIC_LINKING_ONLY
+#include <zstd.h>
+#endif
+
+namespace {
+
+// What zstd --long uses; decoders accept up to 2^27 without extra flags
+constexpr int LongWindowLog = 27;
+
+const char *const UnavailableMessage = "Esta versión se compiló sin soporte para zstd";
+
+} // namespace
+
+bool ZstdStream::available()
+{
+#ifdef HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t ZstdStream::memoryEstimate(const Options &options)
+{
+#ifdef HAVE_ZSTD
+    int level = std::clamp(options.level, MinLevel, MaxLevel);
+    ZSTD_compressionParameters parameters = ZSTD_getCParams(level, 0, 0);
+    if (options.longDistance) {
+        parameters.windowLog = std::max<unsigned>(parameters.windowLog, LongWindowLog);
+    }
+    uint64_t size = ZSTD_estimateCStreamSize_usingCParams(parameters) + DeflateStream::DefaultBufferSize;
+    // Every worker holds its own match state and job buffers
+    return options.workers > 0 ? size * (options.workers + 1) : size;
+#else
+    (void)options;
+    return 0;
+#endif
+}
+
+ZstdStream::ZstdStream()
+    : ZstdStream(Options())
+{
+}
+
+ZstdStream::ZstdStream(const Options &options, size_t bufferSize)
+    : m_context(nullptr)
+    , m_options(options)
+    , m_workers(0)
+    , m_finished(false)
+    , m_bufferSize(std::max<size_t>(bufferSize, 4096))
+    , m_totalIn(0)
+    , m_totalOut(0)
+    , m_crc(crc32(0L, Z_NULL, 0))
+    , m_cancel(nullptr)
+{
+    m_options.level = std::clamp(m_options.level, MinLevel, MaxLevel);
+    m_outBuffer.resize(m_bufferSize);
+
+#ifdef HAVE_ZSTD
+    m_context = ZSTD_createCCtx();
+    if (!m_context) {
+        m_errorMessage = "No se pudo inicializar zstd";
+        return;
+    }
+
+    ZSTD_CCtx_setParameter(m_context, ZSTD_c_compressionLevel, m_options.level);
+    ZSTD_CCtx_setParameter(m_context, ZSTD_c_checksumFlag, 1);
+    if (m_options.longDistance) {
+        ZSTD_CCtx_setParameter(m_context, ZSTD_c_enableLongDistanceMatching, 1);
+        ZSTD_CCtx_setParameter(m_context, ZSTD_c_windowLog, LongWindowLog);
+    }
+    // Fails when libzstd was built without threads: stay single-threaded
+    if (m_options.workers > 0
+        && !ZSTD_isError(ZSTD_CCtx_setParameter(m_context, ZSTD_c_nbWorkers, static_cast<int>(m_options.workers)))) {
+        m_workers = m_options.workers;
+    }
+#else
+    m_errorMessage = UnavailableMessage;
+#endif
+}
+
+ZstdStream::~ZstdStream()
+{
+#ifdef HAVE_ZSTD
+    ZSTD_freeCCtx(m_context);
+#endif
+}
+
+void ZstdStream::setExpectedSize(uint64_t size)
+{
+#ifdef HAVE_ZSTD
+    if (m_context && m_totalIn == 0) {
+        ZSTD_CCtx_setPledgedSrcSize(m_context, size);
+    }
+#else
+    (void)size;
+#endif
+}
+
+bool ZstdStream::write(const unsigned char *data, size_t size, const DeflateStream::Sink &sink)
+{
+    if (!m_context || m_finished) {
+        if (m_errorMessage.empty()) {
+            m_errorMessage = "El flujo de compresión ya fue cerrado";
+        }
+        return false;
+    }
+
+    while (size > 0) {
+        if (CancellationToken::cancelled(m_cancel)) {
+            m_errorMessage = CancellationToken::CancelledMessage;
+            return false;
+        }
+        size_t slice = std::min<size_t>(size, m_bufferSize);
+        m_crc = crc32(m_crc, data, static_cast<uInt>(slice));
+        if (!compressBuffer(data, slice, false, sink)) {
+            return false;
+        }
+        data += slice;
+        size -= slice;
+    }
+    return true;
+}
+
+bool ZstdStream::finish(const DeflateStream::Sink &sink)
+{
+    if (!m_context || m_finished) {
+        if (m_errorMessage.empty()) {
+            m_errorMessage = "El flujo de compresión ya fue cerrado";
+        }
+        return false;
+    }
+
+    bool ok = compressBuffer(nullptr, 0, true, sink);
+    m_finished = true;
+    return ok;
+}
+
+bool ZstdStream::compressBuffer(const unsigned char *data, size_t size, bool end, const DeflateStream::Sink &sink)
+{
+#ifdef HAVE_ZSTD
+    ZSTD_inBuffer input = { data, size, 0 };
+    ZSTD_EndDirective directive = end ? ZSTD_e_end : ZSTD_e_continue;
+
+    // continue: until the input is taken; end: until the frame is complete
+    size_t remaining = 0;
+    do {
+        ZSTD_outBuffer output = { m_outBuffer.data(), m_outBuffer.size(), 0 };
+        remaining = ZSTD_compressStream2(m_context, &output, &input, directive);
+        if (ZSTD_isError(remaining)) {
+            m_errorMessage = std::string("Error en la compresión zstd: ") + ZSTD_getErrorName(remaining);
+            return false;
+        }
+
+        if (output.pos > 0) {
+            if (!sink(m_outBuffer.data(), output.pos)) {
+                if (m_errorMessage.empty()) {
+                    m_errorMessage = "Error al escribir los datos comprimidos";
+                }
+                return false;
+            }
+            m_totalOut += output.pos;
+        }
+    } while (end ? remaining != 0 : input.pos < input.size);
+
+    m_totalIn += size;
+    return true;
+#else
+    (void)data;
+    (void)size;
+    (void)end;
+    (void)sink;
+    m_errorMessage = UnavailableMessage;
+    return false;
+#endif
+}
+
+bool ZstdStream::compressFile(const std::string &inputPath, const std::string &outputPath,
+                              const DeflateStream::ProgressCallback &progress)
+{
+    if (!m_context) {
+        return false;
+    }
+
+    InputSource inputFile;
+    if (!inputFile.open(inputPath)) {
+        m_errorMessage = inputFile.errorMessage();
+        return false;
+    }
+    uint64_t totalBytes = inputFile.knownSize();
+    if (totalBytes > 0) {
+        setExpectedSize(totalBytes);
+    }
+
+    std::ofstream outputFile(outputPath, std::ios::binary | std::ios::trunc);
+    if (!outputFile.is_open()) {
+        m_errorMessage = "No se pudo crear el archivo de salida";
+        return false;
+    }
+
+    DeflateStream::Sink sink = [&outputFile](const unsigned char *data, size_t size) {
+        outputFile.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(outputFile);
+    };
+
+    auto abandon = [&](const std::string &message) {
+        if (!message.empty()) {
+            m_errorMessage = message;
+        }
+        outputFile.close();
+        std::remove(outputPath.c_str());
+        return false;
+    };
+
+    std::vector<unsigned char> inBuffer(InputSource::ReadBlockSize);
+    while (true) {
+        long long got = inputFile.read(inBuffer.data(), inBuffer.size());
+        if (got < 0) {
+            return abandon(inputFile.errorMessage());
+        }
+        if (got == 0) {
+            break;
+        }
+        if (!write(inBuffer.data(), static_cast<size_t>(got), sink)) {
+            return abandon(std::string());
+        }
+        if (progress) {
+            progress(m_totalIn, totalBytes);
+        }
+    }
+
+    if (!finish(sink)) {
+        return abandon(std::string());
+    }
+
+    outputFile.close();
+    if (!outputFile) {
+        return abandon("Error al escribir los datos comprimidos");
+    }
+    return true;
+}
@@ -0,0 +1,107 @@
+#!/bin/bash
+
+echo "🧪 Testing large file support (> 4 GiB)..."
+
+# Sparse files keep the corpus cheap on disk; the compressor still reads every byte
+CORPUS_DIR="${CORPUS_DIR:-/tmp/compressor_large_corpus}"
+BINARY="./pure_cpp_compressor_test"
+
+# Compile the command line compressor
+echo "🔨 Compiling pure_cpp_compressor..."
+g++ -std=c++17 -O2 -Iinclude \
+    src/pure_cpp_compressor.cpp \
+    src/batch_pipeline.cpp \
+    src/async_io.cpp \
+    src/brotli_stream.cpp \
+    src/cpu_count.cpp \
+    src/deflate_stream.cpp \
+    src/input_source.cpp \
+    src/lz4_stream.cpp \
+    src/memory_budget.cpp \
+    src/page_cache.cpp \
+    src/parallel_batch.cpp \
+    src/parallel_deflate.cpp \
+    src/seekable_gzip.cpp \
+    src/shard_queue.cpp \
+    src/staged_deflate.cpp \
+    src/work_stealing_pool.cpp \
+    src/zip_archive_builder.cpp \
+    src/zip_writer.cpp \
+    src/zstd_stream.cpp \
+    -lz -pthread \
+    -o "$BINARY"
+
+if [ $? -ne 0 ]; then
+    echo "❌ Compilation failed!"
+    exit 1
+fi
+
+# Build the corpus
+echo "📦 Creating sparse corpus in $CORPUS_DIR..."
+mkdir -p "$CORPUS_DIR"
+rm -f "$CORPUS_DIR"/*
+
+# Exactly 4 GiB: the classic ZIP limit itself
+truncate -s 4G "$CORPUS_DIR/exact_4g.bin"
+
+# 5 GiB of holes
+truncate -s 5G "$CORPUS_DIR/sparse_5g.bin"
+
+# 4.5 GiB with real data at the start, around the 4 GiB mark and at the end
+truncate -s 4608M "$CORPUS_DIR/mixed_4_5g.bin"
+head -c 16M /dev/urandom | dd of="$CORPUS_DIR/mixed_4_5g.bin" conv=notrunc status=none
+head -c 16M /dev/urandom | dd of="$CORPUS_DIR/mixed_4_5g.bin" bs=1M seek=4088 conv=notrunc status=none
+head -c 16M /dev/urandom | dd of="$CORPUS_DIR/mixed_4_5g.bin" bs=1M seek=4592 conv=notrunc status=none
+
+FAILED=0
+OUTPUT_DIR="output"
+
+for file in "$CORPUS_DIR"/*.bin; do
+    name=$(basename "$file" .bin)
+    expected=$(sha256sum "$file" | cut -d' ' -f1)
+
+    echo ""
+    echo "📁 $name ($(stat -c %s "$file") bytes)"
+
+    # zlib stream
+    "$BINARY" "$file" > /dev/null
+    actual=$(python3 -c "
+import hashlib, sys, zlib
+d = zlib.decompressobj()
+h = hashlib.sha256()
+with open(sys.argv[1], 'rb') as f:
+    for chunk in iter(lambda: f.read(1 << 20), b''):
+        h.update(d.decompress(chunk))
+h.update(d.flush())
+print(h.hexdigest())
+" "$OUTPUT_DIR/${name}_compressed.bin")
+    if [ "$actual" == "$expected" ]; then
+        echo "   ✅ zlib"
+    else
+        echo "   ❌ zlib: el contenido no coincide"
+        FAILED=1
+    fi
+
+    # ZIP64 archive
+    "$BINARY" --zip "$file" > /dev/null
+    actual=$(unzip -p "$OUTPUT_DIR/$name.zip" | sha256sum | cut -d' ' -f1)
+    if [ "$actual" == "$expected" ] && unzip -tq "$OUTPUT_DIR/$name.zip" > /dev/null; then
+        echo "   ✅ zip"
+    else
+        echo "   ❌ zip: el archivo no es válido"
+        FAILED=1
+    fi
+
+    rm -f "$OUTPUT_DIR/${name}_compressed.bin" "$OUTPUT_DIR/$name.zip"
+done
+
+# Cleanup
+rm -rf "$CORPUS_DIR" "$BINARY"
+
+echo ""
+if [ $FAILED -eq 0 ]; then
+    echo "✅ All large file tests passed!"
+else
+    echo "❌ Some large file tests failed!"
+    exit 1
+fi